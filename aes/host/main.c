@@ -26,8 +26,15 @@
  */
 
 #include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 /* OP-TEE TEE client API (built by optee_client) */
 #include <tee_client_api.h>
@@ -37,16 +44,88 @@
 
 #define AES_TEST_BUFFER_SIZE	4096
 #define AES_TEST_KEY_SIZE	16
+#define AES_TEST_RECORD_SIZE	256
+#define AES_TEST_RECORD_COUNT	(AES_TEST_BUFFER_SIZE / AES_TEST_RECORD_SIZE)
+#define AES_TEST_SECTOR_SIZE	4096
+#define AES_TEST_SECTOR_COUNT	8
+#define AES_TEST_KEY_SLOT	0x5a5a0001
+
+/* Session setups timed by the key slot bench, for each way to load a key */
+#define AES_KEY_BENCH_LOOPS	200
 
 #define DECODE			0
 #define ENCODE			1
 
+/* Ring of shared memory buffers ciphered in place by the memref bench */
+#define AES_SHM_RING_SLOTS	4
+#define AES_BENCH_MIN_SIZE	1024
+#define AES_BENCH_MAX_SIZE	(4 * 1024 * 1024)
+#define AES_BENCH_MIN_LOOPS	16
+#define AES_BENCH_BYTES		(32 * 1024 * 1024)
+
+/*
+ * Multi-threaded bench: each thread ciphers in its own session. Sizes are
+ * swept by factors of 16, thread counts by powers of two up to the
+ * requested count.
+ */
+#define AES_MT_BENCH_THREADS	4
+#define AES_MT_BENCH_MIN_SIZE	64
+#define AES_MT_BENCH_MAX_SIZE	(256 * 1024)
+#define AES_MT_BENCH_BYTES	(16 * 1024 * 1024)
+#define AES_MT_BENCH_MIN_LOOPS	64
+#define AES_MT_BENCH_MAX_LOOPS	20000
+
+/* One-shot MACs timed by the MAC bench, per algorithm */
+#define AES_MAC_BENCH_LOOPS	10000
+#define AES_MAC_BENCH_MSG_SIZE	64
+
+/* Input chunk of the stream mode, a multiple of TA_AES_BLOCK_SIZE */
+#define AES_STREAM_CHUNK_SIZE	(1024 * 1024)
+
 /* TEE resources */
 struct test_ctx {
 	TEEC_Context ctx;
 	TEEC_Session sess;
 };
 
+/* A thread of the multi-threaded bench, latencies of each cipher call */
+struct bench_thread {
+	pthread_t thread;
+	pthread_barrier_t *start;
+	uint32_t algo;
+	size_t sz;
+	size_t loops;
+	uint64_t *lat_ns;
+};
+
+/*
+ * Stream pipeline: a reader thread fills the ring slots from the input
+ * file while the main thread gets the previous slots ciphered by the TA.
+ */
+struct stream_ctx {
+	struct test_ctx *tee;
+	struct shm_ring *ring;
+	int in_fd;
+	size_t len[AES_SHM_RING_SLOTS];		/* Input bytes in slot */
+	int filled[AES_SHM_RING_SLOTS];		/* Slot ready to cipher */
+	int last[AES_SHM_RING_SLOTS];		/* Slot ends the input */
+	int read_err;				/* errno of a failed read */
+	int abort;				/* Cipher side gave up */
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+};
+
+/*
+ * Long-lived ring of shared memory buffers. Buffers are either allocated
+ * by the TEE client library or registered from client memory; in both
+ * cases they are passed to the TA without a bounce copy.
+ */
+struct shm_ring {
+	TEEC_SharedMemory shm[AES_SHM_RING_SLOTS];
+	void *backing[AES_SHM_RING_SLOTS];	/* NULL when allocated */
+	size_t count;
+};
+
 void prepare_tee_session(struct test_ctx *ctx)
 {
 	TEEC_UUID uuid = TA_AES_UUID;
@@ -72,7 +151,8 @@ void terminate_tee_session(struct test_ctx *ctx)
 	TEEC_FinalizeContext(&ctx->ctx);
 }
 
-void prepare_aes(struct test_ctx *ctx, int encode)
+void prepare_aes_algo(struct test_ctx *ctx, uint32_t algo, uint32_t key_size,
+		      int encode)
 {
 	TEEC_Operation op;
 	uint32_t origin;
@@ -84,8 +164,8 @@ void prepare_aes(struct test_ctx *ctx, int encode)
 					 TEEC_VALUE_INPUT,
 					 TEEC_NONE);
 
-	op.params[0].value.a = TA_AES_ALGO_CTR;
-	op.params[1].value.a = TA_AES_SIZE_128BIT;
+	op.params[0].value.a = algo;
+	op.params[1].value.a = key_size;
 	op.params[2].value.a = encode ? TA_AES_MODE_ENCODE :
 					TA_AES_MODE_DECODE;
 
@@ -96,6 +176,11 @@ void prepare_aes(struct test_ctx *ctx, int encode)
 			res, origin);
 }
 
+void prepare_aes(struct test_ctx *ctx, int encode)
+{
+	prepare_aes_algo(ctx, TA_AES_ALGO_CTR, TA_AES_SIZE_128BIT, encode);
+}
+
 void set_key(struct test_ctx *ctx, char *key, size_t key_sz)
 {
 	TEEC_Operation op;
@@ -157,53 +242,1874 @@ void cipher_buffer(struct test_ctx *ctx, char *in, char *out, size_t sz)
 			res, origin);
 }
 
-int main(int argc, char *argv[])
+TEEC_Result cipher_at(struct test_ctx *ctx, const void *in, void *out,
+		      size_t sz, uint64_t offset)
+{
+	TEEC_Operation op;
+	uint32_t origin;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT,
+					 TEEC_MEMREF_TEMP_OUTPUT,
+					 TEEC_VALUE_INPUT, TEEC_NONE);
+	op.params[0].tmpref.buffer = (void *)in;
+	op.params[0].tmpref.size = sz;
+	op.params[1].tmpref.buffer = out;
+	op.params[1].tmpref.size = sz;
+	op.params[2].value.a = offset;
+	op.params[2].value.b = offset >> 32;
+
+	return TEEC_InvokeCommand(&ctx->sess, TA_AES_CMD_CIPHER_AT,
+				  &op, &origin);
+}
+
+void cipher_batch(struct test_ctx *ctx, struct aes_batch_desc *desc,
+		  size_t count, char *buf, size_t sz)
+{
+	TEEC_Operation op;
+	uint32_t origin;
+	TEEC_Result res;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT,
+					 TEEC_MEMREF_TEMP_INOUT,
+					 TEEC_NONE, TEEC_NONE);
+	op.params[0].tmpref.buffer = desc;
+	op.params[0].tmpref.size = count * sizeof(*desc);
+	op.params[1].tmpref.buffer = buf;
+	op.params[1].tmpref.size = sz;
+
+	res = TEEC_InvokeCommand(&ctx->sess, TA_AES_CMD_CIPHER_BATCH,
+				 &op, &origin);
+	if (res != TEEC_SUCCESS)
+		errx(1, "TEEC_InvokeCommand(CIPHER_BATCH) failed 0x%x origin 0x%x",
+			res, origin);
+}
+
+/*
+ * Invoke a cipher command on sz bytes at offset of a shared memory buffer,
+ * in place: input and output partial memrefs point to the same region.
+ * Output may extend up to the end of the buffer, its size is returned in
+ * out_sz.
+ */
+TEEC_Result cipher_shm_cmd(struct test_ctx *ctx, uint32_t cmd,
+			   TEEC_SharedMemory *shm, size_t offset, size_t sz,
+			   size_t *out_sz)
+{
+	TEEC_Operation op;
+	uint32_t origin;
+	TEEC_Result res;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_PARTIAL_INPUT,
+					 TEEC_MEMREF_PARTIAL_OUTPUT,
+					 TEEC_NONE, TEEC_NONE);
+	op.params[0].memref.parent = shm;
+	op.params[0].memref.offset = offset;
+	op.params[0].memref.size = sz;
+	op.params[1].memref.parent = shm;
+	op.params[1].memref.offset = offset;
+	op.params[1].memref.size = shm->size - offset;
+
+	res = TEEC_InvokeCommand(&ctx->sess, cmd, &op, &origin);
+	*out_sz = op.params[1].memref.size;
+	return res;
+}
+
+/* Cipher sz bytes at offset of a shared memory buffer in place */
+TEEC_Result cipher_shm(struct test_ctx *ctx, TEEC_SharedMemory *shm,
+		       size_t offset, size_t sz)
+{
+	size_t out_sz;
+
+	return cipher_shm_cmd(ctx, TA_AES_CMD_CIPHER, shm, offset, sz,
+			      &out_sz);
+}
+
+void release_shm_ring(struct shm_ring *ring)
+{
+	size_t n;
+
+	for (n = 0; n < ring->count; n++) {
+		TEEC_ReleaseSharedMemory(&ring->shm[n]);
+		free(ring->backing[n]);
+	}
+	ring->count = 0;
+}
+
+/*
+ * Set up a ring of sz bytes shared memory buffers, registered from client
+ * memory if register_mem is set, allocated by the client library otherwise.
+ */
+TEEC_Result init_shm_ring(struct test_ctx *ctx, struct shm_ring *ring,
+			  size_t sz, int register_mem)
+{
+	TEEC_SharedMemory *shm;
+	TEEC_Result res;
+
+	memset(ring, 0, sizeof(*ring));
+
+	for (ring->count = 0; ring->count < AES_SHM_RING_SLOTS; ring->count++) {
+		shm = &ring->shm[ring->count];
+		shm->size = sz;
+		shm->flags = TEEC_MEM_INPUT | TEEC_MEM_OUTPUT;
+
+		if (register_mem) {
+			ring->backing[ring->count] = malloc(sz);
+			if (!ring->backing[ring->count]) {
+				res = TEEC_ERROR_OUT_OF_MEMORY;
+				goto err;
+			}
+			shm->buffer = ring->backing[ring->count];
+			res = TEEC_RegisterSharedMemory(&ctx->ctx, shm);
+		} else {
+			res = TEEC_AllocateSharedMemory(&ctx->ctx, shm);
+		}
+		if (res != TEEC_SUCCESS) {
+			free(ring->backing[ring->count]);
+			goto err;
+		}
+
+		memset(shm->buffer, 0x5a, sz);
+	}
+
+	return TEEC_SUCCESS;
+err:
+	release_shm_ring(ring);
+	return res;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static double mb_per_sec(size_t bytes, uint64_t ns)
+{
+	return ns ? (double)bytes * 1000 / ns : 0;
+}
+
+/* Cipher sz bytes loops times through temporary memrefs */
+static TEEC_Result bench_temp(struct test_ctx *ctx, char *in, char *out,
+			      size_t sz, size_t loops, uint64_t *ns)
+{
+	TEEC_Operation op;
+	uint32_t origin;
+	TEEC_Result res;
+	uint64_t start;
+	size_t n;
+
+	start = now_ns();
+	for (n = 0; n < loops; n++) {
+		memset(&op, 0, sizeof(op));
+		op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT,
+						 TEEC_MEMREF_TEMP_OUTPUT,
+						 TEEC_NONE, TEEC_NONE);
+		op.params[0].tmpref.buffer = in;
+		op.params[0].tmpref.size = sz;
+		op.params[1].tmpref.buffer = out;
+		op.params[1].tmpref.size = sz;
+
+		res = TEEC_InvokeCommand(&ctx->sess, TA_AES_CMD_CIPHER,
+					 &op, &origin);
+		if (res != TEEC_SUCCESS)
+			return res;
+	}
+	*ns = now_ns() - start;
+
+	return TEEC_SUCCESS;
+}
+
+/* Cipher sz bytes loops times in place, cycling through a ring */
+static TEEC_Result bench_ring(struct test_ctx *ctx, int register_mem,
+			      size_t sz, size_t loops, uint64_t *ns)
+{
+	struct shm_ring ring;
+	TEEC_Result res;
+	uint64_t start;
+	size_t n;
+
+	res = init_shm_ring(ctx, &ring, sz, register_mem);
+	if (res != TEEC_SUCCESS)
+		return res;
+
+	start = now_ns();
+	for (n = 0; n < loops; n++) {
+		res = cipher_shm(ctx, &ring.shm[n % ring.count], 0, sz);
+		if (res != TEEC_SUCCESS)
+			break;
+	}
+	*ns = now_ns() - start;
+
+	release_shm_ring(&ring);
+	return res;
+}
+
+static void print_bench(TEEC_Result res, size_t bytes, uint64_t ns)
+{
+	if (res != TEEC_SUCCESS)
+		printf(" %12s", "err");
+	else
+		printf(" %12.2f", mb_per_sec(bytes, ns));
+}
+
+/*
+ * Compare AES-CTR throughput (MB/s) of temporary memrefs, which are
+ * bounced through driver shared memory, against registered and allocated
+ * shared memory ciphered in place.
+ */
+int memref_bench(void)
 {
 	struct test_ctx ctx;
 	char key[AES_TEST_KEY_SIZE];
 	char iv[AES_TEST_KEY_SIZE];
-	char clear[AES_TEST_BUFFER_SIZE];
-	char ciph[AES_TEST_BUFFER_SIZE];
-	char temp[AES_TEST_BUFFER_SIZE];
+	TEEC_Result res;
+	uint64_t ns;
+	size_t loops;
+	size_t sz;
+	char *in;
+	char *out;
 
-	printf("Prepare session with the TA\n");
-	prepare_tee_session(&ctx);
+	in = malloc(AES_BENCH_MAX_SIZE);
+	out = malloc(AES_BENCH_MAX_SIZE);
+	if (!in || !out)
+		errx(1, "Cannot allocate %d bytes buffers", AES_BENCH_MAX_SIZE);
+	memset(in, 0x5a, AES_BENCH_MAX_SIZE);
 
-	printf("Prepare encode operation\n");
+	prepare_tee_session(&ctx);
 	prepare_aes(&ctx, ENCODE);
-
-	printf("Load key in TA\n");
-	memset(key, 0xa5, sizeof(key)); /* Load some dummy value */
+	memset(key, 0xa5, sizeof(key));
 	set_key(&ctx, key, AES_TEST_KEY_SIZE);
-
-	printf("Reset ciphering operation in TA (provides the initial vector)\n");
-	memset(iv, 0, sizeof(iv)); /* Load some dummy value */
+	memset(iv, 0, sizeof(iv));
 	set_iv(&ctx, iv, AES_TEST_KEY_SIZE);
 
-	printf("Encore buffer from TA\n");
-	memset(clear, 0x5a, sizeof(clear)); /* Load some dummy value */
-	cipher_buffer(&ctx, clear, ciph, AES_TEST_BUFFER_SIZE);
+	printf("%10s %8s %12s %12s %12s\n", "size", "loops",
+	       "temp MB/s", "reg MB/s", "alloc MB/s");
 
-	printf("Prepare decode operation\n");
-	prepare_aes(&ctx, DECODE);
+	for (sz = AES_BENCH_MIN_SIZE; sz <= AES_BENCH_MAX_SIZE; sz *= 2) {
+		loops = AES_BENCH_BYTES / sz;
+		if (loops < AES_BENCH_MIN_LOOPS)
+			loops = AES_BENCH_MIN_LOOPS;
 
-	printf("Load key in TA\n");
-	memset(key, 0xa5, sizeof(key)); /* Load some dummy value */
-	set_key(&ctx, key, AES_TEST_KEY_SIZE);
+		printf("%10zu %8zu", sz, loops);
 
-	printf("Reset ciphering operation in TA (provides the initial vector)\n");
-	memset(iv, 0, sizeof(iv)); /* Load some dummy value */
+		res = bench_temp(&ctx, in, out, sz, loops, &ns);
+		print_bench(res, sz * loops, ns);
+
+		res = bench_ring(&ctx, 1, sz, loops, &ns);
+		print_bench(res, sz * loops, ns);
+
+		res = bench_ring(&ctx, 0, sz, loops, &ns);
+		print_bench(res, sz * loops, ns);
+
+		printf("\n");
+	}
+
+	terminate_tee_session(&ctx);
+	free(in);
+	free(out);
+	return 0;
+}
+
+static void *bench_worker(void *arg)
+{
+	struct bench_thread *bt = arg;
+	char key[AES_TEST_KEY_SIZE];
+	char iv[AES_TEST_KEY_SIZE];
+	struct test_ctx ctx;
+	uint64_t start;
+	char *in;
+	char *out;
+	size_t n;
+
+	in = malloc(bt->sz);
+	out = malloc(bt->sz);
+	if (!in || !out)
+		errx(1, "Cannot allocate %zu bytes buffers", bt->sz);
+	memset(in, 0x5a, bt->sz);
+
+	prepare_tee_session(&ctx);
+	prepare_aes_algo(&ctx, bt->algo, TA_AES_SIZE_128BIT, ENCODE);
+	memset(key, 0xa5, sizeof(key));
+	set_key(&ctx, key, AES_TEST_KEY_SIZE);
+	memset(iv, 0, sizeof(iv));
 	set_iv(&ctx, iv, AES_TEST_KEY_SIZE);
 
-	printf("Decode buffer from TA\n");
-	memset(clear, 0x5a, sizeof(clear)); /* Load some dummy value */
-	cipher_buffer(&ctx, ciph, temp, AES_TEST_BUFFER_SIZE);
+	pthread_barrier_wait(bt->start);
 
-	/* Check decoded is the clear content */
-	if (memcmp(clear, temp, AES_TEST_BUFFER_SIZE))
-		printf("Clear text and decoded text differ => ERROR\n");
-	else
-		printf("Clear text and decoded text match\n");
+	for (n = 0; n < bt->loops; n++) {
+		start = now_ns();
+		cipher_buffer(&ctx, in, out, bt->sz);
+		bt->lat_ns[n] = now_ns() - start;
+	}
+
+	terminate_tee_session(&ctx);
+	free(in);
+	free(out);
+	return NULL;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* Latency in microseconds at permille rank of sorted samples */
+static double percentile_us(const uint64_t *lat_ns, size_t count,
+			    unsigned int permille)
+{
+	size_t rank = count * permille / 1000;
+
+	if (rank >= count)
+		rank = count - 1;
+
+	return lat_ns[rank] / 1000.0;
+}
+
+/*
+ * Run one bench configuration: threads sessions ciphering sz bytes
+ * buffers concurrently. Wall time starts once all sessions are ready.
+ */
+static void bench_config(uint32_t algo, const char *name, size_t sz,
+			 size_t threads)
+{
+	struct bench_thread *bt;
+	pthread_barrier_t start;
+	uint64_t wall_ns;
+	uint64_t *lat_ns;
+	size_t loops;
+	size_t total;
+	size_t n;
+
+	loops = AES_MT_BENCH_BYTES / sz / threads;
+	if (loops < AES_MT_BENCH_MIN_LOOPS)
+		loops = AES_MT_BENCH_MIN_LOOPS;
+	if (loops > AES_MT_BENCH_MAX_LOOPS)
+		loops = AES_MT_BENCH_MAX_LOOPS;
+	total = loops * threads;
+
+	bt = calloc(threads, sizeof(*bt));
+	lat_ns = malloc(total * sizeof(*lat_ns));
+	if (!bt || !lat_ns)
+		errx(1, "Out of memory");
+
+	if (pthread_barrier_init(&start, NULL, threads + 1))
+		errx(1, "pthread_barrier_init failed");
+
+	for (n = 0; n < threads; n++) {
+		bt[n].start = &start;
+		bt[n].algo = algo;
+		bt[n].sz = sz;
+		bt[n].loops = loops;
+		bt[n].lat_ns = lat_ns + n * loops;
+		if (pthread_create(&bt[n].thread, NULL, bench_worker, bt + n))
+			errx(1, "pthread_create failed");
+	}
+
+	pthread_barrier_wait(&start);
+	wall_ns = now_ns();
+	for (n = 0; n < threads; n++)
+		pthread_join(bt[n].thread, NULL);
+	wall_ns = now_ns() - wall_ns;
+
+	qsort(lat_ns, total, sizeof(*lat_ns), cmp_u64);
+
+	printf("%-4s %8zu %7zu %12.0f %10.2f %9.1f %9.1f %9.1f\n",
+	       name, sz, threads,
+	       wall_ns ? (double)total * 1000000000 / wall_ns : 0,
+	       mb_per_sec(total * sz, wall_ns),
+	       percentile_us(lat_ns, total, 500),
+	       percentile_us(lat_ns, total, 990),
+	       percentile_us(lat_ns, total, 999));
+
+	pthread_barrier_destroy(&start);
+	free(lat_ns);
+	free(bt);
+}
+
+/* Powers of two, then the requested count, then past it */
+static size_t next_thread_count(size_t threads, size_t max_threads)
+{
+	if (threads < max_threads && threads * 2 > max_threads)
+		return max_threads;
+
+	return threads * 2;
+}
+
+/*
+ * tpm_aes bench [threads]
+ *
+ * Measure how AES throughput scales with concurrent client sessions, to
+ * size client thread pools against the TEE threads.
+ */
+int mt_bench(int argc, char *argv[])
+{
+	static const struct {
+		uint32_t algo;
+		const char *name;
+	} algos[] = {
+		{ TA_AES_ALGO_ECB, "ecb" },
+		{ TA_AES_ALGO_CBC, "cbc" },
+		{ TA_AES_ALGO_CTR, "ctr" },
+	};
+	size_t max_threads = AES_MT_BENCH_THREADS;
+	size_t threads;
+	size_t sz;
+	size_t n;
+
+	if (argc > 2) {
+		max_threads = strtoul(argv[2], NULL, 0);
+		if (!max_threads)
+			errx(1, "usage: %s bench [threads]", argv[0]);
+	}
+
+	printf("%-4s %8s %7s %12s %10s %9s %9s %9s\n", "algo", "size",
+	       "threads", "ops/s", "MB/s", "p50 us", "p99 us", "p999 us");
+
+	for (n = 0; n < sizeof(algos) / sizeof(algos[0]); n++)
+		for (sz = AES_MT_BENCH_MIN_SIZE; sz <= AES_MT_BENCH_MAX_SIZE;
+		     sz *= 16)
+			for (threads = 1; threads <= max_threads;
+			     threads = next_thread_count(threads, max_threads))
+				bench_config(algos[n].algo, algos[n].name,
+					     sz, threads);
+
+	return 0;
+}
+
+TEEC_Result ae_init(struct test_ctx *ctx, const void *nonce, size_t nonce_sz,
+		    uint32_t tag_bits)
+{
+	TEEC_Operation op;
+	uint32_t origin;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT,
+					 TEEC_VALUE_INPUT,
+					 TEEC_NONE, TEEC_NONE);
+	op.params[0].tmpref.buffer = (void *)nonce;
+	op.params[0].tmpref.size = nonce_sz;
+	op.params[1].value.a = tag_bits;
+
+	return TEEC_InvokeCommand(&ctx->sess, TA_AES_CMD_AE_INIT, &op, &origin);
+}
+
+TEEC_Result ae_update_aad(struct test_ctx *ctx, const void *aad, size_t sz)
+{
+	TEEC_Operation op;
+	uint32_t origin;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT,
+					 TEEC_NONE, TEEC_NONE, TEEC_NONE);
+	op.params[0].tmpref.buffer = (void *)aad;
+	op.params[0].tmpref.size = sz;
+
+	return TEEC_InvokeCommand(&ctx->sess, TA_AES_CMD_AE_UPDATE_AAD,
+				  &op, &origin);
+}
+
+TEEC_Result ae_update(struct test_ctx *ctx, const void *in, size_t in_sz,
+		      void *out, size_t *out_sz)
+{
+	TEEC_Operation op;
+	uint32_t origin;
+	TEEC_Result res;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT,
+					 TEEC_MEMREF_TEMP_OUTPUT,
+					 TEEC_NONE, TEEC_NONE);
+	op.params[0].tmpref.buffer = (void *)in;
+	op.params[0].tmpref.size = in_sz;
+	op.params[1].tmpref.buffer = out;
+	op.params[1].tmpref.size = *out_sz;
+
+	res = TEEC_InvokeCommand(&ctx->sess, TA_AES_CMD_AE_UPDATE,
+				 &op, &origin);
+	*out_sz = op.params[1].tmpref.size;
+	return res;
+}
+
+/*
+ * Encrypt the last payload chunk: ciphertext and tag come back from the
+ * same invocation.
+ */
+TEEC_Result ae_encrypt_final(struct test_ctx *ctx, const void *in,
+			     size_t in_sz, void *out, size_t *out_sz,
+			     void *tag, size_t *tag_sz)
+{
+	TEEC_Operation op;
+	uint32_t origin;
+	TEEC_Result res;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT,
+					 TEEC_MEMREF_TEMP_OUTPUT,
+					 TEEC_MEMREF_TEMP_OUTPUT,
+					 TEEC_NONE);
+	op.params[0].tmpref.buffer = (void *)in;
+	op.params[0].tmpref.size = in_sz;
+	op.params[1].tmpref.buffer = out;
+	op.params[1].tmpref.size = *out_sz;
+	op.params[2].tmpref.buffer = tag;
+	op.params[2].tmpref.size = *tag_sz;
+
+	res = TEEC_InvokeCommand(&ctx->sess, TA_AES_CMD_AE_ENCRYPT_FINAL,
+				 &op, &origin);
+	*out_sz = op.params[1].tmpref.size;
+	*tag_sz = op.params[2].tmpref.size;
+	return res;
+}
+
+TEEC_Result ae_decrypt_final(struct test_ctx *ctx, const void *in,
+			     size_t in_sz, void *out, size_t *out_sz,
+			     const void *tag, size_t tag_sz)
+{
+	TEEC_Operation op;
+	uint32_t origin;
+	TEEC_Result res;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT,
+					 TEEC_MEMREF_TEMP_OUTPUT,
+					 TEEC_MEMREF_TEMP_INPUT,
+					 TEEC_NONE);
+	op.params[0].tmpref.buffer = (void *)in;
+	op.params[0].tmpref.size = in_sz;
+	op.params[1].tmpref.buffer = out;
+	op.params[1].tmpref.size = *out_sz;
+	op.params[2].tmpref.buffer = (void *)tag;
+	op.params[2].tmpref.size = tag_sz;
+
+	res = TEEC_InvokeCommand(&ctx->sess, TA_AES_CMD_AE_DECRYPT_FINAL,
+				 &op, &origin);
+	*out_sz = op.params[1].tmpref.size;
+	return res;
+}
+
+/*
+ * AES-GCM known answers, test cases 2, 4 and 16 from "The Galois/Counter
+ * Mode of Operation (GCM)", McGrew & Viega.
+ */
+struct gcm_test_value {
+	const char *name;
+	uint8_t key[TA_AES_SIZE_256BIT];
+	size_t key_sz;
+	uint8_t nonce[12];
+	uint8_t aad[20];
+	size_t aad_sz;
+	uint8_t clear[64];
+	uint8_t ciph[64];
+	size_t sz;
+	uint8_t tag[16];
+};
+
+static const struct gcm_test_value gcm_test_values[] = {
+	{
+		.name = "GCM test case 2",
+		.key_sz = TA_AES_SIZE_128BIT,
+		.sz = 16,
+		.ciph = {
+			0x03, 0x88, 0xda, 0xce, 0x60, 0xb6, 0xa3, 0x92,
+			0xf3, 0x28, 0xc2, 0xb9, 0x71, 0xb2, 0xfe, 0x78
+		},
+		.tag = {
+			0xab, 0x6e, 0x47, 0xd4, 0x2c, 0xec, 0x13, 0xbd,
+			0xf5, 0x3a, 0x67, 0xb2, 0x12, 0x57, 0xbd, 0xdf
+		},
+	},
+	{
+		.name = "GCM test case 4",
+		.key = {
+			0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c,
+			0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08
+		},
+		.key_sz = TA_AES_SIZE_128BIT,
+		.nonce = {
+			0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad,
+			0xde, 0xca, 0xf8, 0x88
+		},
+		.aad = {
+			0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef,
+			0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef,
+			0xab, 0xad, 0xda, 0xd2
+		},
+		.aad_sz = 20,
+		.clear = {
+			0xd9, 0x31, 0x32, 0x25, 0xf8, 0x84, 0x06, 0xe5,
+			0xa5, 0x59, 0x09, 0xc5, 0xaf, 0xf5, 0x26, 0x9a,
+			0x86, 0xa7, 0xa9, 0x53, 0x15, 0x34, 0xf7, 0xda,
+			0x2e, 0x4c, 0x30, 0x3d, 0x8a, 0x31, 0x8a, 0x72,
+			0x1c, 0x3c, 0x0c, 0x95, 0x95, 0x68, 0x09, 0x53,
+			0x2f, 0xcf, 0x0e, 0x24, 0x49, 0xa6, 0xb5, 0x25,
+			0xb1, 0x6a, 0xed, 0xf5, 0xaa, 0x0d, 0xe6, 0x57,
+			0xba, 0x63, 0x7b, 0x39
+		},
+		.ciph = {
+			0x42, 0x83, 0x1e, 0xc2, 0x21, 0x77, 0x74, 0x24,
+			0x4b, 0x72, 0x21, 0xb7, 0x84, 0xd0, 0xd4, 0x9c,
+			0xe3, 0xaa, 0x21, 0x2f, 0x2c, 0x02, 0xa4, 0xe0,
+			0x35, 0xc1, 0x7e, 0x23, 0x29, 0xac, 0xa1, 0x2e,
+			0x21, 0xd5, 0x14, 0xb2, 0x54, 0x66, 0x93, 0x1c,
+			0x7d, 0x8f, 0x6a, 0x5a, 0xac, 0x84, 0xaa, 0x05,
+			0x1b, 0xa3, 0x0b, 0x39, 0x6a, 0x0a, 0xac, 0x97,
+			0x3d, 0x58, 0xe0, 0x91
+		},
+		.sz = 60,
+		.tag = {
+			0x5b, 0xc9, 0x4f, 0xbc, 0x32, 0x21, 0xa5, 0xdb,
+			0x94, 0xfa, 0xe9, 0x5a, 0xe7, 0x12, 0x1a, 0x47
+		},
+	},
+	{
+		.name = "GCM test case 16",
+		.key = {
+			0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c,
+			0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08,
+			0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c,
+			0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08
+		},
+		.key_sz = TA_AES_SIZE_256BIT,
+		.nonce = {
+			0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad,
+			0xde, 0xca, 0xf8, 0x88
+		},
+		.aad = {
+			0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef,
+			0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef,
+			0xab, 0xad, 0xda, 0xd2
+		},
+		.aad_sz = 20,
+		.clear = {
+			0xd9, 0x31, 0x32, 0x25, 0xf8, 0x84, 0x06, 0xe5,
+			0xa5, 0x59, 0x09, 0xc5, 0xaf, 0xf5, 0x26, 0x9a,
+			0x86, 0xa7, 0xa9, 0x53, 0x15, 0x34, 0xf7, 0xda,
+			0x2e, 0x4c, 0x30, 0x3d, 0x8a, 0x31, 0x8a, 0x72,
+			0x1c, 0x3c, 0x0c, 0x95, 0x95, 0x68, 0x09, 0x53,
+			0x2f, 0xcf, 0x0e, 0x24, 0x49, 0xa6, 0xb5, 0x25,
+			0xb1, 0x6a, 0xed, 0xf5, 0xaa, 0x0d, 0xe6, 0x57,
+			0xba, 0x63, 0x7b, 0x39
+		},
+		.ciph = {
+			0x52, 0x2d, 0xc1, 0xf0, 0x99, 0x56, 0x7d, 0x07,
+			0xf4, 0x7f, 0x37, 0xa3, 0x2a, 0x84, 0x42, 0x7d,
+			0x64, 0x3a, 0x8c, 0xdc, 0xbf, 0xe5, 0xc0, 0xc9,
+			0x75, 0x98, 0xa2, 0xbd, 0x25, 0x55, 0xd1, 0xaa,
+			0x8c, 0xb0, 0x8e, 0x48, 0x59, 0x0d, 0xbb, 0x3d,
+			0xa7, 0xb0, 0x8b, 0x10, 0x56, 0x82, 0x88, 0x38,
+			0xc5, 0xf6, 0x1e, 0x63, 0x93, 0xba, 0x7a, 0x0a,
+			0xbc, 0xc9, 0xf6, 0x62
+		},
+		.sz = 60,
+		.tag = {
+			0x76, 0xfc, 0x6e, 0xce, 0x0f, 0x4e, 0x17, 0x68,
+			0xcd, 0xdf, 0x88, 0x53, 0xbb, 0x2d, 0x55, 0x1b
+		},
+	},
+};
+
+/*
+ * Encrypt then decrypt a GCM known answer with a tag truncated to
+ * tag_bits. The payload is split over AE_UPDATE and the final command.
+ * Return 0 on match.
+ */
+static int run_gcm_test(struct test_ctx *ctx, const struct gcm_test_value *t,
+			uint32_t tag_bits)
+{
+	uint8_t out[sizeof(t->ciph)];
+	uint8_t tag[sizeof(t->tag)];
+	size_t head = (t->sz / 2) & ~(TA_AES_BLOCK_SIZE - 1);
+	size_t tag_sz = sizeof(tag);
+	size_t out_sz;
+	size_t sz;
+	TEEC_Result res;
+
+	prepare_aes_algo(ctx, TA_AES_ALGO_GCM, t->key_sz, ENCODE);
+	set_key(ctx, (char *)t->key, t->key_sz);
+
+	res = ae_init(ctx, t->nonce, sizeof(t->nonce), tag_bits);
+	if (res == TEEC_SUCCESS && t->aad_sz)
+		res = ae_update_aad(ctx, t->aad, t->aad_sz);
+	out_sz = sizeof(out);
+	if (res == TEEC_SUCCESS)
+		res = ae_update(ctx, t->clear, head, out, &out_sz);
+	sz = out_sz;
+	out_sz = sizeof(out) - sz;
+	if (res == TEEC_SUCCESS)
+		res = ae_encrypt_final(ctx, t->clear + head, t->sz - head,
+				       out + sz, &out_sz, tag, &tag_sz);
+	if (res != TEEC_SUCCESS) {
+		printf("%s: encrypt failed 0x%x\n", t->name, res);
+		return -1;
+	}
+	if (sz + out_sz != t->sz || memcmp(out, t->ciph, t->sz) ||
+	    tag_sz != tag_bits / 8 || memcmp(tag, t->tag, tag_sz)) {
+		printf("%s: unexpected ciphertext or tag\n", t->name);
+		return -1;
+	}
+
+	prepare_aes_algo(ctx, TA_AES_ALGO_GCM, t->key_sz, DECODE);
+
+	res = ae_init(ctx, t->nonce, sizeof(t->nonce), tag_bits);
+	if (res == TEEC_SUCCESS && t->aad_sz)
+		res = ae_update_aad(ctx, t->aad, t->aad_sz);
+	out_sz = sizeof(out);
+	if (res == TEEC_SUCCESS)
+		res = ae_decrypt_final(ctx, t->ciph, t->sz, out, &out_sz,
+				       t->tag, tag_bits / 8);
+	if (res != TEEC_SUCCESS) {
+		printf("%s: decrypt failed 0x%x\n", t->name, res);
+		return -1;
+	}
+	if (out_sz != t->sz || memcmp(out, t->clear, t->sz)) {
+		printf("%s: unexpected plaintext\n", t->name);
+		return -1;
+	}
+
+	/* A corrupted tag shall be rejected */
+	memcpy(tag, t->tag, sizeof(tag));
+	tag[0] ^= 1;
+	res = ae_init(ctx, t->nonce, sizeof(t->nonce), tag_bits);
+	if (res == TEEC_SUCCESS && t->aad_sz)
+		res = ae_update_aad(ctx, t->aad, t->aad_sz);
+	out_sz = sizeof(out);
+	if (res == TEEC_SUCCESS)
+		res = ae_decrypt_final(ctx, t->ciph, t->sz, out, &out_sz,
+				       tag, tag_bits / 8);
+	if (res != TEEC_ERROR_MAC_INVALID) {
+		printf("%s: corrupted tag not detected 0x%x\n", t->name, res);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Run the GCM known answers and tag length validation, return errors */
+int run_gcm_tests(struct test_ctx *ctx)
+{
+	static const uint32_t bad_tag_bits[] = { 0, 64, 100, 136 };
+	const struct gcm_test_value *t = &gcm_test_values[0];
+	size_t errors = 0;
+	TEEC_Result res;
+	size_t n;
+
+	for (n = 0; n < sizeof(gcm_test_values) / sizeof(*t); n++) {
+		errors += !!run_gcm_test(ctx, &gcm_test_values[n],
+					 TA_AES_GCM_TAG_MAX_BITS);
+		errors += !!run_gcm_test(ctx, &gcm_test_values[n],
+					 TA_AES_GCM_TAG_MIN_BITS);
+	}
+
+	prepare_aes_algo(ctx, TA_AES_ALGO_GCM, t->key_sz, ENCODE);
+	for (n = 0; n < sizeof(bad_tag_bits) / sizeof(*bad_tag_bits); n++) {
+		res = ae_init(ctx, t->nonce, sizeof(t->nonce), bad_tag_bits[n]);
+		if (res != TEEC_ERROR_BAD_PARAMETERS) {
+			printf("Tag length %u not rejected 0x%x\n",
+			       bad_tag_bits[n], res);
+			errors++;
+		}
+	}
+
+	return errors;
+}
+
+TEEC_Result xts_sectors(struct test_ctx *ctx, const void *in, void *out,
+			size_t sz, uint64_t sector, uint32_t sector_sz)
+{
+	TEEC_Operation op;
+	uint32_t origin;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT,
+					 TEEC_MEMREF_TEMP_OUTPUT,
+					 TEEC_VALUE_INPUT, TEEC_VALUE_INPUT);
+	op.params[0].tmpref.buffer = (void *)in;
+	op.params[0].tmpref.size = sz;
+	op.params[1].tmpref.buffer = out;
+	op.params[1].tmpref.size = sz;
+	op.params[2].value.a = sector;
+	op.params[2].value.b = sector >> 32;
+	op.params[3].value.a = sector_sz;
+
+	return TEEC_InvokeCommand(&ctx->sess, TA_AES_CMD_XTS_SECTORS,
+				  &op, &origin);
+}
+
+/* IEEE P1619 XTS-AES-128 vector 2 */
+static const uint8_t xts_test_keys[2 * TA_AES_SIZE_128BIT] = {
+	0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+	0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+	0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22,
+	0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22,
+};
+static const uint64_t xts_test_sector = 0x3333333333;
+static const uint8_t xts_test_ciph[32] = {
+	0xc4, 0x54, 0x18, 0x5e, 0x6a, 0x16, 0x93, 0x6e,
+	0x39, 0x33, 0x40, 0x38, 0xac, 0xef, 0x83, 0x8b,
+	0xfb, 0x18, 0x6f, 0xff, 0x74, 0x80, 0xad, 0xc4,
+	0x28, 0x93, 0x82, 0xec, 0xd6, 0xd3, 0x94, 0xf0,
+};
+
+/*
+ * Run the XTS known answer, then round trip a multi-sector extent and
+ * check it matches ciphering its sectors one by one. Return errors.
+ */
+int run_xts_tests(struct test_ctx *ctx)
+{
+	static uint8_t clear[AES_TEST_SECTOR_COUNT * AES_TEST_SECTOR_SIZE];
+	static uint8_t ciph[sizeof(clear)];
+	static uint8_t temp[sizeof(clear)];
+	size_t errors = 0;
+	TEEC_Result res;
+	size_t n;
+
+	prepare_aes_algo(ctx, TA_AES_ALGO_XTS, TA_AES_SIZE_128BIT, ENCODE);
+	set_key(ctx, (char *)xts_test_keys, sizeof(xts_test_keys));
+
+	memset(clear, 0x44, sizeof(xts_test_ciph));
+	res = xts_sectors(ctx, clear, ciph, sizeof(xts_test_ciph),
+			  xts_test_sector, sizeof(xts_test_ciph));
+	if (res != TEEC_SUCCESS ||
+	    memcmp(ciph, xts_test_ciph, sizeof(xts_test_ciph))) {
+		printf("XTS vector 2: unexpected ciphertext 0x%x\n", res);
+		errors++;
+	}
+
+	for (n = 0; n < sizeof(clear); n++)
+		clear[n] = n;
+
+	res = xts_sectors(ctx, clear, ciph, sizeof(clear), xts_test_sector,
+			  AES_TEST_SECTOR_SIZE);
+	for (n = 0; res == TEEC_SUCCESS && n < AES_TEST_SECTOR_COUNT; n++)
+		res = xts_sectors(ctx, clear + n * AES_TEST_SECTOR_SIZE,
+				  temp + n * AES_TEST_SECTOR_SIZE,
+				  AES_TEST_SECTOR_SIZE, xts_test_sector + n,
+				  AES_TEST_SECTOR_SIZE);
+	if (res != TEEC_SUCCESS || memcmp(ciph, temp, sizeof(ciph))) {
+		printf("XTS extent and single sectors differ 0x%x\n", res);
+		errors++;
+	}
+
+	prepare_aes_algo(ctx, TA_AES_ALGO_XTS, TA_AES_SIZE_128BIT, DECODE);
+
+	res = xts_sectors(ctx, ciph, temp, sizeof(ciph), xts_test_sector,
+			  AES_TEST_SECTOR_SIZE);
+	if (res != TEEC_SUCCESS || memcmp(clear, temp, sizeof(clear))) {
+		printf("XTS decoded extent differs 0x%x\n", res);
+		errors++;
+	}
+
+	/* Extent shall be a whole number of sectors */
+	res = xts_sectors(ctx, ciph, temp, AES_TEST_SECTOR_SIZE + 16,
+			  xts_test_sector, AES_TEST_SECTOR_SIZE);
+	if (res != TEEC_ERROR_BAD_PARAMETERS) {
+		printf("XTS partial sector not rejected 0x%x\n", res);
+		errors++;
+	}
+
+	return errors;
+}
+
+void get_stats(struct test_ctx *ctx, uint32_t *hits, uint32_t *misses)
+{
+	TEEC_Operation op;
+	uint32_t origin;
+	TEEC_Result res;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_OUTPUT,
+					 TEEC_NONE, TEEC_NONE, TEEC_NONE);
+
+	res = TEEC_InvokeCommand(&ctx->sess, TA_AES_CMD_GET_STATS,
+				 &op, &origin);
+	if (res != TEEC_SUCCESS)
+		errx(1, "TEEC_InvokeCommand(GET_STATS) failed 0x%x origin 0x%x",
+			res, origin);
+
+	*hits = op.params[0].value.a;
+	*misses = op.params[0].value.b;
+}
+
+/*
+ * Read back random extents of a CTR stream (ciph, from clear with a zero
+ * IV) with one TA_AES_CMD_CIPHER_AT each, then check the counter block
+ * carries over 64-bit boundaries. Return errors.
+ */
+int run_ctr_offset_tests(struct test_ctx *ctx, const char *clear,
+			 const char *ciph, size_t sz)
+{
+	static const struct {
+		size_t offset;
+		size_t len;
+	} extents[] = {
+		{ 0, 16 }, { 17, 100 }, { 1000, 1 }, { 5, 11 },
+		{ 2048, 2048 }, { 4095, 1 }, { 333, 3000 },
+	};
+	char iv[TA_AES_BLOCK_SIZE];
+	char out[AES_TEST_BUFFER_SIZE];
+	char ref[3 * TA_AES_BLOCK_SIZE];
+	size_t errors = 0;
+	TEEC_Result res;
+	size_t n;
+
+	memset(iv, 0, sizeof(iv));
+	prepare_aes(ctx, ENCODE);
+	set_iv(ctx, iv, sizeof(iv));
+
+	for (n = 0; n < sizeof(extents) / sizeof(extents[0]); n++) {
+		if (extents[n].offset + extents[n].len > sz)
+			continue;
+		res = cipher_at(ctx, clear + extents[n].offset, out,
+				extents[n].len, extents[n].offset);
+		if (res != TEEC_SUCCESS ||
+		    memcmp(out, ciph + extents[n].offset, extents[n].len)) {
+			printf("CTR offset %zu: unexpected output 0x%x\n",
+			       extents[n].offset, res);
+			errors++;
+		}
+	}
+
+	/* Sequential ciphering resumes after the ciphered extent */
+	res = cipher_at(ctx, clear, out, 10, 100);
+	if (res == TEEC_SUCCESS)
+		cipher_buffer(ctx, (char *)clear + 110, out + 10, 30);
+	if (res != TEEC_SUCCESS || memcmp(out, ciph + 100, 40)) {
+		printf("CTR offset: sequential cipher does not resume\n");
+		errors++;
+	}
+
+	/* Base 0x..00ff..ff: 2nd block counter carries into byte 7 */
+	memset(iv, 0, sizeof(iv));
+	memset(iv + 8, 0xff, 8);
+	set_iv(ctx, iv, sizeof(iv));
+	cipher_buffer(ctx, (char *)clear, ref, sizeof(ref));
+	res = cipher_at(ctx, clear + TA_AES_BLOCK_SIZE, out,
+			2 * TA_AES_BLOCK_SIZE, TA_AES_BLOCK_SIZE);
+	if (res != TEEC_SUCCESS ||
+	    memcmp(out, ref + TA_AES_BLOCK_SIZE, 2 * TA_AES_BLOCK_SIZE)) {
+		printf("CTR offset: counter carry mismatch 0x%x\n", res);
+		errors++;
+	}
+
+	return errors;
+}
+
+TEEC_Result mac_set_key(struct test_ctx *ctx, uint32_t algo, const void *key,
+			size_t key_sz)
+{
+	TEEC_Operation op;
+	uint32_t origin;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT,
+					 TEEC_MEMREF_TEMP_INPUT,
+					 TEEC_NONE, TEEC_NONE);
+	op.params[0].value.a = algo;
+	op.params[1].tmpref.buffer = (void *)key;
+	op.params[1].tmpref.size = key_sz;
+
+	return TEEC_InvokeCommand(&ctx->sess, TA_AES_CMD_MAC_SET_KEY,
+				  &op, &origin);
+}
+
+TEEC_Result mac_init(struct test_ctx *ctx)
+{
+	TEEC_Operation op;
+	uint32_t origin;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_NONE, TEEC_NONE,
+					 TEEC_NONE, TEEC_NONE);
+
+	return TEEC_InvokeCommand(&ctx->sess, TA_AES_CMD_MAC_INIT,
+				  &op, &origin);
+}
+
+TEEC_Result mac_update(struct test_ctx *ctx, const void *in, size_t sz)
+{
+	TEEC_Operation op;
+	uint32_t origin;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT,
+					 TEEC_NONE, TEEC_NONE, TEEC_NONE);
+	op.params[0].tmpref.buffer = (void *)in;
+	op.params[0].tmpref.size = sz;
+
+	return TEEC_InvokeCommand(&ctx->sess, TA_AES_CMD_MAC_UPDATE,
+				  &op, &origin);
+}
+
+/* Invoke MAC_FINAL or the one-shot MAC command */
+static TEEC_Result mac_cmd(struct test_ctx *ctx, uint32_t cmd, const void *in,
+			   size_t sz, void *mac, size_t *mac_sz)
+{
+	TEEC_Operation op;
+	uint32_t origin;
+	TEEC_Result res;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT,
+					 TEEC_MEMREF_TEMP_OUTPUT,
+					 TEEC_NONE, TEEC_NONE);
+	op.params[0].tmpref.buffer = (void *)in;
+	op.params[0].tmpref.size = sz;
+	op.params[1].tmpref.buffer = mac;
+	op.params[1].tmpref.size = *mac_sz;
+
+	res = TEEC_InvokeCommand(&ctx->sess, cmd, &op, &origin);
+	*mac_sz = op.params[1].tmpref.size;
+	return res;
+}
+
+TEEC_Result mac_final(struct test_ctx *ctx, const void *in, size_t sz,
+		      void *mac, size_t *mac_sz)
+{
+	return mac_cmd(ctx, TA_AES_CMD_MAC_FINAL, in, sz, mac, mac_sz);
+}
+
+TEEC_Result mac_oneshot(struct test_ctx *ctx, const void *in, size_t sz,
+			void *mac, size_t *mac_sz)
+{
+	return mac_cmd(ctx, TA_AES_CMD_MAC, in, sz, mac, mac_sz);
+}
+
+/* RFC 4493 AES-CMAC example 3 and RFC 4231 HMAC-SHA256 test case 4 */
+static const uint8_t cmac_test_key[] = {
+	0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+	0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c,
+};
+static const uint8_t cmac_test_msg[] = {
+	0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96,
+	0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+	0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c,
+	0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+	0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11,
+	0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+	0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17,
+	0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10,
+};
+static const uint8_t cmac_test_mac[TA_AES_CMAC_SIZE] = {
+	0x51, 0xf0, 0xbe, 0xbf, 0x7e, 0x3b, 0x9d, 0x92,
+	0xfc, 0x49, 0x74, 0x17, 0x79, 0x36, 0x3c, 0xfe,
+};
+static const uint8_t hmac_test_mac[TA_AES_HMAC_SHA256_SIZE] = {
+	0x82, 0x55, 0x8a, 0x38, 0x9a, 0x44, 0x3c, 0x0e,
+	0xa4, 0xcc, 0x81, 0x98, 0x99, 0xf2, 0x08, 0x3a,
+	0x85, 0xf0, 0xfa, 0xa3, 0xe5, 0x78, 0xf8, 0x07,
+	0x7a, 0x2e, 0x3f, 0xf4, 0x67, 0x29, 0x66, 0x5b,
+};
+
+/* Check a MAC known answer both one-shot and split in two updates */
+static int run_mac_test(struct test_ctx *ctx, const char *name,
+			const void *msg, size_t sz, const uint8_t *ref,
+			size_t ref_sz)
+{
+	uint8_t mac[TA_AES_HMAC_SHA256_SIZE];
+	size_t mac_sz = sizeof(mac);
+	TEEC_Result res;
+
+	res = mac_oneshot(ctx, msg, sz, mac, &mac_sz);
+	if (res != TEEC_SUCCESS || mac_sz != ref_sz ||
+	    memcmp(mac, ref, ref_sz)) {
+		printf("%s: unexpected one-shot MAC 0x%x\n", name, res);
+		return -1;
+	}
+
+	mac_sz = sizeof(mac);
+	res = mac_init(ctx);
+	if (res == TEEC_SUCCESS)
+		res = mac_update(ctx, msg, sz / 3);
+	if (res == TEEC_SUCCESS)
+		res = mac_final(ctx, (const char *)msg + sz / 3,
+				sz - sz / 3, mac, &mac_sz);
+	if (res != TEEC_SUCCESS || mac_sz != ref_sz ||
+	    memcmp(mac, ref, ref_sz)) {
+		printf("%s: unexpected multi-part MAC 0x%x\n", name, res);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Run the AES-CMAC and HMAC-SHA256 known answers, return errors */
+int run_mac_tests(struct test_ctx *ctx)
+{
+	uint8_t key[25];
+	uint8_t msg[50];
+	size_t errors = 0;
+	TEEC_Result res;
+	size_t n;
+
+	res = mac_set_key(ctx, TA_AES_MAC_CMAC, cmac_test_key,
+			  sizeof(cmac_test_key));
+	if (res != TEEC_SUCCESS)
+		errx(1, "MAC_SET_KEY(CMAC) failed 0x%x", res);
+	errors += !!run_mac_test(ctx, "AES-CMAC", cmac_test_msg,
+				 sizeof(cmac_test_msg), cmac_test_mac,
+				 sizeof(cmac_test_mac));
+
+	for (n = 0; n < sizeof(key); n++)
+		key[n] = n + 1;
+	memset(msg, 0xcd, sizeof(msg));
+	res = mac_set_key(ctx, TA_AES_MAC_HMAC_SHA256, key, sizeof(key));
+	if (res != TEEC_SUCCESS)
+		errx(1, "MAC_SET_KEY(HMAC-SHA256) failed 0x%x", res);
+	errors += !!run_mac_test(ctx, "HMAC-SHA256", msg, sizeof(msg),
+				 hmac_test_mac, sizeof(hmac_test_mac));
+
+	/* Too short keys are rejected */
+	res = mac_set_key(ctx, TA_AES_MAC_HMAC_SHA256, key, 4);
+	if (res != TEEC_ERROR_BAD_PARAMETERS) {
+		printf("HMAC-SHA256: short key not rejected 0x%x\n", res);
+		errors++;
+	}
+
+	return errors;
+}
+
+/*
+ * One-shot MACs per second of AES_MAC_BENCH_MSG_SIZE bytes messages, with
+ * the operation kept keyed in the session and with a key setup per MAC.
+ */
+int mac_bench(void)
+{
+	static const struct {
+		uint32_t algo;
+		const char *name;
+		size_t key_sz;
+	} algos[] = {
+		{ TA_AES_MAC_CMAC, "cmac", TA_AES_SIZE_128BIT },
+		{ TA_AES_MAC_HMAC_SHA256, "hmac-sha256", TA_AES_SIZE_256BIT },
+	};
+	uint8_t msg[AES_MAC_BENCH_MSG_SIZE];
+	uint8_t mac[TA_AES_HMAC_SHA256_SIZE];
+	uint8_t key[TA_AES_SIZE_256BIT];
+	struct test_ctx ctx;
+	size_t mac_sz;
+	TEEC_Result res;
+	uint64_t ns[2];
+	uint64_t start;
+	size_t pass;
+	size_t n;
+	size_t i;
+
+	memset(msg, 0x5a, sizeof(msg));
+	memset(key, 0xa5, sizeof(key));
+
+	prepare_tee_session(&ctx);
+
+	printf("%-12s %14s %14s\n", "algo", "keyed MAC/s", "rekeyed MAC/s");
+
+	for (n = 0; n < sizeof(algos) / sizeof(algos[0]); n++) {
+		res = mac_set_key(&ctx, algos[n].algo, key, algos[n].key_sz);
+		if (res != TEEC_SUCCESS)
+			errx(1, "MAC_SET_KEY failed 0x%x", res);
+
+		for (pass = 0; pass < 2; pass++) {
+			start = now_ns();
+			for (i = 0; i < AES_MAC_BENCH_LOOPS; i++) {
+				res = TEEC_SUCCESS;
+				if (pass)
+					res = mac_set_key(&ctx, algos[n].algo,
+							  key,
+							  algos[n].key_sz);
+				mac_sz = sizeof(mac);
+				if (res == TEEC_SUCCESS)
+					res = mac_oneshot(&ctx, msg,
+							  sizeof(msg), mac,
+							  &mac_sz);
+				if (res != TEEC_SUCCESS)
+					errx(1, "MAC failed 0x%x", res);
+			}
+			ns[pass] = now_ns() - start;
+		}
+
+		printf("%-12s %14.0f %14.0f\n", algos[n].name,
+		       (double)AES_MAC_BENCH_LOOPS * 1000000000 / ns[0],
+		       (double)AES_MAC_BENCH_LOOPS * 1000000000 / ns[1]);
+	}
+
+	terminate_tee_session(&ctx);
+	return 0;
+}
+
+/* Invoke a key slot command, key may be NULL */
+static TEEC_Result key_slot_cmd(struct test_ctx *ctx, uint32_t cmd,
+				uint32_t id, uint32_t key_size,
+				const void *key, size_t key_sz)
+{
+	TEEC_Operation op;
+	uint32_t origin;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT,
+					 key ? TEEC_MEMREF_TEMP_INPUT :
+					       TEEC_NONE,
+					 TEEC_NONE, TEEC_NONE);
+	op.params[0].value.a = id;
+	op.params[0].value.b = key_size;
+	op.params[1].tmpref.buffer = (void *)key;
+	op.params[1].tmpref.size = key_sz;
+
+	return TEEC_InvokeCommand(&ctx->sess, cmd, &op, &origin);
+}
+
+TEEC_Result key_generate(struct test_ctx *ctx, uint32_t id, size_t key_sz)
+{
+	return key_slot_cmd(ctx, TA_AES_CMD_KEY_GENERATE, id, key_sz, NULL, 0);
+}
+
+TEEC_Result key_import(struct test_ctx *ctx, uint32_t id, const void *key,
+		       size_t key_sz)
+{
+	return key_slot_cmd(ctx, TA_AES_CMD_KEY_IMPORT, id, 0, key, key_sz);
+}
+
+TEEC_Result key_bind(struct test_ctx *ctx, uint32_t id)
+{
+	return key_slot_cmd(ctx, TA_AES_CMD_KEY_BIND, id, 0, NULL, 0);
+}
+
+TEEC_Result key_delete(struct test_ctx *ctx, uint32_t id)
+{
+	return key_slot_cmd(ctx, TA_AES_CMD_KEY_DELETE, id, 0, NULL, 0);
+}
+
+/* Encode with AES-CBC-256 from a zero IV under the given key */
+static void cbc256_encode(struct test_ctx *ctx, char *key, const char *clear,
+			  char *out, size_t sz)
+{
+	char iv[AES_TEST_KEY_SIZE] = { 0 };
+
+	prepare_aes_algo(ctx, TA_AES_ALGO_CBC, TA_AES_SIZE_256BIT, ENCODE);
+	set_key(ctx, key, TA_AES_SIZE_256BIT);
+	set_iv(ctx, iv, sizeof(iv));
+	cipher_buffer(ctx, (char *)clear, out, sz);
+}
+
+/*
+ * Store the test key in a slot and check a new session bound to it
+ * ciphers like with the raw key (ciph, from clear with a zero IV). Then
+ * rebind the slot after another session imports and generates it again,
+ * checking against a known key and the all-zero dummy key, and delete the
+ * slot, from the bound session then from another one. Return errors.
+ */
+int run_key_slot_tests(struct test_ctx *ctx, const char *key,
+		       const char *clear, const char *ciph, size_t sz)
+{
+	char iv[AES_TEST_KEY_SIZE] = { 0 };
+	char key256[TA_AES_SIZE_256BIT];
+	struct test_ctx slot_ctx;
+	size_t errors = 0;
+	TEEC_Result res;
+	char *zero_out;
+	char *back;
+	char *ref;
+	char *out;
+
+	out = malloc(sz);
+	back = malloc(sz);
+	ref = malloc(sz);
+	zero_out = malloc(sz);
+	if (!out || !back || !ref || !zero_out)
+		errx(1, "Out of memory");
+
+	prepare_tee_session(&slot_ctx);
+
+	/* References from a known 256-bit key and from the zero key */
+	memset(key256, 0x3c, sizeof(key256));
+	cbc256_encode(&slot_ctx, key256, clear, ref, sz);
+	memset(key256, 0, sizeof(key256));
+	cbc256_encode(&slot_ctx, key256, clear, zero_out, sz);
+	memset(key256, 0x3c, sizeof(key256));
+
+	res = key_import(ctx, AES_TEST_KEY_SLOT, key, AES_TEST_KEY_SIZE);
+	if (res != TEEC_SUCCESS)
+		errx(1, "Key slot import failed 0x%x", res);
+
+	prepare_aes(&slot_ctx, ENCODE);
+	res = key_bind(&slot_ctx, AES_TEST_KEY_SLOT);
+	if (res != TEEC_SUCCESS)
+		errx(1, "Key slot bind failed 0x%x", res);
+	set_iv(&slot_ctx, iv, sizeof(iv));
+	cipher_buffer(&slot_ctx, (char *)clear, out, sz);
+	if (memcmp(out, ciph, sz)) {
+		printf("Imported key slot ciphers differently\n");
+		errors++;
+	}
+
+	res = key_import(ctx, AES_TEST_KEY_SLOT, key256, sizeof(key256));
+	if (res != TEEC_SUCCESS)
+		errx(1, "Key slot import failed 0x%x", res);
+
+	/* Bound slot is kept open: rebind after it is imported again */
+	prepare_aes_algo(&slot_ctx, TA_AES_ALGO_CBC, TA_AES_SIZE_256BIT,
+			 ENCODE);
+	res = key_bind(&slot_ctx, AES_TEST_KEY_SLOT);
+	if (res != TEEC_SUCCESS)
+		errx(1, "Key slot bind failed 0x%x", res);
+	set_iv(&slot_ctx, iv, sizeof(iv));
+	cipher_buffer(&slot_ctx, (char *)clear, out, sz);
+	if (memcmp(out, ref, sz) || !memcmp(out, zero_out, sz)) {
+		printf("Reimported key slot ciphers differently\n");
+		errors++;
+	}
+
+	/* A 256-bit key does not fit a 128-bit operation */
+	prepare_aes(&slot_ctx, ENCODE);
+	res = key_bind(&slot_ctx, AES_TEST_KEY_SLOT);
+	if (res != TEEC_ERROR_BAD_STATE) {
+		printf("Key slot bound to a wrong size operation 0x%x\n", res);
+		errors++;
+	}
+
+	res = key_generate(ctx, AES_TEST_KEY_SLOT, TA_AES_SIZE_256BIT);
+	if (res != TEEC_SUCCESS)
+		errx(1, "Key slot generate failed 0x%x", res);
+
+	prepare_aes_algo(&slot_ctx, TA_AES_ALGO_CBC, TA_AES_SIZE_256BIT,
+			 ENCODE);
+	res = key_bind(&slot_ctx, AES_TEST_KEY_SLOT);
+	if (res != TEEC_SUCCESS)
+		errx(1, "Key slot bind failed 0x%x", res);
+	set_iv(&slot_ctx, iv, sizeof(iv));
+	cipher_buffer(&slot_ctx, (char *)clear, out, sz);
+	prepare_aes_algo(&slot_ctx, TA_AES_ALGO_CBC, TA_AES_SIZE_256BIT,
+			 DECODE);
+	set_iv(&slot_ctx, iv, sizeof(iv));
+	cipher_buffer(&slot_ctx, out, back, sz);
+	if (!memcmp(out, ref, sz) || !memcmp(out, zero_out, sz) ||
+	    memcmp(back, clear, sz)) {
+		printf("Generated key slot round trip failed\n");
+		errors++;
+	}
+
+	/* Deleting the bound slot unloads its key from the operations */
+	res = key_delete(&slot_ctx, AES_TEST_KEY_SLOT);
+	if (res != TEEC_SUCCESS)
+		errx(1, "Key slot delete failed 0x%x", res);
+	prepare_aes_algo(&slot_ctx, TA_AES_ALGO_CBC, TA_AES_SIZE_256BIT,
+			 ENCODE);
+	set_iv(&slot_ctx, iv, sizeof(iv));
+	cipher_buffer(&slot_ctx, (char *)clear, back, sz);
+	if (!memcmp(out, back, sz)) {
+		printf("Deleted key slot still loaded\n");
+		errors++;
+	}
+
+	/* Another session deletes a slot bound here, the copy stays */
+	res = key_import(ctx, AES_TEST_KEY_SLOT, key256, sizeof(key256));
+	if (res == TEEC_SUCCESS)
+		res = key_bind(&slot_ctx, AES_TEST_KEY_SLOT);
+	if (res == TEEC_SUCCESS)
+		res = key_delete(ctx, AES_TEST_KEY_SLOT);
+	if (res != TEEC_SUCCESS) {
+		printf("Key slot bound elsewhere not deleted 0x%x\n", res);
+		errors++;
+	}
+	set_iv(&slot_ctx, iv, sizeof(iv));
+	cipher_buffer(&slot_ctx, (char *)clear, out, sz);
+	if (memcmp(out, ref, sz)) {
+		printf("Key slot copy lost on delete elsewhere\n");
+		errors++;
+	}
+	terminate_tee_session(&slot_ctx);
+
+	res = key_bind(ctx, AES_TEST_KEY_SLOT);
+	if (res != TEEC_ERROR_ITEM_NOT_FOUND) {
+		printf("Deleted key slot still bound 0x%x\n", res);
+		errors++;
+	}
+
+	free(out);
+	free(back);
+	free(ref);
+	free(zero_out);
+	return errors;
+}
+
+/*
+ * Time a new session up to its first ciphered block, loading the key
+ * either from the client with TA_AES_CMD_SET_KEY or from a key slot.
+ */
+int key_bench(void)
+{
+	char key[AES_TEST_KEY_SIZE];
+	char iv[AES_TEST_KEY_SIZE];
+	char block[TA_AES_BLOCK_SIZE];
+	struct test_ctx ctx;
+	uint64_t ns[2];
+	uint64_t start;
+	TEEC_Result res;
+	size_t pass;
+	size_t n;
+
+	memset(key, 0xa5, sizeof(key));
+	memset(iv, 0, sizeof(iv));
+	memset(block, 0x5a, sizeof(block));
+
+	prepare_tee_session(&ctx);
+	res = key_import(&ctx, AES_TEST_KEY_SLOT, key, sizeof(key));
+	if (res != TEEC_SUCCESS)
+		errx(1, "Key slot import failed 0x%x", res);
+	terminate_tee_session(&ctx);
+
+	for (pass = 0; pass < 2; pass++) {
+		start = now_ns();
+		for (n = 0; n < AES_KEY_BENCH_LOOPS; n++) {
+			prepare_tee_session(&ctx);
+			prepare_aes(&ctx, ENCODE);
+			if (!pass) {
+				set_key(&ctx, key, sizeof(key));
+			} else {
+				res = key_bind(&ctx, AES_TEST_KEY_SLOT);
+				if (res != TEEC_SUCCESS)
+					errx(1, "Key slot bind failed 0x%x",
+					     res);
+			}
+			set_iv(&ctx, iv, sizeof(iv));
+			cipher_buffer(&ctx, block, block, sizeof(block));
+			terminate_tee_session(&ctx);
+		}
+		ns[pass] = now_ns() - start;
+	}
+
+	prepare_tee_session(&ctx);
+	key_delete(&ctx, AES_TEST_KEY_SLOT);
+	terminate_tee_session(&ctx);
+
+	printf("Open session + first cipher, %d loops\n", AES_KEY_BENCH_LOOPS);
+	printf("%-10s %12.1f us\n", "set-key",
+	       ns[0] / 1000.0 / AES_KEY_BENCH_LOOPS);
+	printf("%-10s %12.1f us\n", "key-slot",
+	       ns[1] / 1000.0 / AES_KEY_BENCH_LOOPS);
+	printf("%-10s %12.1f us\n", "delta",
+	       ((double)ns[0] - ns[1]) / 1000.0 / AES_KEY_BENCH_LOOPS);
+
+	return 0;
+}
+
+/* Read up to sz bytes, short only at end of file. Return -1 on error */
+static ssize_t read_full(int fd, void *buf, size_t sz)
+{
+	size_t done = 0;
+	ssize_t n;
+
+	while (done < sz) {
+		n = read(fd, (char *)buf + done, sz - done);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0)
+			return -1;
+		if (!n)
+			break;
+		done += n;
+	}
+
+	return done;
+}
+
+static int write_full(int fd, const void *buf, size_t sz)
+{
+	size_t done = 0;
+	ssize_t n;
+
+	while (done < sz) {
+		n = write(fd, (const char *)buf + done, sz - done);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0)
+			return -1;
+		done += n;
+	}
+
+	return 0;
+}
+
+static void *stream_reader(void *arg)
+{
+	struct stream_ctx *st = arg;
+	size_t slot = 0;
+	ssize_t n;
+	int last;
+
+	do {
+		pthread_mutex_lock(&st->lock);
+		while (st->filled[slot] && !st->abort)
+			pthread_cond_wait(&st->cond, &st->lock);
+		last = st->abort;
+		pthread_mutex_unlock(&st->lock);
+		if (last)
+			break;
+
+		n = read_full(st->in_fd, st->ring->shm[slot].buffer,
+			      AES_STREAM_CHUNK_SIZE);
+		last = n < AES_STREAM_CHUNK_SIZE;
+
+		pthread_mutex_lock(&st->lock);
+		if (n < 0) {
+			st->read_err = errno;
+			n = 0;
+		}
+		st->len[slot] = n;
+		st->last[slot] = last;
+		st->filled[slot] = 1;
+		pthread_cond_broadcast(&st->cond);
+		pthread_mutex_unlock(&st->lock);
+
+		slot = (slot + 1) % st->ring->count;
+	} while (!last);
+
+	return NULL;
+}
+
+/*
+ * Cipher the input file into the output file chunk by chunk. Chaining
+ * state stays in the TA operation across TA_AES_CMD_CIPHER calls and the
+ * last chunk goes through TA_AES_CMD_CIPHER_FINAL. Return 0 on success.
+ */
+static int stream_cipher(struct stream_ctx *st, int out_fd,
+			 size_t *total, uint64_t *stall_ns)
+{
+	TEEC_SharedMemory *shm;
+	TEEC_Result res;
+	uint64_t start;
+	size_t out_sz;
+	size_t slot = 0;
+	int last;
+
+	*total = 0;
+	*stall_ns = 0;
+
+	do {
+		start = now_ns();
+		pthread_mutex_lock(&st->lock);
+		while (!st->filled[slot])
+			pthread_cond_wait(&st->cond, &st->lock);
+		last = st->last[slot];
+		pthread_mutex_unlock(&st->lock);
+		*stall_ns += now_ns() - start;
+
+		if (st->read_err) {
+			warnx("Cannot read input: %s", strerror(st->read_err));
+			return -1;
+		}
+
+		shm = &st->ring->shm[slot];
+		res = cipher_shm_cmd(st->tee, last ? TA_AES_CMD_CIPHER_FINAL :
+						     TA_AES_CMD_CIPHER,
+				     shm, 0, st->len[slot], &out_sz);
+		if (res != TEEC_SUCCESS) {
+			warnx("Cipher chunk failed 0x%x%s", res,
+			      last ? " (ECB/CBC need block aligned input)" :
+				     "");
+			return -1;
+		}
+
+		if (write_full(out_fd, shm->buffer, out_sz)) {
+			warn("Cannot write output");
+			return -1;
+		}
+		*total += st->len[slot];
+
+		pthread_mutex_lock(&st->lock);
+		st->filled[slot] = 0;
+		pthread_cond_broadcast(&st->cond);
+		pthread_mutex_unlock(&st->lock);
+
+		slot = (slot + 1) % st->ring->count;
+	} while (!last);
+
+	return 0;
+}
+
+/* Parse a hex string into buf, return the byte count or -1 */
+static int parse_hex(const char *str, char *buf, size_t max)
+{
+	size_t len = strlen(str);
+	unsigned int byte;
+	size_t n;
+
+	if (len % 2 || len / 2 > max)
+		return -1;
+
+	for (n = 0; n < len / 2; n++) {
+		if (sscanf(str + 2 * n, "%2x", &byte) != 1)
+			return -1;
+		buf[n] = byte;
+	}
+
+	return len / 2;
+}
+
+static int parse_algo(const char *str, uint32_t *algo)
+{
+	if (!strcmp(str, "ecb"))
+		*algo = TA_AES_ALGO_ECB;
+	else if (!strcmp(str, "cbc"))
+		*algo = TA_AES_ALGO_CBC;
+	else if (!strcmp(str, "ctr"))
+		*algo = TA_AES_ALGO_CTR;
+	else
+		return -1;
+
+	return 0;
+}
+
+/*
+ * tpm_aes stream <encode|decode> <ecb|cbc|ctr> <in> <out> [key [iv]]
+ *
+ * Cipher a file of any size through the TA in AES_STREAM_CHUNK_SIZE
+ * chunks, reading ahead into a ring of shared memory buffers while the TA
+ * ciphers in place. Key and IV are hex strings, default to the test ones.
+ */
+int stream_file(int argc, char *argv[])
+{
+	struct stream_ctx st;
+	struct shm_ring ring;
+	struct test_ctx ctx;
+	pthread_t reader;
+	char key[TA_AES_SIZE_256BIT];
+	char iv[TA_AES_BLOCK_SIZE];
+	int key_sz = AES_TEST_KEY_SIZE;
+	uint64_t stall_ns;
+	uint64_t start;
+	uint64_t ns;
+	uint32_t algo;
+	size_t total;
+	int encode;
+	int out_fd;
+	int ret;
+
+	if (argc < 6 ||
+	    (strcmp(argv[2], "encode") && strcmp(argv[2], "decode")) ||
+	    parse_algo(argv[3], &algo))
+		errx(1, "usage: %s stream <encode|decode> <ecb|cbc|ctr> "
+		     "<in> <out> [key [iv]]", argv[0]);
+	encode = !strcmp(argv[2], "encode");
+
+	memset(key, 0xa5, sizeof(key));
+	memset(iv, 0, sizeof(iv));
+	if (argc > 6) {
+		key_sz = parse_hex(argv[6], key, sizeof(key));
+		if (key_sz != TA_AES_SIZE_128BIT &&
+		    key_sz != TA_AES_SIZE_256BIT)
+			errx(1, "Key shall be 16 or 32 hex bytes");
+	}
+	if (argc > 7 && parse_hex(argv[7], iv, sizeof(iv)) != sizeof(iv))
+		errx(1, "IV shall be 16 hex bytes");
+
+	memset(&st, 0, sizeof(st));
+	st.in_fd = open(argv[4], O_RDONLY);
+	if (st.in_fd < 0)
+		err(1, "Cannot open %s", argv[4]);
+	out_fd = open(argv[5], O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (out_fd < 0)
+		err(1, "Cannot open %s", argv[5]);
+
+	prepare_tee_session(&ctx);
+	prepare_aes_algo(&ctx, algo, key_sz, encode);
+	set_key(&ctx, key, key_sz);
+	set_iv(&ctx, iv, sizeof(iv));
+
+	/* Room for a block held back by previous updates */
+	if (init_shm_ring(&ctx, &ring,
+			  AES_STREAM_CHUNK_SIZE + TA_AES_BLOCK_SIZE, 0))
+		errx(1, "Cannot allocate shared memory ring");
+
+	st.tee = &ctx;
+	st.ring = &ring;
+	pthread_mutex_init(&st.lock, NULL);
+	pthread_cond_init(&st.cond, NULL);
+
+	start = now_ns();
+	if (pthread_create(&reader, NULL, stream_reader, &st))
+		errx(1, "Cannot create reader thread");
+	ret = stream_cipher(&st, out_fd, &total, &stall_ns);
+	if (ret) {
+		/* Reader may wait for a free slot */
+		pthread_mutex_lock(&st.lock);
+		st.abort = 1;
+		pthread_cond_broadcast(&st.cond);
+		pthread_mutex_unlock(&st.lock);
+	}
+	pthread_join(reader, NULL);
+	ns = now_ns() - start;
+
+	if (!ret)
+		printf("%zu bytes in %.3f s: %.2f MB/s, input stalls %.3f s\n",
+		       total, ns / 1e9, mb_per_sec(total, ns),
+		       stall_ns / 1e9);
+
+	release_shm_ring(&ring);
+	pthread_cond_destroy(&st.cond);
+	pthread_mutex_destroy(&st.lock);
+	terminate_tee_session(&ctx);
+	close(st.in_fd);
+	if (close(out_fd))
+		ret = -1;
+	return ret ? 1 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+	struct test_ctx ctx;
+	char key[AES_TEST_KEY_SIZE];
+	char key256[AES_TEST_KEY_SIZE * 2];
+	char iv[AES_TEST_KEY_SIZE];
+	char clear[AES_TEST_BUFFER_SIZE];
+	char ciph[AES_TEST_BUFFER_SIZE];
+	char temp[AES_TEST_BUFFER_SIZE];
+	struct aes_batch_desc desc[AES_TEST_RECORD_COUNT];
+	uint32_t hits;
+	uint32_t misses;
+	size_t n;
+
+	if (argc > 1 && !strcmp(argv[1], "memref-bench"))
+		return memref_bench();
+	if (argc > 1 && !strcmp(argv[1], "stream"))
+		return stream_file(argc, argv);
+	if (argc > 1 && !strcmp(argv[1], "key-bench"))
+		return key_bench();
+	if (argc > 1 && !strcmp(argv[1], "bench"))
+		return mt_bench(argc, argv);
+	if (argc > 1 && !strcmp(argv[1], "mac-bench"))
+		return mac_bench();
+
+	printf("Prepare session with the TA\n");
+	prepare_tee_session(&ctx);
+
+	printf("Prepare encode operation\n");
+	prepare_aes(&ctx, ENCODE);
+
+	printf("Load key in TA\n");
+	memset(key, 0xa5, sizeof(key)); /* Load some dummy value */
+	set_key(&ctx, key, AES_TEST_KEY_SIZE);
+
+	printf("Reset ciphering operation in TA (provides the initial vector)\n");
+	memset(iv, 0, sizeof(iv)); /* Load some dummy value */
+	set_iv(&ctx, iv, AES_TEST_KEY_SIZE);
+
+	printf("Encore buffer from TA\n");
+	memset(clear, 0x5a, sizeof(clear)); /* Load some dummy value */
+	cipher_buffer(&ctx, clear, ciph, AES_TEST_BUFFER_SIZE);
+
+	printf("Prepare decode operation\n");
+	prepare_aes(&ctx, DECODE);
+
+	printf("Load key in TA\n");
+	memset(key, 0xa5, sizeof(key)); /* Load some dummy value */
+	set_key(&ctx, key, AES_TEST_KEY_SIZE);
+
+	printf("Reset ciphering operation in TA (provides the initial vector)\n");
+	memset(iv, 0, sizeof(iv)); /* Load some dummy value */
+	set_iv(&ctx, iv, AES_TEST_KEY_SIZE);
+
+	printf("Decode buffer from TA\n");
+	memset(clear, 0x5a, sizeof(clear)); /* Load some dummy value */
+	cipher_buffer(&ctx, ciph, temp, AES_TEST_BUFFER_SIZE);
+
+	/* Check decoded is the clear content */
+	if (memcmp(clear, temp, AES_TEST_BUFFER_SIZE))
+		printf("Clear text and decoded text differ => ERROR\n");
+	else
+		printf("Clear text and decoded text match\n");
+
+	printf("Prepare encode operation again (key kept by the TA)\n");
+	prepare_aes(&ctx, ENCODE);
+
+	printf("Reset ciphering operation in TA (provides the initial vector)\n");
+	set_iv(&ctx, iv, AES_TEST_KEY_SIZE);
+
+	printf("Encode buffer from TA\n");
+	cipher_buffer(&ctx, clear, temp, AES_TEST_BUFFER_SIZE);
+
+	/* Check the reused operation still holds the loaded key */
+	if (memcmp(ciph, temp, AES_TEST_BUFFER_SIZE))
+		printf("Cached operation ciphered differently => ERROR\n");
+	else
+		printf("Cached operation ciphered the same\n");
+
+	printf("Encode %d records in a single batch from TA\n",
+	       AES_TEST_RECORD_COUNT);
+	for (n = 0; n < AES_TEST_RECORD_COUNT; n++) {
+		desc[n].offset = n * AES_TEST_RECORD_SIZE;
+		desc[n].length = AES_TEST_RECORD_SIZE;
+		memcpy(desc[n].iv, iv, sizeof(desc[n].iv));
+	}
+	memcpy(temp, clear, AES_TEST_BUFFER_SIZE);
+	cipher_batch(&ctx, desc, AES_TEST_RECORD_COUNT, temp,
+		     AES_TEST_BUFFER_SIZE);
+
+	/* Same IV and clear content: each record matches the first one */
+	for (n = 0; n < AES_TEST_RECORD_COUNT; n++)
+		if (memcmp(ciph, temp + n * AES_TEST_RECORD_SIZE,
+			   AES_TEST_RECORD_SIZE))
+			break;
+	if (n != AES_TEST_RECORD_COUNT)
+		printf("Batch record %zu differs => ERROR\n", n);
+	else
+		printf("Batch records match\n");
+
+	printf("Load a 256-bit key, then prepare the 128-bit operation again\n");
+	prepare_aes_algo(&ctx, TA_AES_ALGO_CTR, TA_AES_SIZE_256BIT, ENCODE);
+	memset(key256, 0x3c, sizeof(key256));
+	set_key(&ctx, key256, sizeof(key256));
+	prepare_aes(&ctx, ENCODE);
+	set_iv(&ctx, iv, AES_TEST_KEY_SIZE);
+	cipher_buffer(&ctx, clear, temp, AES_TEST_BUFFER_SIZE);
+
+	/* The 128-bit operation shall not keep the older 128-bit key */
+	if (!memcmp(ciph, temp, AES_TEST_BUFFER_SIZE))
+		printf("Cached operation kept a stale key => ERROR\n");
+	else
+		printf("Cached operation dropped the stale key\n");
+
+	printf("Run AES-GCM known answer tests\n");
+	if (run_gcm_tests(&ctx))
+		printf("AES-GCM known answer tests => ERROR\n");
+	else
+		printf("AES-GCM known answer tests pass\n");
+
+	printf("Run AES-XTS sector tests\n");
+	if (run_xts_tests(&ctx))
+		printf("AES-XTS sector tests => ERROR\n");
+	else
+		printf("AES-XTS sector tests pass\n");
+
+	printf("Run persistent key slot tests\n");
+	memset(iv, 0, sizeof(iv));
+	prepare_aes(&ctx, ENCODE);
+	set_key(&ctx, key, AES_TEST_KEY_SIZE);
+	set_iv(&ctx, iv, AES_TEST_KEY_SIZE);
+	cipher_buffer(&ctx, clear, ciph, AES_TEST_BUFFER_SIZE);
+	if (run_key_slot_tests(&ctx, key, clear, ciph, AES_TEST_BUFFER_SIZE))
+		printf("Persistent key slot tests => ERROR\n");
+	else
+		printf("Persistent key slot tests pass\n");
+
+	printf("Run CTR cipher at offset tests\n");
+	if (run_ctr_offset_tests(&ctx, clear, ciph, AES_TEST_BUFFER_SIZE))
+		printf("CTR cipher at offset tests => ERROR\n");
+	else
+		printf("CTR cipher at offset tests pass\n");
+
+	printf("Run MAC known answer tests\n");
+	if (run_mac_tests(&ctx))
+		printf("MAC known answer tests => ERROR\n");
+	else
+		printf("MAC known answer tests pass\n");
+
+	get_stats(&ctx, &hits, &misses);
+	printf("Operation cache: %u hits, %u misses\n", hits, misses);
 
 	terminate_tee_session(&ctx);
 	return 0;
@@ -25,6 +25,8 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 #include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
 
 #include <tee_internal_api.h>
 #include <tee_internal_api_extensions.h>
@@ -36,12 +38,44 @@
 #define AES256_KEY_BIT_SIZE		256
 #define AES256_KEY_BYTE_SIZE		(AES256_KEY_BIT_SIZE / 8)
 
+/* HMAC-SHA256 key sizes supported by the GP TEE Internal Core API */
+#define HMAC_SHA256_KEY_MIN_SIZE	(192 / 8)
+#define HMAC_SHA256_KEY_MAX_SIZE	(1024 / 8)
+
+/*
+ * Number of AES operations kept alive in a session. A client flipping
+ * between encode and decode, or between a couple of AES flavours, hits
+ * an already allocated and keyed operation on TA_AES_CMD_PREPARE.
+ */
+#define AES_OP_CACHE_SLOTS		4
+
+/* Secure storage object ID of a persistent key slot: prefix + slot ID */
+#define AES_KEY_ID_PREFIX		"aes-key-"
+#define AES_KEY_ID_SIZE			(sizeof(AES_KEY_ID_PREFIX) - 1 + \
+					 sizeof(uint32_t))
+
+/*
+ * An operation handle kept in the session cache, identified by its
+ * (algo, key size, mode) configuration. key_gen tracks which client key
+ * is loaded in the operation: 0 when only the dummy key is loaded.
+ */
+struct aes_op_slot {
+	uint32_t algo;			/* AES flavour */
+	uint32_t mode;			/* Encode or decode */
+	uint32_t key_size;		/* AES key size in byte */
+	uint32_t key_gen;		/* Generation of the loaded key */
+	TEE_OperationHandle op_handle;	/* AES ciphering operation */
+};
+
 /*
  * Ciphering context: each opened session relates to a cipehring operation.
  * - configure the AES flavour from a command.
  * - load key from a command (here the key is provided by the REE)
  * - reset init vector (here IV is provided by the REE)
  * - cipher a buffer frame (here input and output buffers are non-secure)
+ *
+ * algo/mode/key_size/op_handle reflect the operation selected by the last
+ * TA_AES_CMD_PREPARE, which is one of the cached slots.
  */
 struct aes_cipher {
 	uint32_t algo;			/* AES flavour */
@@ -49,6 +83,29 @@ struct aes_cipher {
 	uint32_t key_size;		/* AES key size in byte */
 	TEE_OperationHandle op_handle;	/* AES ciphering operation */
 	TEE_ObjectHandle key_handle;	/* transient object to load the key */
+	TEE_ObjectHandle key2_handle;	/* second key of XTS */
+	TEE_ObjectHandle dummy_handle;	/* transient object for dummy keys */
+	TEE_ObjectHandle dummy2_handle;	/* second dummy key of XTS */
+	bool key_stored;		/* key_handle holds a key slot copy */
+	uint32_t stored_id;		/* ID of the slot in key_handle */
+	TEE_ObjectHandle key_obj;	/* session key: key or stored handle */
+	uint32_t key_gen;		/* Generation of key in key_obj */
+	uint32_t key_len;		/* Size of key in key_obj */
+	bool key_dual;			/* key2_handle holds an XTS key */
+	uint8_t ctr_base[TA_AES_BLOCK_SIZE];	/* CTR counter at offset 0 */
+	bool ctr_base_set;		/* ctr_base loaded by SET_IV */
+	uint32_t tag_len;		/* AE tag length in bits */
+	bool ae_active;			/* AE operation initialized */
+	bool ae_payload;		/* AE operation got payload data */
+	struct aes_op_slot cache[AES_OP_CACHE_SLOTS];
+	struct aes_op_slot *slot;	/* Slot selected by last PREPARE */
+	uint32_t next_victim;		/* Next slot to recycle */
+	uint32_t cache_hits;		/* PREPARE reusing a cached operation */
+	uint32_t cache_misses;		/* PREPARE allocating an operation */
+	TEE_OperationHandle mac_op;	/* Keyed MAC operation */
+	uint32_t mac_algo;		/* MAC algorithm of mac_op */
+	uint32_t mac_max_bits;		/* Max key size of mac_op in bits */
+	bool mac_active;		/* MAC initialized, not finalized */
 };
 
 /*
@@ -66,6 +123,12 @@ static TEE_Result ta2tee_algo_id(uint32_t param, uint32_t *algo)
 	case TA_AES_ALGO_CTR:
 		*algo = TEE_ALG_AES_CTR;
 		return TEE_SUCCESS;
+	case TA_AES_ALGO_GCM:
+		*algo = TEE_ALG_AES_GCM;
+		return TEE_SUCCESS;
+	case TA_AES_ALGO_XTS:
+		*algo = TEE_ALG_AES_XTS;
+		return TEE_SUCCESS;
 	default:
 		EMSG("Invalid algo %u", param);
 		return TEE_ERROR_BAD_PARAMETERS;
@@ -83,6 +146,17 @@ static TEE_Result ta2tee_key_size(uint32_t param, uint32_t *key_size)
 		return TEE_ERROR_BAD_PARAMETERS;
 	}
 }
+static TEE_Result ta2tee_tag_len(uint32_t param, uint32_t *tag_len)
+{
+	if (param < TA_AES_GCM_TAG_MIN_BITS ||
+	    param > TA_AES_GCM_TAG_MAX_BITS || param % 8) {
+		EMSG("Invalid tag length %u", param);
+		return TEE_ERROR_BAD_PARAMETERS;
+	}
+
+	*tag_len = param;
+	return TEE_SUCCESS;
+}
 static TEE_Result ta2tee_mode_id(uint32_t param, uint32_t *mode)
 {
 	switch (param) {
@@ -98,10 +172,253 @@ static TEE_Result ta2tee_mode_id(uint32_t param, uint32_t *mode)
 	}
 }
 
+/*
+ * Cipher commands only apply to a prepared operation of a non-authenticated
+ * AES flavour.
+ */
+static bool cipher_ready(struct aes_cipher *sess)
+{
+	return sess->op_handle != TEE_HANDLE_NULL &&
+	       sess->algo != TEE_ALG_AES_GCM;
+}
+
+/*
+ * Get a session transient object ready to be loaded with a key, allocating
+ * it on first use. Objects are sized for the largest AES key.
+ */
+static TEE_Result reset_key_object(TEE_ObjectHandle *obj)
+{
+	TEE_Result res;
+
+	if (*obj == TEE_HANDLE_NULL) {
+		res = TEE_AllocateTransientObject(TEE_TYPE_AES,
+						  AES256_KEY_BIT_SIZE, obj);
+		if (res != TEE_SUCCESS) {
+			EMSG("Failed to allocate transient object");
+			*obj = TEE_HANDLE_NULL;
+			return res;
+		}
+	}
+
+	TEE_ResetTransientObject(*obj);
+	return TEE_SUCCESS;
+}
+
+/* Load key material in a session transient object */
+static TEE_Result populate_key(TEE_ObjectHandle *obj, const void *key,
+			       uint32_t key_sz)
+{
+	TEE_Attribute attr;
+	TEE_Result res;
+
+	res = reset_key_object(obj);
+	if (res != TEE_SUCCESS)
+		return res;
+
+	TEE_InitRefAttribute(&attr, TEE_ATTR_SECRET_VALUE, key, key_sz);
+
+	res = TEE_PopulateTransientObject(*obj, &attr, 1);
+	if (res != TEE_SUCCESS)
+		EMSG("TEE_PopulateTransientObject failed, %x", res);
+
+	return res;
+}
+
+/* Load the key of an opened key slot in a session transient object */
+static TEE_Result copy_key(TEE_ObjectHandle *obj, TEE_ObjectHandle src)
+{
+	TEE_Result res;
+
+	res = reset_key_object(obj);
+	if (res != TEE_SUCCESS)
+		return res;
+
+	res = TEE_CopyObjectAttributes1(*obj, src);
+	if (res != TEE_SUCCESS)
+		EMSG("TEE_CopyObjectAttributes1 failed, %x", res);
+
+	return res;
+}
+
+/* Load key objects into an operation, XTS takes two keys */
+static TEE_Result set_op_keys(struct aes_op_slot *slot, TEE_ObjectHandle key,
+			      TEE_ObjectHandle key2)
+{
+	TEE_Result res;
+
+	if (slot->algo == TEE_ALG_AES_XTS)
+		res = TEE_SetOperationKey2(slot->op_handle, key, key2);
+	else
+		res = TEE_SetOperationKey(slot->op_handle, key);
+	if (res != TEE_SUCCESS)
+		EMSG("TEE_SetOperationKey failed %x", res);
+
+	return res;
+}
+
+/*
+ * Start a new generation of the session key: cached operations loaded with
+ * an older one no longer match it. The counter is never reset, 0 stands for
+ * the dummy key.
+ */
+static void next_key_gen(struct aes_cipher *sess)
+{
+	sess->key_gen++;
+	if (!sess->key_gen)
+		sess->key_gen++;
+}
+
+/* Whether the session key can be loaded in a cached operation */
+static bool session_key_fits(struct aes_cipher *sess, struct aes_op_slot *slot)
+{
+	return sess->key_obj != TEE_HANDLE_NULL &&
+	       sess->key_len == slot->key_size &&
+	       sess->key_dual == (slot->algo == TEE_ALG_AES_XTS);
+}
+
+/* Load the session key into a cached operation */
+static TEE_Result load_session_key(struct aes_cipher *sess,
+				   struct aes_op_slot *slot)
+{
+	TEE_Result res;
+
+	res = set_op_keys(slot, sess->key_obj, sess->key2_handle);
+	if (res != TEE_SUCCESS)
+		return res;
+
+	slot->key_gen = sess->key_gen;
+
+	return TEE_SUCCESS;
+}
+
+/*
+ * Load a dummy key into a newly allocated operation.
+ *
+ * When loading a key in the cipher session, set_aes_key() will reset
+ * the operation and load a key. But we cannot reset and operation that
+ * has no key yet (GPD TEE Internal Core API Specification – Public
+ * Release v1.1.1, section 6.2.5 TEE_ResetOperation). In consequence, we
+ * load a dummy key in the operation so that operation can be reset when
+ * updating the key.
+ */
+static TEE_Result set_dummy_key(struct aes_cipher *sess,
+				struct aes_op_slot *slot)
+{
+	/* XTS rejects identical keys: second dummy key differs */
+	static const uint8_t dummy_key[AES256_KEY_BYTE_SIZE];
+	static const uint8_t dummy_key2[AES256_KEY_BYTE_SIZE] = { 1 };
+	TEE_Result res;
+
+	res = populate_key(&sess->dummy_handle, dummy_key, slot->key_size);
+	if (res != TEE_SUCCESS)
+		return res;
+
+	if (slot->algo == TEE_ALG_AES_XTS) {
+		res = populate_key(&sess->dummy2_handle, dummy_key2,
+				   slot->key_size);
+		if (res != TEE_SUCCESS)
+			return res;
+	}
+
+	res = set_op_keys(slot, sess->dummy_handle, sess->dummy2_handle);
+	if (res != TEE_SUCCESS)
+		return res;
+
+	slot->key_gen = 0;
+
+	return TEE_SUCCESS;
+}
+
+/*
+ * Load the session key into a cached operation if the operation does not
+ * already hold it. An operation the session key does not fit gets the
+ * dummy key back rather than keeping an older client key: it waits for
+ * a TA_AES_CMD_SET_KEY.
+ */
+static TEE_Result bind_session_key(struct aes_cipher *sess,
+				   struct aes_op_slot *slot)
+{
+	bool fits = session_key_fits(sess, slot);
+
+	if (fits ? slot->key_gen == sess->key_gen : !slot->key_gen)
+		return TEE_SUCCESS;
+
+	/* Operation already holds a key, hence can be reset */
+	TEE_ResetOperation(slot->op_handle);
+
+	if (fits)
+		return load_session_key(sess, slot);
+
+	return set_dummy_key(sess, slot);
+}
+
+static struct aes_op_slot *find_op_slot(struct aes_cipher *sess)
+{
+	size_t n;
+
+	for (n = 0; n < AES_OP_CACHE_SLOTS; n++) {
+		struct aes_op_slot *slot = &sess->cache[n];
+
+		if (slot->op_handle != TEE_HANDLE_NULL &&
+		    slot->algo == sess->algo &&
+		    slot->key_size == sess->key_size &&
+		    slot->mode == sess->mode)
+			return slot;
+	}
+
+	return NULL;
+}
+
+static void free_op_slot(struct aes_op_slot *slot)
+{
+	if (slot->op_handle != TEE_HANDLE_NULL)
+		TEE_FreeOperation(slot->op_handle);
+	slot->op_handle = TEE_HANDLE_NULL;
+}
+
+/*
+ * Bring every cached operation in line with the session key right away,
+ * so that none keeps a key the session no longer has.
+ */
+static void rebind_cached_ops(struct aes_cipher *sess)
+{
+	struct aes_op_slot *slot;
+	size_t n;
+
+	for (n = 0; n < AES_OP_CACHE_SLOTS; n++) {
+		slot = &sess->cache[n];
+		if (slot->op_handle == TEE_HANDLE_NULL ||
+		    bind_session_key(sess, slot) == TEE_SUCCESS)
+			continue;
+
+		/* No key could be loaded: drop the operation */
+		if (slot == sess->slot) {
+			sess->slot = NULL;
+			sess->op_handle = TEE_HANDLE_NULL;
+		}
+		free_op_slot(slot);
+	}
+}
+
+/* Leave the session without key, cached operations get the dummy key */
+static void drop_session_key(struct aes_cipher *sess)
+{
+	sess->key_obj = TEE_HANDLE_NULL;
+	sess->key_len = 0;
+	sess->key_stored = false;
+	sess->ae_active = false;
+	next_key_gen(sess);
+	rebind_cached_ops(sess);
+}
+
 /*
  * Process command TA_AES_CMD_PREPARE. API in aes_ta.h
  *
- * Allocate resources required for the ciphering operation.
+ * Select the resources required for the ciphering operation, allocating
+ * them only if no cached operation matches the requested configuration.
+ * A cached operation is returned already loaded with the last key set
+ * in the session, hence client can skip TA_AES_CMD_SET_KEY. If that key
+ * does not fit the operation, the operation is loaded with the dummy key.
  * During ciphering operation, when expect client can:
  * - update the key materials (provided by client)
  * - reset the initial vector (provided by client)
@@ -116,9 +433,8 @@ static TEE_Result alloc_resources(void *session, uint32_t param_types,
 				TEE_PARAM_TYPE_VALUE_INPUT,
 				TEE_PARAM_TYPE_NONE);
 	struct aes_cipher *sess;
-	TEE_Attribute attr;
+	struct aes_op_slot *slot;
 	TEE_Result res;
-	char *key;
 
 	/* Get ciphering context from session ID */
 	DMSG("Session %p: get ciphering resources", session);
@@ -140,82 +456,62 @@ static TEE_Result alloc_resources(void *session, uint32_t param_types,
 	if (res != TEE_SUCCESS)
 		return res;
 
-	/*
-	 * Ready to allocate the resources which are:
-	 * - an operation handle, for an AES ciphering of given configuration
-	 * - a transient object that will be use to load the key materials
-	 *   into the AES ciphering operation.
-	 */
-
-	/* Free potential previous operation */
-	if (sess->op_handle != TEE_HANDLE_NULL)
-		TEE_FreeOperation(sess->op_handle);
+	/* Deselect previous operation until the new one is ready */
+	sess->slot = NULL;
+	sess->op_handle = TEE_HANDLE_NULL;
+	sess->ae_active = false;
 
-	/* Allocate operation: AES/CTR, mode and size from params */
-	res = TEE_AllocateOperation(&sess->op_handle,
-				    sess->algo,
-				    sess->mode,
-				    sess->key_size * 8);
-	if (res != TEE_SUCCESS) {
-		EMSG("Failed to allocate operation");
-		sess->op_handle = TEE_HANDLE_NULL;
-		goto err;
+	slot = find_op_slot(sess);
+	if (slot) {
+		sess->cache_hits++;
+		res = bind_session_key(sess, slot);
+		if (res != TEE_SUCCESS)
+			goto err;
+		goto out;
 	}
 
-	/* Free potential previous transient object */
-	if (sess->key_handle != TEE_HANDLE_NULL)
-		TEE_FreeTransientObject(sess->key_handle);
-
-	/* Allocate transient object according to target key size */
-	res = TEE_AllocateTransientObject(TEE_TYPE_AES,
-					  sess->key_size * 8,
-					  &sess->key_handle);
-	if (res != TEE_SUCCESS) {
-		EMSG("Failed to allocate transient object");
-		sess->key_handle = TEE_HANDLE_NULL;
-		goto err;
-	}
+	sess->cache_misses++;
 
 	/*
-	 * When loading a key in the cipher session, set_aes_key()
-	 * will reset the operation and load a key. But we cannot
-	 * reset and operation that has no key yet (GPD TEE Internal
-	 * Core API Specification – Public Release v1.1.1, section
-	 * 6.2.5 TEE_ResetOperation). In consequence, we will load a
-	 * dummy key in the operation so that operation can be reset
-	 * when updating the key.
+	 * Ready to allocate the resources which is an operation handle
+	 * for an AES ciphering of given configuration. The key materials
+	 * are loaded through the session transient objects. Recycle the
+	 * oldest slot if the cache is full.
 	 */
-	key = TEE_Malloc(sess->key_size, 0);
-	if (!key) {
-		res = TEE_ERROR_OUT_OF_MEMORY;
-		goto err;
-	}
+	slot = &sess->cache[sess->next_victim];
+	sess->next_victim = (sess->next_victim + 1) % AES_OP_CACHE_SLOTS;
+	free_op_slot(slot);
 
-	TEE_InitRefAttribute(&attr, TEE_ATTR_SECRET_VALUE, key, sess->key_size);
+	slot->algo = sess->algo;
+	slot->mode = sess->mode;
+	slot->key_size = sess->key_size;
+	slot->key_gen = 0;
 
-	res = TEE_PopulateTransientObject(sess->key_handle, &attr, 1);
+	/* Allocate operation: AES/CTR, mode and size from params */
+	res = TEE_AllocateOperation(&slot->op_handle,
+				    slot->algo,
+				    slot->mode,
+				    slot->key_size * 8);
 	if (res != TEE_SUCCESS) {
-		EMSG("TEE_PopulateTransientObject failed, %x", res);
+		EMSG("Failed to allocate operation");
+		slot->op_handle = TEE_HANDLE_NULL;
 		goto err;
 	}
 
-	res = TEE_SetOperationKey(sess->op_handle, sess->key_handle);
-	if (res != TEE_SUCCESS) {
-		EMSG("TEE_SetOperationKey failed %x", res);
+	if (session_key_fits(sess, slot))
+		res = load_session_key(sess, slot);
+	else
+		res = set_dummy_key(sess, slot);
+	if (res != TEE_SUCCESS)
 		goto err;
-	}
 
-	return res;
+out:
+	sess->slot = slot;
+	sess->op_handle = slot->op_handle;
+	return TEE_SUCCESS;
 
 err:
-	if (sess->op_handle != TEE_HANDLE_NULL)
-		TEE_FreeOperation(sess->op_handle);
-	sess->op_handle = TEE_HANDLE_NULL;
-
-	if (sess->key_handle != TEE_HANDLE_NULL)
-		TEE_FreeTransientObject(sess->key_handle);
-	sess->key_handle = TEE_HANDLE_NULL;
-
+	free_op_slot(slot);
 	return res;
 }
 
@@ -231,9 +527,9 @@ static TEE_Result set_aes_key(void *session, uint32_t param_types,
 				TEE_PARAM_TYPE_NONE,
 				TEE_PARAM_TYPE_NONE);
 	struct aes_cipher *sess;
-	TEE_Attribute attr;
 	TEE_Result res;
 	uint32_t key_sz;
+	bool dual;
 	char *key;
 
 	/* Get ciphering context from session ID */
@@ -244,12 +540,21 @@ static TEE_Result set_aes_key(void *session, uint32_t param_types,
 	if (param_types != exp_param_types)
 		return TEE_ERROR_BAD_PARAMETERS;
 
+	if (!sess->slot)
+		return TEE_ERROR_BAD_STATE;
+
 	key = params[0].memref.buffer;
 	key_sz = params[0].memref.size;
 
-	if (key_sz != sess->key_size) {
+	/* XTS expects both keys concatenated */
+	dual = sess->algo == TEE_ALG_AES_XTS;
+	if (dual)
+		key_sz /= 2;
+
+	if (key_sz != sess->key_size ||
+	    params[0].memref.size != key_sz * (dual ? 2 : 1)) {
 		EMSG("Wrong key size %" PRIu32 ", expect %" PRIu32 " bytes",
-		     key_sz, sess->key_size);
+		     params[0].memref.size, sess->key_size * (dual ? 2 : 1));
 		return TEE_ERROR_BAD_PARAMETERS;
 	}
 
@@ -268,97 +573,1104 @@ static TEE_Result set_aes_key(void *session, uint32_t param_types,
 	 * api cannot be used on operation with key(s) not yet set. Hence,
 	 * when allocating the operation handle, we prevovision a dummy key.
 	 * Thus, set_key sequence always reset then set key on operation.
+	 *
+	 * The key stays in the session transient object so that cached
+	 * operations of the same key size can be rebound to it on PREPARE.
 	 */
 
-	TEE_InitRefAttribute(&attr, TEE_ATTR_SECRET_VALUE, key, key_sz);
-
-	TEE_ResetTransientObject(sess->key_handle);
-	res = TEE_PopulateTransientObject(sess->key_handle, &attr, 1);
+	res = populate_key(&sess->key_handle, key, key_sz);
+	if (res == TEE_SUCCESS && dual)
+		res = populate_key(&sess->key2_handle, key + key_sz, key_sz);
 	if (res != TEE_SUCCESS) {
-		EMSG("TEE_PopulateTransientObject failed, %x", res);
+		drop_session_key(sess);
 		return res;
 	}
 
-	TEE_ResetOperation(sess->op_handle);
-	res = TEE_SetOperationKey(sess->op_handle, sess->key_handle);
+	/* Other cached operations get the new key on their next PREPARE */
+	next_key_gen(sess);
+	sess->key_obj = sess->key_handle;
+	sess->key_len = key_sz;
+	sess->key_dual = dual;
+	sess->key_stored = false;
+	sess->ae_active = false;
+
+	return bind_session_key(sess, sess->slot);
+}
+
+static void key_object_id(uint32_t id, uint8_t obj_id[AES_KEY_ID_SIZE])
+{
+	size_t prefix_sz = sizeof(AES_KEY_ID_PREFIX) - 1;
+
+	TEE_MemMove(obj_id, AES_KEY_ID_PREFIX, prefix_sz);
+	TEE_MemMove(obj_id + prefix_sz, &id, sizeof(id));
+}
+
+/*
+ * A key slot was generated, imported or deleted from this session: if the
+ * session key is a copy of it, the session is left without key and the
+ * cached operations get the dummy key back. Other sessions keep their copy
+ * until their next TA_AES_CMD_KEY_BIND.
+ */
+static void unbind_stored_key(struct aes_cipher *sess, uint32_t id)
+{
+	if (sess->key_stored && sess->stored_id == id)
+		drop_session_key(sess);
+}
+
+/* Save the AES key of a transient object in a persistent key slot */
+static TEE_Result store_key(struct aes_cipher *sess, uint32_t id,
+			    TEE_ObjectHandle key)
+{
+	uint8_t obj_id[AES_KEY_ID_SIZE];
+	TEE_Result res;
+
+	key_object_id(id, obj_id);
+	res = TEE_CreatePersistentObject(TEE_STORAGE_PRIVATE,
+					 obj_id, sizeof(obj_id),
+					 TEE_DATA_FLAG_ACCESS_READ |
+					 TEE_DATA_FLAG_SHARE_READ |
+					 TEE_DATA_FLAG_OVERWRITE,
+					 key, NULL, 0, NULL);
 	if (res != TEE_SUCCESS) {
-		EMSG("TEE_SetOperationKey failed %x", res);
+		EMSG("Key slot %" PRIu32 ": create failed 0x%x", id, res);
 		return res;
 	}
 
-	return res;
+	unbind_stored_key(sess, id);
+
+	return TEE_SUCCESS;
 }
 
 /*
- * Process command TA_AES_CMD_SET_IV. API in aes_ta.h
+ * Process command TA_AES_CMD_KEY_GENERATE. API in aes_ta.h
  */
-static TEE_Result reset_aes_iv(void *session, uint32_t param_types,
-				TEE_Param params[4])
+static TEE_Result generate_stored_key(void *session, uint32_t param_types,
+				      TEE_Param params[4])
 {
 	const uint32_t exp_param_types =
-		TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT,
+		TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
 				TEE_PARAM_TYPE_NONE,
 				TEE_PARAM_TYPE_NONE,
 				TEE_PARAM_TYPE_NONE);
+	TEE_ObjectHandle key = TEE_HANDLE_NULL;
 	struct aes_cipher *sess;
-	size_t iv_sz;
-	char *iv;
+	uint32_t key_sz;
+	TEE_Result res;
 
 	/* Get ciphering context from session ID */
-	DMSG("Session %p: reset initial vector", session);
+	DMSG("Session %p: generate key in slot", session);
 	sess = (struct aes_cipher *)session;
 
 	/* Safely get the invocation parameters */
 	if (param_types != exp_param_types)
 		return TEE_ERROR_BAD_PARAMETERS;
 
-	iv = params[0].memref.buffer;
-	iv_sz = params[0].memref.size;
+	res = ta2tee_key_size(params[0].value.b, &key_sz);
+	if (res != TEE_SUCCESS)
+		return res;
 
-	/*
-	 * Init cipher operation with the initialization vector.
-	 */
-	TEE_CipherInit(sess->op_handle, iv, iv_sz);
+	res = TEE_AllocateTransientObject(TEE_TYPE_AES, key_sz * 8, &key);
+	if (res != TEE_SUCCESS) {
+		EMSG("Failed to allocate transient object");
+		return res;
+	}
 
-	return TEE_SUCCESS;
+	res = TEE_GenerateKey(key, key_sz * 8, NULL, 0);
+	if (res == TEE_SUCCESS)
+		res = store_key(sess, params[0].value.a, key);
+	else
+		EMSG("TEE_GenerateKey failed 0x%x", res);
+
+	TEE_FreeTransientObject(key);
+
+	return res;
 }
 
 /*
- * Process command TA_AES_CMD_CIPHER. API in aes_ta.h
+ * Process command TA_AES_CMD_KEY_IMPORT. API in aes_ta.h
  */
-static TEE_Result cipher_buffer(void *session, uint32_t param_types,
-				TEE_Param params[4])
+static TEE_Result import_stored_key(void *session, uint32_t param_types,
+				    TEE_Param params[4])
 {
 	const uint32_t exp_param_types =
-		TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT,
-				TEE_PARAM_TYPE_MEMREF_OUTPUT,
+		TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+				TEE_PARAM_TYPE_MEMREF_INPUT,
 				TEE_PARAM_TYPE_NONE,
 				TEE_PARAM_TYPE_NONE);
+	TEE_ObjectHandle key = TEE_HANDLE_NULL;
 	struct aes_cipher *sess;
+	uint32_t key_sz;
+	TEE_Result res;
 
 	/* Get ciphering context from session ID */
-	DMSG("Session %p: cipher buffer", session);
+	DMSG("Session %p: import key in slot", session);
 	sess = (struct aes_cipher *)session;
 
 	/* Safely get the invocation parameters */
 	if (param_types != exp_param_types)
 		return TEE_ERROR_BAD_PARAMETERS;
 
-	if (params[1].memref.size < params[0].memref.size) {
-		EMSG("Bad sizes: in %d, out %d", params[0].memref.size,
-						 params[1].memref.size);
-		return TEE_ERROR_BAD_PARAMETERS;
-	}
+	res = ta2tee_key_size(params[1].memref.size, &key_sz);
+	if (res != TEE_SUCCESS)
+		return res;
 
-	if (sess->op_handle == TEE_HANDLE_NULL)
-		return TEE_ERROR_BAD_STATE;
+	res = populate_key(&key, params[1].memref.buffer, key_sz);
+	if (res == TEE_SUCCESS)
+		res = store_key(sess, params[0].value.a, key);
 
-	/*
-	 * Process ciphering operation on provided buffers
-	 */
-	return TEE_CipherUpdate(sess->op_handle,
-				params[0].memref.buffer, params[0].memref.size,
-				params[1].memref.buffer, &params[1].memref.size);
+	if (key != TEE_HANDLE_NULL)
+		TEE_FreeTransientObject(key);
+
+	return res;
+}
+
+/*
+ * Process command TA_AES_CMD_KEY_BIND. API in aes_ta.h
+ *
+ * The key is copied in the session and the slot closed right away: the
+ * TA is multi-instance, a slot kept open would conflict with other
+ * sessions generating, importing or deleting it. Preparing other
+ * operations loads the copy without accessing the secure storage.
+ */
+static TEE_Result bind_stored_key(void *session, uint32_t param_types,
+				  TEE_Param params[4])
+{
+	const uint32_t exp_param_types =
+		TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+				TEE_PARAM_TYPE_NONE,
+				TEE_PARAM_TYPE_NONE,
+				TEE_PARAM_TYPE_NONE);
+	uint8_t obj_id[AES_KEY_ID_SIZE];
+	TEE_ObjectHandle obj;
+	struct aes_cipher *sess;
+	TEE_ObjectInfo info;
+	uint32_t key_sz;
+	uint32_t id;
+	TEE_Result res;
+
+	/* Get ciphering context from session ID */
+	DMSG("Session %p: bind key slot", session);
+	sess = (struct aes_cipher *)session;
+
+	/* Safely get the invocation parameters */
+	if (param_types != exp_param_types)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	id = params[0].value.a;
+
+	key_object_id(id, obj_id);
+	res = TEE_OpenPersistentObject(TEE_STORAGE_PRIVATE,
+				       obj_id, sizeof(obj_id),
+				       TEE_DATA_FLAG_ACCESS_READ |
+				       TEE_DATA_FLAG_SHARE_READ,
+				       &obj);
+	if (res != TEE_SUCCESS) {
+		EMSG("Key slot %" PRIu32 ": open failed 0x%x", id, res);
+		return res;
+	}
+
+	res = TEE_GetObjectInfo1(obj, &info);
+	if (res == TEE_SUCCESS && info.objectType != TEE_TYPE_AES)
+		res = TEE_ERROR_BAD_FORMAT;
+	if (res == TEE_SUCCESS)
+		res = ta2tee_key_size(info.objectSize / 8, &key_sz);
+	if (res != TEE_SUCCESS) {
+		EMSG("Key slot %" PRIu32 ": not an AES key", id);
+		TEE_CloseObject(obj);
+		return res;
+	}
+
+	/* The prepared operation shall be able to use the key */
+	if (sess->slot && (sess->slot->key_size != key_sz ||
+			   sess->slot->algo == TEE_ALG_AES_XTS)) {
+		EMSG("Key slot %" PRIu32 ": key does not fit the operation",
+		     id);
+		TEE_CloseObject(obj);
+		return TEE_ERROR_BAD_STATE;
+	}
+
+	res = copy_key(&sess->key_handle, obj);
+	TEE_CloseObject(obj);
+	if (res != TEE_SUCCESS) {
+		drop_session_key(sess);
+		return res;
+	}
+
+	/* Other cached operations get the new key on their next PREPARE */
+	next_key_gen(sess);
+	sess->key_obj = sess->key_handle;
+	sess->key_stored = true;
+	sess->stored_id = id;
+	sess->key_len = key_sz;
+	sess->key_dual = false;
+	sess->ae_active = false;
+
+	if (!sess->slot)
+		return TEE_SUCCESS;
+
+	return bind_session_key(sess, sess->slot);
+}
+
+/*
+ * Process command TA_AES_CMD_KEY_DELETE. API in aes_ta.h
+ */
+static TEE_Result delete_stored_key(void *session, uint32_t param_types,
+				    TEE_Param params[4])
+{
+	const uint32_t exp_param_types =
+		TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+				TEE_PARAM_TYPE_NONE,
+				TEE_PARAM_TYPE_NONE,
+				TEE_PARAM_TYPE_NONE);
+	uint8_t obj_id[AES_KEY_ID_SIZE];
+	TEE_ObjectHandle obj;
+	struct aes_cipher *sess;
+	uint32_t id;
+	TEE_Result res;
+
+	/* Get ciphering context from session ID */
+	DMSG("Session %p: delete key slot", session);
+	sess = (struct aes_cipher *)session;
+
+	/* Safely get the invocation parameters */
+	if (param_types != exp_param_types)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	id = params[0].value.a;
+
+	key_object_id(id, obj_id);
+	res = TEE_OpenPersistentObject(TEE_STORAGE_PRIVATE,
+				       obj_id, sizeof(obj_id),
+				       TEE_DATA_FLAG_ACCESS_WRITE_META, &obj);
+	if (res != TEE_SUCCESS) {
+		EMSG("Key slot %" PRIu32 ": open failed 0x%x", id, res);
+		return res;
+	}
+
+	res = TEE_CloseAndDeletePersistentObject1(obj);
+	if (res == TEE_SUCCESS)
+		unbind_stored_key(sess, id);
+
+	return res;
+}
+
+/*
+ * Process command TA_AES_CMD_SET_IV. API in aes_ta.h
+ */
+static TEE_Result reset_aes_iv(void *session, uint32_t param_types,
+				TEE_Param params[4])
+{
+	const uint32_t exp_param_types =
+		TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT,
+				TEE_PARAM_TYPE_NONE,
+				TEE_PARAM_TYPE_NONE,
+				TEE_PARAM_TYPE_NONE);
+	struct aes_cipher *sess;
+	size_t iv_sz;
+	char *iv;
+
+	/* Get ciphering context from session ID */
+	DMSG("Session %p: reset initial vector", session);
+	sess = (struct aes_cipher *)session;
+
+	/* Safely get the invocation parameters */
+	if (param_types != exp_param_types)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	if (!cipher_ready(sess))
+		return TEE_ERROR_BAD_STATE;
+
+	iv = params[0].memref.buffer;
+	iv_sz = params[0].memref.size;
+
+	/* Keep the CTR base counter for TA_AES_CMD_CIPHER_AT */
+	sess->ctr_base_set = iv_sz == sizeof(sess->ctr_base);
+	if (sess->ctr_base_set)
+		TEE_MemMove(sess->ctr_base, iv, iv_sz);
+
+	/*
+	 * Init cipher operation with the initialization vector.
+	 */
+	TEE_CipherInit(sess->op_handle, iv, iv_sz);
+
+	return TEE_SUCCESS;
+}
+
+/*
+ * Process command TA_AES_CMD_CIPHER_AT. API in aes_ta.h
+ *
+ * The counter block of the offset is the base counter plus the offset in
+ * blocks, as a 128-bit big endian addition. The keystream bytes before
+ * the offset in its block are ciphered into a scratch buffer.
+ */
+static TEE_Result cipher_at_offset(void *session, uint32_t param_types,
+				   TEE_Param params[4])
+{
+	const uint32_t exp_param_types =
+		TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT,
+				TEE_PARAM_TYPE_MEMREF_OUTPUT,
+				TEE_PARAM_TYPE_VALUE_INPUT,
+				TEE_PARAM_TYPE_NONE);
+	uint8_t scratch[TA_AES_BLOCK_SIZE] = { 0 };
+	uint8_t ctr[TA_AES_BLOCK_SIZE];
+	struct aes_cipher *sess;
+	uint64_t offset;
+	uint64_t blocks;
+	uint32_t skip;
+	uint32_t sz;
+	uint32_t carry;
+	TEE_Result res;
+	int n;
+
+	/* Get ciphering context from session ID */
+	DMSG("Session %p: cipher at offset", session);
+	sess = (struct aes_cipher *)session;
+
+	/* Safely get the invocation parameters */
+	if (param_types != exp_param_types)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	if (params[1].memref.size < params[0].memref.size) {
+		EMSG("Bad sizes: in %d, out %d", params[0].memref.size,
+						 params[1].memref.size);
+		return TEE_ERROR_BAD_PARAMETERS;
+	}
+
+	if (!cipher_ready(sess) || sess->algo != TEE_ALG_AES_CTR ||
+	    !sess->ctr_base_set)
+		return TEE_ERROR_BAD_STATE;
+
+	offset = ((uint64_t)params[2].value.b << 32) | params[2].value.a;
+	blocks = offset / TA_AES_BLOCK_SIZE;
+	skip = offset % TA_AES_BLOCK_SIZE;
+
+	carry = 0;
+	for (n = TA_AES_BLOCK_SIZE - 1; n >= 0; n--) {
+		carry += sess->ctr_base[n] + (uint8_t)blocks;
+		ctr[n] = carry;
+		carry >>= 8;
+		blocks >>= 8;
+	}
+
+	TEE_CipherInit(sess->op_handle, ctr, sizeof(ctr));
+
+	if (skip) {
+		sz = skip;
+		res = TEE_CipherUpdate(sess->op_handle, scratch, skip,
+				       scratch, &sz);
+		if (res != TEE_SUCCESS)
+			return res;
+	}
+
+	return TEE_CipherUpdate(sess->op_handle,
+				params[0].memref.buffer, params[0].memref.size,
+				params[1].memref.buffer, &params[1].memref.size);
+}
+
+/*
+ * Process command TA_AES_CMD_CIPHER. API in aes_ta.h
+ */
+static TEE_Result cipher_buffer(void *session, uint32_t param_types,
+				TEE_Param params[4])
+{
+	const uint32_t exp_param_types =
+		TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT,
+				TEE_PARAM_TYPE_MEMREF_OUTPUT,
+				TEE_PARAM_TYPE_NONE,
+				TEE_PARAM_TYPE_NONE);
+	struct aes_cipher *sess;
+
+	/* Get ciphering context from session ID */
+	DMSG("Session %p: cipher buffer", session);
+	sess = (struct aes_cipher *)session;
+
+	/* Safely get the invocation parameters */
+	if (param_types != exp_param_types)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	if (params[1].memref.size < params[0].memref.size) {
+		EMSG("Bad sizes: in %d, out %d", params[0].memref.size,
+						 params[1].memref.size);
+		return TEE_ERROR_BAD_PARAMETERS;
+	}
+
+	if (!cipher_ready(sess))
+		return TEE_ERROR_BAD_STATE;
+
+	/*
+	 * Process ciphering operation on provided buffers
+	 */
+	return TEE_CipherUpdate(sess->op_handle,
+				params[0].memref.buffer, params[0].memref.size,
+				params[1].memref.buffer, &params[1].memref.size);
+}
+
+/*
+ * Process command TA_AES_CMD_CIPHER_FINAL. API in aes_ta.h
+ */
+static TEE_Result cipher_final(void *session, uint32_t param_types,
+			       TEE_Param params[4])
+{
+	const uint32_t exp_param_types =
+		TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT,
+				TEE_PARAM_TYPE_MEMREF_OUTPUT,
+				TEE_PARAM_TYPE_NONE,
+				TEE_PARAM_TYPE_NONE);
+	struct aes_cipher *sess;
+
+	/* Get ciphering context from session ID */
+	DMSG("Session %p: cipher final buffer", session);
+	sess = (struct aes_cipher *)session;
+
+	/* Safely get the invocation parameters */
+	if (param_types != exp_param_types)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	if (!cipher_ready(sess))
+		return TEE_ERROR_BAD_STATE;
+
+	/*
+	 * Process last ciphering operation, output includes data held
+	 * back by previous TA_AES_CMD_CIPHER calls.
+	 */
+	return TEE_CipherDoFinal(sess->op_handle,
+				 params[0].memref.buffer, params[0].memref.size,
+				 params[1].memref.buffer,
+				 &params[1].memref.size);
+}
+
+/*
+ * Process command TA_AES_CMD_XTS_SECTORS. API in aes_ta.h
+ *
+ * The tweak of each sector is its sector number, as a 128-bit little
+ * endian value (IEEE P1619 data unit sequence number).
+ */
+static TEE_Result cipher_xts_sectors(void *session, uint32_t param_types,
+				     TEE_Param params[4])
+{
+	const uint32_t exp_param_types =
+		TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT,
+				TEE_PARAM_TYPE_MEMREF_OUTPUT,
+				TEE_PARAM_TYPE_VALUE_INPUT,
+				TEE_PARAM_TYPE_VALUE_INPUT);
+	uint8_t tweak[TA_AES_BLOCK_SIZE];
+	struct aes_cipher *sess;
+	uint32_t sector_sz;
+	uint64_t sector;
+	uint32_t out_sz;
+	uint32_t offs;
+	uint8_t *in;
+	uint8_t *out;
+	TEE_Result res;
+	size_t n;
+
+	/* Get ciphering context from session ID */
+	DMSG("Session %p: cipher XTS sectors", session);
+	sess = (struct aes_cipher *)session;
+
+	/* Safely get the invocation parameters */
+	if (param_types != exp_param_types)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	if (sess->op_handle == TEE_HANDLE_NULL ||
+	    sess->algo != TEE_ALG_AES_XTS)
+		return TEE_ERROR_BAD_STATE;
+
+	sector = ((uint64_t)params[2].value.b << 32) | params[2].value.a;
+	sector_sz = params[3].value.a;
+
+	if (sector_sz < TA_AES_BLOCK_SIZE ||
+	    sector_sz % TA_AES_BLOCK_SIZE ||
+	    params[0].memref.size % sector_sz) {
+		EMSG("Bad sector size %" PRIu32 " for %" PRIu32 " bytes",
+		     sector_sz, params[0].memref.size);
+		return TEE_ERROR_BAD_PARAMETERS;
+	}
+
+	if (params[1].memref.size < params[0].memref.size) {
+		params[1].memref.size = params[0].memref.size;
+		return TEE_ERROR_SHORT_BUFFER;
+	}
+
+	in = params[0].memref.buffer;
+	out = params[1].memref.buffer;
+
+	for (offs = 0; offs < params[0].memref.size; offs += sector_sz) {
+		memset(tweak, 0, sizeof(tweak));
+		for (n = 0; n < sizeof(sector); n++)
+			tweak[n] = sector >> (8 * n);
+
+		TEE_CipherInit(sess->op_handle, tweak, sizeof(tweak));
+
+		out_sz = sector_sz;
+		res = TEE_CipherDoFinal(sess->op_handle, in + offs, sector_sz,
+					out + offs, &out_sz);
+		if (res != TEE_SUCCESS) {
+			EMSG("Sector %" PRIu64 ": TEE_CipherDoFinal failed %x",
+			     sector, res);
+			return res;
+		}
+
+		sector++;
+	}
+
+	params[1].memref.size = params[0].memref.size;
+
+	return TEE_SUCCESS;
+}
+
+/*
+ * Process command TA_AES_CMD_CIPHER_BATCH. API in aes_ta.h
+ */
+static TEE_Result cipher_batch(void *session, uint32_t param_types,
+			       TEE_Param params[4])
+{
+	const uint32_t exp_param_types =
+		TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT,
+				TEE_PARAM_TYPE_MEMREF_INOUT,
+				TEE_PARAM_TYPE_NONE,
+				TEE_PARAM_TYPE_NONE);
+	struct aes_batch_desc desc;
+	struct aes_cipher *sess;
+	uint8_t *desc_buf;
+	uint8_t *data;
+	uint32_t data_sz;
+	uint32_t out_sz;
+	size_t count;
+	size_t n;
+	TEE_Result res;
+
+	/* Get ciphering context from session ID */
+	DMSG("Session %p: cipher batch", session);
+	sess = (struct aes_cipher *)session;
+
+	/* Safely get the invocation parameters */
+	if (param_types != exp_param_types)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	if (params[0].memref.size % sizeof(desc)) {
+		EMSG("Bad descriptor table size %u", params[0].memref.size);
+		return TEE_ERROR_BAD_PARAMETERS;
+	}
+
+	if (!cipher_ready(sess))
+		return TEE_ERROR_BAD_STATE;
+
+	desc_buf = params[0].memref.buffer;
+	count = params[0].memref.size / sizeof(desc);
+	data = params[1].memref.buffer;
+	data_sz = params[1].memref.size;
+
+	for (n = 0; n < count; n++) {
+		/* Table is non-secure memory: copy before checking it */
+		TEE_MemMove(&desc, desc_buf + n * sizeof(desc), sizeof(desc));
+
+		if (desc.offset > data_sz ||
+		    desc.length > data_sz - desc.offset) {
+			EMSG("Record %zu out of buffer: offset %" PRIu32
+			     ", length %" PRIu32, n, desc.offset, desc.length);
+			return TEE_ERROR_BAD_PARAMETERS;
+		}
+
+		if (sess->algo == TEE_ALG_AES_ECB_NOPAD)
+			TEE_CipherInit(sess->op_handle, NULL, 0);
+		else
+			TEE_CipherInit(sess->op_handle, desc.iv,
+				       sizeof(desc.iv));
+
+		out_sz = desc.length;
+		res = TEE_CipherDoFinal(sess->op_handle,
+					data + desc.offset, desc.length,
+					data + desc.offset, &out_sz);
+		if (res != TEE_SUCCESS) {
+			EMSG("Record %zu: TEE_CipherDoFinal failed %x", n, res);
+			return res;
+		}
+	}
+
+	return TEE_SUCCESS;
+}
+
+/*
+ * Process command TA_AES_CMD_AE_INIT. API in aes_ta.h
+ */
+static TEE_Result ae_init(void *session, uint32_t param_types,
+			  TEE_Param params[4])
+{
+	const uint32_t exp_param_types =
+		TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT,
+				TEE_PARAM_TYPE_VALUE_INPUT,
+				TEE_PARAM_TYPE_NONE,
+				TEE_PARAM_TYPE_NONE);
+	struct aes_cipher *sess;
+	uint32_t tag_len;
+	TEE_Result res;
+
+	/* Get ciphering context from session ID */
+	DMSG("Session %p: init authenticated encryption", session);
+	sess = (struct aes_cipher *)session;
+
+	/* Safely get the invocation parameters */
+	if (param_types != exp_param_types)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	if (sess->op_handle == TEE_HANDLE_NULL ||
+	    sess->algo != TEE_ALG_AES_GCM)
+		return TEE_ERROR_BAD_STATE;
+
+	if (!params[0].memref.size)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	res = ta2tee_tag_len(params[1].value.a, &tag_len);
+	if (res != TEE_SUCCESS)
+		return res;
+
+	/* Restart from initial state, whatever the previous sequence was */
+	sess->ae_active = false;
+	TEE_ResetOperation(sess->op_handle);
+
+	res = TEE_AEInit(sess->op_handle, params[0].memref.buffer,
+			 params[0].memref.size, tag_len, 0, 0);
+	if (res != TEE_SUCCESS) {
+		EMSG("TEE_AEInit failed %x", res);
+		return res;
+	}
+
+	sess->tag_len = tag_len;
+	sess->ae_active = true;
+	sess->ae_payload = false;
+
+	return TEE_SUCCESS;
+}
+
+/*
+ * Process command TA_AES_CMD_AE_UPDATE_AAD. API in aes_ta.h
+ */
+static TEE_Result ae_update_aad(void *session, uint32_t param_types,
+				TEE_Param params[4])
+{
+	const uint32_t exp_param_types =
+		TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT,
+				TEE_PARAM_TYPE_NONE,
+				TEE_PARAM_TYPE_NONE,
+				TEE_PARAM_TYPE_NONE);
+	struct aes_cipher *sess;
+
+	/* Get ciphering context from session ID */
+	DMSG("Session %p: update AAD", session);
+	sess = (struct aes_cipher *)session;
+
+	/* Safely get the invocation parameters */
+	if (param_types != exp_param_types)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	/* AAD cannot follow payload data */
+	if (!sess->ae_active || sess->ae_payload)
+		return TEE_ERROR_BAD_STATE;
+
+	TEE_AEUpdateAAD(sess->op_handle, params[0].memref.buffer,
+			params[0].memref.size);
+
+	return TEE_SUCCESS;
+}
+
+/*
+ * Process command TA_AES_CMD_AE_UPDATE. API in aes_ta.h
+ */
+static TEE_Result ae_update(void *session, uint32_t param_types,
+			    TEE_Param params[4])
+{
+	const uint32_t exp_param_types =
+		TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT,
+				TEE_PARAM_TYPE_MEMREF_OUTPUT,
+				TEE_PARAM_TYPE_NONE,
+				TEE_PARAM_TYPE_NONE);
+	struct aes_cipher *sess;
+
+	/* Get ciphering context from session ID */
+	DMSG("Session %p: update AE payload", session);
+	sess = (struct aes_cipher *)session;
+
+	/* Safely get the invocation parameters */
+	if (param_types != exp_param_types)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	if (!sess->ae_active)
+		return TEE_ERROR_BAD_STATE;
+
+	sess->ae_payload = true;
+
+	return TEE_AEUpdate(sess->op_handle,
+			    params[0].memref.buffer, params[0].memref.size,
+			    params[1].memref.buffer, &params[1].memref.size);
+}
+
+/*
+ * Process command TA_AES_CMD_AE_ENCRYPT_FINAL. API in aes_ta.h
+ */
+static TEE_Result ae_encrypt_final(void *session, uint32_t param_types,
+				   TEE_Param params[4])
+{
+	const uint32_t exp_param_types =
+		TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT,
+				TEE_PARAM_TYPE_MEMREF_OUTPUT,
+				TEE_PARAM_TYPE_MEMREF_OUTPUT,
+				TEE_PARAM_TYPE_NONE);
+	struct aes_cipher *sess;
+	TEE_Result res;
+
+	/* Get ciphering context from session ID */
+	DMSG("Session %p: encrypt final", session);
+	sess = (struct aes_cipher *)session;
+
+	/* Safely get the invocation parameters */
+	if (param_types != exp_param_types)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	if (!sess->ae_active || sess->mode != TEE_MODE_ENCRYPT)
+		return TEE_ERROR_BAD_STATE;
+
+	res = TEE_AEEncryptFinal(sess->op_handle,
+				 params[0].memref.buffer, params[0].memref.size,
+				 params[1].memref.buffer, &params[1].memref.size,
+				 params[2].memref.buffer, &params[2].memref.size);
+
+	/* Client can retry with larger buffers on short buffer */
+	if (res != TEE_ERROR_SHORT_BUFFER)
+		sess->ae_active = false;
+
+	return res;
+}
+
+/*
+ * Process command TA_AES_CMD_AE_DECRYPT_FINAL. API in aes_ta.h
+ */
+static TEE_Result ae_decrypt_final(void *session, uint32_t param_types,
+				   TEE_Param params[4])
+{
+	const uint32_t exp_param_types =
+		TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT,
+				TEE_PARAM_TYPE_MEMREF_OUTPUT,
+				TEE_PARAM_TYPE_MEMREF_INPUT,
+				TEE_PARAM_TYPE_NONE);
+	struct aes_cipher *sess;
+	TEE_Result res;
+
+	/* Get ciphering context from session ID */
+	DMSG("Session %p: decrypt final", session);
+	sess = (struct aes_cipher *)session;
+
+	/* Safely get the invocation parameters */
+	if (param_types != exp_param_types)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	if (!sess->ae_active || sess->mode != TEE_MODE_DECRYPT)
+		return TEE_ERROR_BAD_STATE;
+
+	if (params[2].memref.size != sess->tag_len / 8) {
+		EMSG("Wrong tag size %" PRIu32 ", expect %" PRIu32 " bytes",
+		     params[2].memref.size, sess->tag_len / 8);
+		return TEE_ERROR_BAD_PARAMETERS;
+	}
+
+	res = TEE_AEDecryptFinal(sess->op_handle,
+				 params[0].memref.buffer, params[0].memref.size,
+				 params[1].memref.buffer, &params[1].memref.size,
+				 params[2].memref.buffer, params[2].memref.size);
+
+	if (res == TEE_ERROR_SHORT_BUFFER)
+		return res;
+
+	sess->ae_active = false;
+
+	/*
+	 * Withhold the final chunk on a tag mismatch. Chunks returned by
+	 * TA_AES_CMD_AE_UPDATE are already out: the client discards them.
+	 */
+	if (res != TEE_SUCCESS)
+		TEE_MemFill(params[1].memref.buffer, 0, params[1].memref.size);
+
+	return res;
+}
+
+/*
+ * Process command TA_AES_CMD_GET_STATS. API in aes_ta.h
+ */
+static TEE_Result get_cache_stats(void *session, uint32_t param_types,
+				  TEE_Param params[4])
+{
+	const uint32_t exp_param_types =
+		TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_OUTPUT,
+				TEE_PARAM_TYPE_NONE,
+				TEE_PARAM_TYPE_NONE,
+				TEE_PARAM_TYPE_NONE);
+	struct aes_cipher *sess;
+
+	/* Get ciphering context from session ID */
+	DMSG("Session %p: get operation cache stats", session);
+	sess = (struct aes_cipher *)session;
+
+	/* Safely get the invocation parameters */
+	if (param_types != exp_param_types)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	params[0].value.a = sess->cache_hits;
+	params[0].value.b = sess->cache_misses;
+
+	return TEE_SUCCESS;
+}
+
+static TEE_Result ta2tee_mac_algo(uint32_t param, uint32_t key_sz,
+				  uint32_t *algo, uint32_t *key_type)
+{
+	switch (param) {
+	case TA_AES_MAC_CMAC:
+		*algo = TEE_ALG_AES_CMAC;
+		*key_type = TEE_TYPE_AES;
+		if (key_sz == AES128_KEY_BYTE_SIZE ||
+		    key_sz == AES256_KEY_BYTE_SIZE)
+			return TEE_SUCCESS;
+		break;
+	case TA_AES_MAC_HMAC_SHA256:
+		*algo = TEE_ALG_HMAC_SHA256;
+		*key_type = TEE_TYPE_HMAC_SHA256;
+		if (key_sz >= HMAC_SHA256_KEY_MIN_SIZE &&
+		    key_sz <= HMAC_SHA256_KEY_MAX_SIZE)
+			return TEE_SUCCESS;
+		break;
+	default:
+		EMSG("Invalid MAC algo %u", param);
+		return TEE_ERROR_BAD_PARAMETERS;
+	}
+
+	EMSG("Invalid MAC key size %u", key_sz);
+	return TEE_ERROR_BAD_PARAMETERS;
+}
+
+/*
+ * Process command TA_AES_CMD_MAC_SET_KEY. API in aes_ta.h
+ *
+ * The MAC operation is kept keyed in the session: it is reallocated only
+ * when the algorithm changes or the key outgrows it. The key object is
+ * released once loaded, the operation holds its own copy.
+ */
+static TEE_Result mac_set_key(void *session, uint32_t param_types,
+			      TEE_Param params[4])
+{
+	const uint32_t exp_param_types =
+		TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+				TEE_PARAM_TYPE_MEMREF_INPUT,
+				TEE_PARAM_TYPE_NONE,
+				TEE_PARAM_TYPE_NONE);
+	TEE_ObjectHandle key = TEE_HANDLE_NULL;
+	struct aes_cipher *sess;
+	TEE_Attribute attr;
+	uint32_t key_type;
+	uint32_t key_bits;
+	uint32_t algo;
+	TEE_Result res;
+
+	/* Get ciphering context from session ID */
+	DMSG("Session %p: load MAC key", session);
+	sess = (struct aes_cipher *)session;
+
+	/* Safely get the invocation parameters */
+	if (param_types != exp_param_types)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	res = ta2tee_mac_algo(params[0].value.a, params[1].memref.size,
+			      &algo, &key_type);
+	if (res != TEE_SUCCESS)
+		return res;
+	key_bits = params[1].memref.size * 8;
+
+	if (sess->mac_op != TEE_HANDLE_NULL &&
+	    (sess->mac_algo != algo || sess->mac_max_bits < key_bits)) {
+		TEE_FreeOperation(sess->mac_op);
+		sess->mac_op = TEE_HANDLE_NULL;
+	}
+
+	if (sess->mac_op == TEE_HANDLE_NULL) {
+		res = TEE_AllocateOperation(&sess->mac_op, algo, TEE_MODE_MAC,
+					    key_bits);
+		if (res != TEE_SUCCESS) {
+			EMSG("Failed to allocate MAC operation");
+			sess->mac_op = TEE_HANDLE_NULL;
+			return res;
+		}
+		sess->mac_algo = algo;
+		sess->mac_max_bits = key_bits;
+	} else {
+		/* Operation holds the previous key, hence can be reset */
+		TEE_ResetOperation(sess->mac_op);
+	}
+	sess->mac_active = false;
+
+	res = TEE_AllocateTransientObject(key_type, key_bits, &key);
+	if (res != TEE_SUCCESS) {
+		EMSG("Failed to allocate transient object");
+		goto err;
+	}
+
+	TEE_InitRefAttribute(&attr, TEE_ATTR_SECRET_VALUE,
+			     params[1].memref.buffer, params[1].memref.size);
+
+	res = TEE_PopulateTransientObject(key, &attr, 1);
+	if (res != TEE_SUCCESS) {
+		EMSG("TEE_PopulateTransientObject failed, %x", res);
+		goto err;
+	}
+
+	res = TEE_SetOperationKey(sess->mac_op, key);
+	if (res != TEE_SUCCESS) {
+		EMSG("TEE_SetOperationKey failed %x", res);
+		goto err;
+	}
+
+	TEE_FreeTransientObject(key);
+	return TEE_SUCCESS;
+
+err:
+	/* Do not leave an operation without key: it could not be reset */
+	if (key != TEE_HANDLE_NULL)
+		TEE_FreeTransientObject(key);
+	TEE_FreeOperation(sess->mac_op);
+	sess->mac_op = TEE_HANDLE_NULL;
+	return res;
+}
+
+/*
+ * Process command TA_AES_CMD_MAC_INIT. API in aes_ta.h
+ */
+static TEE_Result mac_init(void *session, uint32_t param_types,
+			   TEE_Param __unused params[4])
+{
+	const uint32_t exp_param_types =
+		TEE_PARAM_TYPES(TEE_PARAM_TYPE_NONE,
+				TEE_PARAM_TYPE_NONE,
+				TEE_PARAM_TYPE_NONE,
+				TEE_PARAM_TYPE_NONE);
+	struct aes_cipher *sess;
+
+	/* Get ciphering context from session ID */
+	DMSG("Session %p: MAC init", session);
+	sess = (struct aes_cipher *)session;
+
+	/* Safely get the invocation parameters */
+	if (param_types != exp_param_types)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	if (sess->mac_op == TEE_HANDLE_NULL)
+		return TEE_ERROR_BAD_STATE;
+
+	TEE_MACInit(sess->mac_op, NULL, 0);
+	sess->mac_active = true;
+
+	return TEE_SUCCESS;
+}
+
+/*
+ * Process command TA_AES_CMD_MAC_UPDATE. API in aes_ta.h
+ */
+static TEE_Result mac_update(void *session, uint32_t param_types,
+			     TEE_Param params[4])
+{
+	const uint32_t exp_param_types =
+		TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT,
+				TEE_PARAM_TYPE_NONE,
+				TEE_PARAM_TYPE_NONE,
+				TEE_PARAM_TYPE_NONE);
+	struct aes_cipher *sess;
+
+	/* Get ciphering context from session ID */
+	DMSG("Session %p: MAC update", session);
+	sess = (struct aes_cipher *)session;
+
+	/* Safely get the invocation parameters */
+	if (param_types != exp_param_types)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	if (!sess->mac_active)
+		return TEE_ERROR_BAD_STATE;
+
+	TEE_MACUpdate(sess->mac_op, params[0].memref.buffer,
+		      params[0].memref.size);
+
+	return TEE_SUCCESS;
+}
+
+/*
+ * Process command TA_AES_CMD_MAC_FINAL. API in aes_ta.h
+ */
+static TEE_Result mac_final(void *session, uint32_t param_types,
+			    TEE_Param params[4])
+{
+	const uint32_t exp_param_types =
+		TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT,
+				TEE_PARAM_TYPE_MEMREF_OUTPUT,
+				TEE_PARAM_TYPE_NONE,
+				TEE_PARAM_TYPE_NONE);
+	struct aes_cipher *sess;
+	TEE_Result res;
+
+	/* Get ciphering context from session ID */
+	DMSG("Session %p: MAC final", session);
+	sess = (struct aes_cipher *)session;
+
+	/* Safely get the invocation parameters */
+	if (param_types != exp_param_types)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	if (!sess->mac_active)
+		return TEE_ERROR_BAD_STATE;
+
+	res = TEE_MACComputeFinal(sess->mac_op,
+				  params[0].memref.buffer,
+				  params[0].memref.size,
+				  params[1].memref.buffer,
+				  &params[1].memref.size);
+
+	/* A too short output keeps the MAC going */
+	if (res != TEE_ERROR_SHORT_BUFFER)
+		sess->mac_active = false;
+
+	return res;
+}
+
+/*
+ * Process command TA_AES_CMD_MAC. API in aes_ta.h
+ */
+static TEE_Result mac_oneshot(void *session, uint32_t param_types,
+			      TEE_Param params[4])
+{
+	const uint32_t exp_param_types =
+		TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT,
+				TEE_PARAM_TYPE_MEMREF_OUTPUT,
+				TEE_PARAM_TYPE_NONE,
+				TEE_PARAM_TYPE_NONE);
+	struct aes_cipher *sess;
+	TEE_Result res;
+
+	/* Get ciphering context from session ID */
+	DMSG("Session %p: MAC buffer", session);
+	sess = (struct aes_cipher *)session;
+
+	/* Safely get the invocation parameters */
+	if (param_types != exp_param_types)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	if (sess->mac_op == TEE_HANDLE_NULL)
+		return TEE_ERROR_BAD_STATE;
+
+	TEE_MACInit(sess->mac_op, NULL, 0);
+	res = TEE_MACComputeFinal(sess->mac_op,
+				  params[0].memref.buffer,
+				  params[0].memref.size,
+				  params[1].memref.buffer,
+				  &params[1].memref.size);
+	sess->mac_active = res == TEE_ERROR_SHORT_BUFFER;
+
+	return res;
 }
 
 TEE_Result TA_CreateEntryPoint(void)
@@ -388,7 +1700,13 @@ TEE_Result TA_OpenSessionEntryPoint(uint32_t __unused param_types,
 		return TEE_ERROR_OUT_OF_MEMORY;
 
 	sess->key_handle = TEE_HANDLE_NULL;
+	sess->key2_handle = TEE_HANDLE_NULL;
+	sess->dummy_handle = TEE_HANDLE_NULL;
+	sess->dummy2_handle = TEE_HANDLE_NULL;
+	sess->key_obj = TEE_HANDLE_NULL;
 	sess->op_handle = TEE_HANDLE_NULL;
+	sess->mac_op = TEE_HANDLE_NULL;
+	sess->slot = NULL;
 
 	*session = (void *)sess;
 	DMSG("Session %p: newly allocated", *session);
@@ -399,16 +1717,25 @@ TEE_Result TA_OpenSessionEntryPoint(uint32_t __unused param_types,
 void TA_CloseSessionEntryPoint(void *session)
 {
 	struct aes_cipher *sess;
+	size_t n;
 
 	/* Get ciphering context from session ID */
 	DMSG("Session %p: release session", session);
 	sess = (struct aes_cipher *)session;
 
 	/* Release the session resources */
+	for (n = 0; n < AES_OP_CACHE_SLOTS; n++)
+		free_op_slot(&sess->cache[n]);
 	if (sess->key_handle != TEE_HANDLE_NULL)
 		TEE_FreeTransientObject(sess->key_handle);
-	if (sess->op_handle != TEE_HANDLE_NULL)
-		TEE_FreeOperation(sess->op_handle);
+	if (sess->key2_handle != TEE_HANDLE_NULL)
+		TEE_FreeTransientObject(sess->key2_handle);
+	if (sess->dummy_handle != TEE_HANDLE_NULL)
+		TEE_FreeTransientObject(sess->dummy_handle);
+	if (sess->dummy2_handle != TEE_HANDLE_NULL)
+		TEE_FreeTransientObject(sess->dummy2_handle);
+	if (sess->mac_op != TEE_HANDLE_NULL)
+		TEE_FreeOperation(sess->mac_op);
 	TEE_Free(sess);
 }
 
@@ -422,10 +1749,48 @@ TEE_Result TA_InvokeCommandEntryPoint(void *session,
 		return alloc_resources(session, param_types, params);
 	case TA_AES_CMD_SET_KEY:
 		return set_aes_key(session, param_types, params);
+	case TA_AES_CMD_KEY_GENERATE:
+		return generate_stored_key(session, param_types, params);
+	case TA_AES_CMD_KEY_IMPORT:
+		return import_stored_key(session, param_types, params);
+	case TA_AES_CMD_KEY_BIND:
+		return bind_stored_key(session, param_types, params);
+	case TA_AES_CMD_KEY_DELETE:
+		return delete_stored_key(session, param_types, params);
 	case TA_AES_CMD_SET_IV:
 		return reset_aes_iv(session, param_types, params);
 	case TA_AES_CMD_CIPHER:
 		return cipher_buffer(session, param_types, params);
+	case TA_AES_CMD_CIPHER_FINAL:
+		return cipher_final(session, param_types, params);
+	case TA_AES_CMD_CIPHER_AT:
+		return cipher_at_offset(session, param_types, params);
+	case TA_AES_CMD_XTS_SECTORS:
+		return cipher_xts_sectors(session, param_types, params);
+	case TA_AES_CMD_CIPHER_BATCH:
+		return cipher_batch(session, param_types, params);
+	case TA_AES_CMD_AE_INIT:
+		return ae_init(session, param_types, params);
+	case TA_AES_CMD_AE_UPDATE_AAD:
+		return ae_update_aad(session, param_types, params);
+	case TA_AES_CMD_AE_UPDATE:
+		return ae_update(session, param_types, params);
+	case TA_AES_CMD_AE_ENCRYPT_FINAL:
+		return ae_encrypt_final(session, param_types, params);
+	case TA_AES_CMD_AE_DECRYPT_FINAL:
+		return ae_decrypt_final(session, param_types, params);
+	case TA_AES_CMD_GET_STATS:
+		return get_cache_stats(session, param_types, params);
+	case TA_AES_CMD_MAC_SET_KEY:
+		return mac_set_key(session, param_types, params);
+	case TA_AES_CMD_MAC_INIT:
+		return mac_init(session, param_types, params);
+	case TA_AES_CMD_MAC_UPDATE:
+		return mac_update(session, param_types, params);
+	case TA_AES_CMD_MAC_FINAL:
+		return mac_final(session, param_types, params);
+	case TA_AES_CMD_MAC:
+		return mac_oneshot(session, param_types, params);
 	default:
 		EMSG("Command ID 0x%x is not supported", cmd);
 		return TEE_ERROR_NOT_SUPPORTED;
@@ -28,6 +28,8 @@
 #ifndef __AES_TA_H__
 #define __AES_TA_H__
 
+#include <stdint.h>
+
 /* UUID of the AES example trusted application */
 #define TA_AES_UUID \
 	{ 0x5dbac793, 0xf574, 0x4871, \
@@ -35,8 +37,13 @@
 
 /*
  * TA_AES_CMD_PREPARE - Allocate resources for the AES ciphering
+ * The session caches a few operations: preparing again an already used
+ * (algo, key size, mode) reuses its operation, loaded with the last key
+ * set in the session. If that key does not fit the operation, a key shall
+ * be set with TA_AES_CMD_SET_KEY as for a new operation.
  * param[0] (value) a: TA_AES_ALGO_xxx, b: unused
- * param[1] (value) a: key size in bytes, b: unused
+ * param[1] (value) a: key size in bytes (size of each key for XTS),
+ *          b: unused
  * param[2] (value) a: TA_AES_MODE_ENCODE/_DECODE, b: unused
  * param[3] unused
  */
@@ -45,6 +52,8 @@
 #define TA_AES_ALGO_ECB			0
 #define TA_AES_ALGO_CBC			1
 #define TA_AES_ALGO_CTR			2
+#define TA_AES_ALGO_GCM			3
+#define TA_AES_ALGO_XTS			4
 
 #define TA_AES_SIZE_128BIT		(128 / 8)
 #define TA_AES_SIZE_256BIT		(256 / 8)
@@ -52,9 +61,16 @@
 #define TA_AES_MODE_ENCODE		1
 #define TA_AES_MODE_DECODE		0
 
+#define TA_AES_BLOCK_SIZE		16
+
+/* Tag lengths in bits supported by TA_AES_ALGO_GCM */
+#define TA_AES_GCM_TAG_MIN_BITS		96
+#define TA_AES_GCM_TAG_MAX_BITS		128
+
 /*
  * TA_AES_CMD_SET_KEY - Allocate resources for the AES ciphering
- * param[0] (memref) key data, size shall equal key length
+ * param[0] (memref) key data, size shall equal key length. For
+ *          TA_AES_ALGO_XTS, both keys concatenated: twice the key length
  * param[1] unused
  * param[2] unused
  * param[3] unused
@@ -73,10 +89,239 @@
 /*
  * TA_AES_CMD_CIPHER - Ciphere inut buffer into output buffer
  * param[0] (memref) input buffer
- * param[1] (memref) output buffer (shall be bigger than input buffer)
+ * param[1] (memref) output buffer (shall be bigger than input buffer),
+ *          updated with the output size
  * param[2] unused
  * param[3] unused
  */
 #define TA_AES_CMD_CIPHER		3
 
+/*
+ * TA_AES_CMD_GET_STATS - Get the session operation cache statistics
+ * param[0] (value) a: PREPARE cache hits, b: PREPARE cache misses
+ * param[1] unused
+ * param[2] unused
+ * param[3] unused
+ */
+#define TA_AES_CMD_GET_STATS		4
+
+/*
+ * TA_AES_CMD_CIPHER_BATCH - Cipher independent records in place
+ * Each record is ciphered from its own initial vector with the operation
+ * set by TA_AES_CMD_PREPARE/TA_AES_CMD_SET_KEY. The operation is left
+ * finalized: TA_AES_CMD_SET_IV is required before a next CIPHER.
+ * param[0] (memref) array of struct aes_batch_desc
+ * param[1] (memref) records buffer, ciphered in place
+ * param[2] unused
+ * param[3] unused
+ */
+#define TA_AES_CMD_CIPHER_BATCH		5
+
+/*
+ * TA_AES_CMD_AE_INIT - Start an authenticated encryption (TA_AES_ALGO_GCM)
+ * TA_AES_CMD_SET_IV, TA_AES_CMD_CIPHER and TA_AES_CMD_CIPHER_BATCH do not
+ * apply to TA_AES_ALGO_GCM, which uses the TA_AES_CMD_AE_xxx commands.
+ * param[0] (memref) nonce
+ * param[1] (value) a: tag length in bits, 96, 104, 112, 120 or 128
+ * param[2] unused
+ * param[3] unused
+ */
+#define TA_AES_CMD_AE_INIT		6
+
+/*
+ * TA_AES_CMD_AE_UPDATE_AAD - Feed additional authenticated data
+ * Shall be called before any payload is processed.
+ * param[0] (memref) additional authenticated data
+ * param[1] unused
+ * param[2] unused
+ * param[3] unused
+ */
+#define TA_AES_CMD_AE_UPDATE_AAD	7
+
+/*
+ * TA_AES_CMD_AE_UPDATE - Cipher a payload chunk
+ * When decrypting, the output is not authenticated until
+ * TA_AES_CMD_AE_DECRYPT_FINAL succeeds: the caller shall discard it if
+ * the final command returns TEE_ERROR_MAC_INVALID.
+ * param[0] (memref) input buffer
+ * param[1] (memref) output buffer, updated with the output size
+ * param[2] unused
+ * param[3] unused
+ */
+#define TA_AES_CMD_AE_UPDATE		8
+
+/*
+ * TA_AES_CMD_AE_ENCRYPT_FINAL - Encrypt last payload chunk, return the tag
+ * param[0] (memref) input buffer, may be empty
+ * param[1] (memref) output ciphertext, updated with the output size
+ * param[2] (memref) output tag, updated with the tag size
+ * param[3] unused
+ */
+#define TA_AES_CMD_AE_ENCRYPT_FINAL	9
+
+/*
+ * TA_AES_CMD_AE_DECRYPT_FINAL - Decrypt last payload chunk, check the tag
+ * Returns TEE_ERROR_MAC_INVALID and a zeroed output if tag does not match,
+ * the output of previous TA_AES_CMD_AE_UPDATE shall then be discarded.
+ * param[0] (memref) input buffer, may be empty
+ * param[1] (memref) output plaintext, updated with the output size
+ * param[2] (memref) tag, size shall match the tag length from AE_INIT
+ * param[3] unused
+ */
+#define TA_AES_CMD_AE_DECRYPT_FINAL	10
+
+/*
+ * TA_AES_CMD_CIPHER_FINAL - Cipher last input buffer of a stream
+ * Chaining state is kept across TA_AES_CMD_CIPHER calls; this command
+ * flushes it. For ECB and CBC, the total size shall be a multiple of
+ * TA_AES_BLOCK_SIZE. TA_AES_CMD_SET_IV is required before a next CIPHER.
+ * param[0] (memref) input buffer, may be empty
+ * param[1] (memref) output buffer, updated with the output size
+ * param[2] unused
+ * param[3] unused
+ */
+#define TA_AES_CMD_CIPHER_FINAL		11
+
+/*
+ * TA_AES_CMD_XTS_SECTORS - Cipher consecutive sectors (TA_AES_ALGO_XTS)
+ * Tweak of each sector is derived in the TA from its sector number.
+ * param[0] (memref) input buffer, a whole number of sectors
+ * param[1] (memref) output buffer, at least input size
+ * param[2] (value) a: first sector number low 32 bits, b: high 32 bits
+ * param[3] (value) a: sector size in bytes, a multiple of
+ *          TA_AES_BLOCK_SIZE, b: unused
+ */
+#define TA_AES_CMD_XTS_SECTORS		12
+
+/*
+ * Persistent key slots: AES keys kept in the TA secure storage under a
+ * client chosen 32-bit slot ID. A session binds a slot instead of sending
+ * key material with TA_AES_CMD_SET_KEY; the bound key is loaded in the
+ * operations prepared next, like a key set with TA_AES_CMD_SET_KEY.
+ * XTS operations need TA_AES_CMD_SET_KEY.
+ * A session binds a copy of the slot key: once the slot is generated,
+ * imported or deleted again, the session doing it is left without key and
+ * other sessions keep their copy until their next TA_AES_CMD_KEY_BIND.
+ */
+
+/*
+ * TA_AES_CMD_KEY_GENERATE - Generate a random key in a slot
+ * param[0] (value) a: slot ID, b: key size in bytes
+ * param[1] unused
+ * param[2] unused
+ * param[3] unused
+ */
+#define TA_AES_CMD_KEY_GENERATE		13
+
+/*
+ * TA_AES_CMD_KEY_IMPORT - Store key material in a slot
+ * param[0] (value) a: slot ID, b: unused
+ * param[1] (memref) key data, 16 or 32 bytes
+ * param[2] unused
+ * param[3] unused
+ */
+#define TA_AES_CMD_KEY_IMPORT		14
+
+/*
+ * TA_AES_CMD_KEY_BIND - Use the key of a slot as session key
+ * Returns TEE_ERROR_BAD_STATE if the key does not fit the operation
+ * prepared in the session.
+ * param[0] (value) a: slot ID, b: unused
+ * param[1] unused
+ * param[2] unused
+ * param[3] unused
+ */
+#define TA_AES_CMD_KEY_BIND		15
+
+/*
+ * TA_AES_CMD_KEY_DELETE - Remove a slot from the secure storage
+ * If the slot is bound in the session, the session is left without key:
+ * operations loaded with it need a new key before ciphering.
+ * param[0] (value) a: slot ID, b: unused
+ * param[1] unused
+ * param[2] unused
+ * param[3] unused
+ */
+#define TA_AES_CMD_KEY_DELETE		16
+
+/*
+ * TA_AES_CMD_CIPHER_AT - Cipher at a byte offset of a CTR stream
+ * The counter block is computed from the initial vector of the last
+ * TA_AES_CMD_SET_IV and the offset, no IV needs to be sent. Following
+ * TA_AES_CMD_CIPHER calls continue from the end of the ciphered data.
+ * param[0] (memref) input buffer
+ * param[1] (memref) output buffer (shall be bigger than input buffer)
+ * param[2] (value) a: byte offset low 32 bits, b: high 32 bits
+ * param[3] unused
+ */
+#define TA_AES_CMD_CIPHER_AT		17
+
+/*
+ * Keyed MAC commands. The MAC operation is independent of the ciphering
+ * one and stays keyed in the session: MACs following a
+ * TA_AES_CMD_MAC_SET_KEY skip the key setup.
+ */
+#define TA_AES_MAC_CMAC			0
+#define TA_AES_MAC_HMAC_SHA256		1
+
+#define TA_AES_CMAC_SIZE		16
+#define TA_AES_HMAC_SHA256_SIZE		32
+
+/*
+ * TA_AES_CMD_MAC_SET_KEY - Load the MAC key
+ * param[0] (value) a: TA_AES_MAC_xxx, b: unused
+ * param[1] (memref) key data, 16 or 32 bytes for CMAC, 24 to 128 bytes
+ *          for HMAC-SHA256
+ * param[2] unused
+ * param[3] unused
+ */
+#define TA_AES_CMD_MAC_SET_KEY		18
+
+/*
+ * TA_AES_CMD_MAC_INIT - Start a MAC computation
+ * param[0] unused
+ * param[1] unused
+ * param[2] unused
+ * param[3] unused
+ */
+#define TA_AES_CMD_MAC_INIT		19
+
+/*
+ * TA_AES_CMD_MAC_UPDATE - Add data to the MAC computation
+ * param[0] (memref) input data
+ * param[1] unused
+ * param[2] unused
+ * param[3] unused
+ */
+#define TA_AES_CMD_MAC_UPDATE		20
+
+/*
+ * TA_AES_CMD_MAC_FINAL - Add last data and get the MAC
+ * param[0] (memref) input data, may be empty
+ * param[1] (memref) output MAC, size updated
+ * param[2] unused
+ * param[3] unused
+ */
+#define TA_AES_CMD_MAC_FINAL		21
+
+/*
+ * TA_AES_CMD_MAC - MAC a buffer in a single invocation
+ * param[0] (memref) input data
+ * param[1] (memref) output MAC, size updated
+ * param[2] unused
+ * param[3] unused
+ */
+#define TA_AES_CMD_MAC			22
+
+/*
+ * Record descriptor for TA_AES_CMD_CIPHER_BATCH: offset and length of the
+ * record in the records buffer, and its initial vector (unused for ECB).
+ * For ECB and CBC, length shall be a multiple of TA_AES_BLOCK_SIZE.
+ */
+struct aes_batch_desc {
+	uint32_t offset;
+	uint32_t length;
+	uint8_t iv[TA_AES_BLOCK_SIZE];
+};
+
 #endif /* __AES_TA_H */
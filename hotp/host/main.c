@@ -7,7 +7,9 @@
 
 #include <err.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 /* OP-TEE TEE client API (built by optee_client) */
 #include <tee_client_api.h>
@@ -36,6 +38,492 @@ struct test_value rfc4226_test_values[] = {
 	{ 9, 520489 }
 };
 
+struct totp_test_value {
+	int64_t time;
+	uint32_t alg;
+	uint32_t expected;
+};
+
+/*
+ * Test values coming from the RFC6238 specification (T0 = 0, X = 30 and 8
+ * digits), with the seeds below.
+ */
+struct totp_test_value rfc6238_test_values[] = {
+	{ 59, HOTP_ALG_SHA1, 94287082 },
+	{ 59, HOTP_ALG_SHA256, 46119246 },
+	{ 59, HOTP_ALG_SHA512, 90693936 },
+	{ 1111111109, HOTP_ALG_SHA1, 7081804 },
+	{ 1111111109, HOTP_ALG_SHA256, 68084774 },
+	{ 1111111109, HOTP_ALG_SHA512, 25091201 },
+	{ 1111111111, HOTP_ALG_SHA1, 14050471 },
+	{ 1111111111, HOTP_ALG_SHA256, 67062674 },
+	{ 1111111111, HOTP_ALG_SHA512, 99943326 },
+	{ 1234567890, HOTP_ALG_SHA1, 89005924 },
+	{ 1234567890, HOTP_ALG_SHA256, 91819424 },
+	{ 1234567890, HOTP_ALG_SHA512, 93441116 },
+	{ 2000000000, HOTP_ALG_SHA1, 69279037 },
+	{ 2000000000, HOTP_ALG_SHA256, 90698825 },
+	{ 2000000000, HOTP_ALG_SHA512, 38618901 },
+	{ 20000000000LL, HOTP_ALG_SHA1, 65353130 },
+	{ 20000000000LL, HOTP_ALG_SHA256, 77737706 },
+	{ 20000000000LL, HOTP_ALG_SHA512, 47863826 }
+};
+
+static const char *rfc6238_seeds[HOTP_ALG_COUNT] = {
+	[HOTP_ALG_SHA1] = "12345678901234567890",
+	[HOTP_ALG_SHA256] = "12345678901234567890123456789012",
+	[HOTP_ALG_SHA512] = "1234567890123456789012345678901234567890"
+			    "123456789012345678901234",
+};
+
+/* Credential ID used for the RFC6238 test values */
+#define TOTP_TEST_ID		0x746f7470
+
+/* Number of OTPs generated by "bench" unless given on the command line */
+#define BENCH_DEFAULT_COUNT	100000
+
+/* Credential ID used by "bench" */
+#define BENCH_ID		0x62656e63
+
+/* Number of credentials used by "ids" unless given on the command line */
+#define IDS_DEFAULT_COUNT	1000
+
+/* Credential ID of the i:th user of the "ids" mode, spread over 32 bits */
+#define IDS_ID(i)		(0x10000 + (uint32_t)(i) * 0x9e37U)
+
+static double now_seconds(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Measure the rate of TA_HOTP_CMD_GET_HOTP_ID for a credential registered with
+ * the given options, HOTP_OPT_VOLATILE or not (one storage write per
+ * HOTP_COUNTER_BLOCK OTPs). Every invocation produces one OTP and moves the
+ * counter on.
+ */
+static TEEC_Result bench_hotp(TEEC_Session *sess, uint8_t *key, size_t key_len,
+			      uint32_t options, unsigned long count)
+{
+	TEEC_Operation op = { 0 };
+	TEEC_Result res = TEEC_SUCCESS;
+	uint32_t err_origin;
+	unsigned long i;
+	double start, elapsed;
+
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT,
+					 TEEC_MEMREF_TEMP_INPUT,
+					 TEEC_NONE, TEEC_NONE);
+	op.params[0].value.a = BENCH_ID;
+	op.params[0].value.b = options;
+	op.params[1].tmpref.buffer = key;
+	op.params[1].tmpref.size = key_len;
+
+	res = TEEC_InvokeCommand(sess, TA_HOTP_CMD_REGISTER_ID, &op,
+				 &err_origin);
+	if (res != TEEC_SUCCESS) {
+		fprintf(stderr, "TEEC_InvokeCommand failed with code "
+			"0x%x origin 0x%x\n", res, err_origin);
+		return res;
+	}
+
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_VALUE_OUTPUT,
+					 TEEC_NONE, TEEC_NONE);
+
+	start = now_seconds();
+	for (i = 0; i < count; i++) {
+		res = TEEC_InvokeCommand(sess, TA_HOTP_CMD_GET_HOTP_ID, &op,
+					 &err_origin);
+		if (res != TEEC_SUCCESS) {
+			fprintf(stderr, "TEEC_InvokeCommand failed with code "
+				"0x%x origin 0x%x\n", res, err_origin);
+			return res;
+		}
+	}
+	elapsed = now_seconds() - start;
+
+	fprintf(stdout, "bench: %s, %lu OTPs in %.3f s, %.0f OTPs/s\n",
+		options & HOTP_OPT_VOLATILE ? "volatile" : "persistent",
+		count, elapsed, elapsed > 0 ? count / elapsed : 0);
+
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_NONE,
+					 TEEC_NONE, TEEC_NONE);
+	TEEC_InvokeCommand(sess, TA_HOTP_CMD_DELETE_ID, &op, &err_origin);
+
+	return res;
+}
+
+static TEEC_Result invoke_id(TEEC_Session *sess, uint32_t cmd, uint32_t id,
+			     uint8_t *key, size_t key_len, uint32_t *hotp)
+{
+	TEEC_Operation op = { 0 };
+	TEEC_Result res;
+	uint32_t err_origin;
+
+	op.params[0].value.a = id;
+	if (cmd == TA_HOTP_CMD_REGISTER_ID) {
+		op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT,
+						 TEEC_MEMREF_TEMP_INPUT,
+						 TEEC_NONE, TEEC_NONE);
+		op.params[1].tmpref.buffer = key;
+		op.params[1].tmpref.size = key_len;
+	} else if (cmd == TA_HOTP_CMD_GET_HOTP_ID) {
+		op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT,
+						 TEEC_VALUE_OUTPUT,
+						 TEEC_NONE, TEEC_NONE);
+	} else {
+		op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_NONE,
+						 TEEC_NONE, TEEC_NONE);
+	}
+
+	res = TEEC_InvokeCommand(sess, cmd, &op, &err_origin);
+	if (res == TEEC_SUCCESS && hotp)
+		*hotp = op.params[1].value.a;
+
+	return res;
+}
+
+static TEEC_Result invoke_verify(TEEC_Session *sess, uint32_t id,
+				 uint32_t hotp, uint32_t window, int *match)
+{
+	TEEC_Operation op = { 0 };
+	TEEC_Result res;
+	uint32_t err_origin;
+
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_VALUE_INPUT,
+					 TEEC_VALUE_OUTPUT, TEEC_NONE);
+	op.params[0].value.a = id;
+	op.params[1].value.a = hotp;
+	op.params[1].value.b = window;
+
+	res = TEEC_InvokeCommand(sess, TA_HOTP_CMD_VERIFY, &op, &err_origin);
+	*match = res == TEEC_SUCCESS &&
+		 op.params[2].value.a == HOTP_VERIFY_MATCH;
+
+	return res;
+}
+
+/*
+ * Server side verification: a user whose token ran ahead of the counter is
+ * accepted within the window and the counter follows, a replayed or too far
+ * ahead value is refused without moving the counter. Then time a window that
+ * never matches to get the HMAC rate of a single invocation.
+ */
+static int test_verify(TEEC_Session *sess, uint8_t *key, size_t key_len,
+		       unsigned long window)
+{
+	const uint32_t id = IDS_ID(1);
+	uint32_t hotp_value = 0;
+	unsigned long i, count = 0;
+	double start, elapsed;
+	int match, errors = 0;
+
+	if (invoke_id(sess, TA_HOTP_CMD_REGISTER_ID, id, key, key_len, NULL)) {
+		fprintf(stderr, "verify: register failed\n");
+		return 1;
+	}
+
+	/* Counter 0, the token is at 3: found within a window of 4 */
+	if (invoke_verify(sess, id, rfc4226_test_values[3].expected, 4,
+			  &match) || !match)
+		errors++;
+	/* Counter 4: replaying 3 must fail */
+	if (invoke_verify(sess, id, rfc4226_test_values[3].expected, 4,
+			  &match) || match)
+		errors++;
+	/* Counter 4, the token is at 5: out of a window of 1, in one of 2 */
+	if (invoke_verify(sess, id, rfc4226_test_values[5].expected, 1,
+			  &match) || match)
+		errors++;
+	if (invoke_verify(sess, id, rfc4226_test_values[5].expected, 2,
+			  &match) || !match)
+		errors++;
+	/* Counter 6 */
+	if (invoke_id(sess, TA_HOTP_CMD_GET_HOTP_ID, id, NULL, 0,
+		      &hotp_value) ||
+	    hotp_value != rfc4226_test_values[6].expected)
+		errors++;
+	/* No window, or one too large, is refused */
+	if (invoke_verify(sess, id, hotp_value, 0, &match) !=
+	    TEEC_ERROR_BAD_PARAMETERS ||
+	    invoke_verify(sess, id, hotp_value, HOTP_MAX_WINDOW + 1,
+			  &match) != TEEC_ERROR_BAD_PARAMETERS)
+		errors++;
+
+	/* Almost never a match: each invocation computes the whole window */
+	start = now_seconds();
+	for (i = 0; i < 100; i++) {
+		if (invoke_verify(sess, id, 999999, window, &match))
+			errors++;
+		if (!match)
+			count += window;
+	}
+	elapsed = now_seconds() - start;
+
+	invoke_id(sess, TA_HOTP_CMD_DELETE_ID, id, NULL, 0, NULL);
+
+	fprintf(stdout, "verify: window %lu, %.0f HMACs/s, %d errors\n",
+		window, elapsed > 0 ? count / elapsed : 0, errors);
+
+	return errors ? 1 : 0;
+}
+
+/*
+ * Register a TOTP credential whose current time step is the one of an RFC6238
+ * time, plus shift steps. The test values are then reached by choosing T0,
+ * with X / 2 seconds of margin on both sides of the current time.
+ */
+static TEEC_Result register_totp(TEEC_Session *sess, uint32_t id,
+				 const struct totp_test_value *tv, int shift)
+{
+	const char *seed = rfc6238_seeds[tv->alg];
+	TEEC_Operation op = { 0 };
+	uint32_t err_origin;
+	int64_t t0;
+
+	t0 = (int64_t)time(NULL) -
+	     (tv->time / TOTP_DEFAULT_STEP + shift) * TOTP_DEFAULT_STEP -
+	     TOTP_DEFAULT_STEP / 2;
+
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT,
+					 TEEC_MEMREF_TEMP_INPUT,
+					 TEEC_VALUE_INPUT, TEEC_VALUE_INPUT);
+	op.params[0].value.a = id;
+	op.params[0].value.b = HOTP_OPTIONS(tv->alg, 8);
+	op.params[1].tmpref.buffer = (void *)seed;
+	op.params[1].tmpref.size = strlen(seed);
+	op.params[2].value.a = TOTP_DEFAULT_STEP;
+	op.params[3].value.a = (uint32_t)t0;
+	op.params[3].value.b = (uint32_t)((uint64_t)t0 >> 32);
+
+	return TEEC_InvokeCommand(sess, TA_HOTP_CMD_REGISTER_TOTP, &op,
+				  &err_origin);
+}
+
+static TEEC_Result invoke_verify_totp(TEEC_Session *sess, uint32_t id,
+				      uint32_t totp, uint32_t skew, int *match)
+{
+	TEEC_Operation op = { 0 };
+	TEEC_Result res;
+	uint32_t err_origin;
+
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_VALUE_INPUT,
+					 TEEC_VALUE_OUTPUT, TEEC_NONE);
+	op.params[0].value.a = id;
+	op.params[1].value.a = totp;
+	op.params[1].value.b = skew;
+
+	res = TEEC_InvokeCommand(sess, TA_HOTP_CMD_VERIFY_TOTP, &op,
+				 &err_origin);
+	*match = res == TEEC_SUCCESS &&
+		 op.params[2].value.a == HOTP_VERIFY_MATCH;
+
+	return res;
+}
+
+/*
+ * Get the TOTP values of the RFC6238 test times, then check the verification
+ * of a value within the skew window, and that it is accepted only once.
+ */
+static int test_totp(TEEC_Session *sess)
+{
+	size_t count = sizeof(rfc6238_test_values) /
+		       sizeof(struct totp_test_value);
+	const struct totp_test_value *tv = NULL;
+	TEEC_Operation op = { 0 };
+	TEEC_Result res;
+	uint32_t err_origin;
+	size_t i;
+	int match, errors = 0;
+
+	for (i = 0; i < count; i++) {
+		tv = &rfc6238_test_values[i];
+
+		res = register_totp(sess, TOTP_TEST_ID, tv, 0);
+		if (res != TEEC_SUCCESS) {
+			fprintf(stderr, "TOTP register failed with code "
+				"0x%x\n", res);
+			return 1;
+		}
+
+		op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT,
+						 TEEC_VALUE_OUTPUT,
+						 TEEC_NONE, TEEC_NONE);
+		op.params[0].value.a = TOTP_TEST_ID;
+		res = TEEC_InvokeCommand(sess, TA_HOTP_CMD_GET_TOTP, &op,
+					 &err_origin);
+		if (res != TEEC_SUCCESS) {
+			fprintf(stderr, "TEEC_InvokeCommand failed with code "
+				"0x%x origin 0x%x\n", res, err_origin);
+			return 1;
+		}
+
+		fprintf(stdout, "TOTP: %08u\n", op.params[1].value.a);
+
+		if (op.params[1].value.a != tv->expected) {
+			fprintf(stderr, "Got unexpected TOTP from TEE! "
+				"Expected: %08u, got: %08u\n",
+				tv->expected, op.params[1].value.a);
+			errors++;
+		}
+	}
+
+	/* The last value: matches without skew, but only once */
+	if (invoke_verify_totp(sess, TOTP_TEST_ID, tv->expected, 0, &match) ||
+	    !match)
+		errors++;
+	if (invoke_verify_totp(sess, TOTP_TEST_ID, tv->expected, 1, &match) ||
+	    match)
+		errors++;
+
+	/* One step later: out of a skew of 0, in one of 1 */
+	if (register_totp(sess, TOTP_TEST_ID, tv, 1) ||
+	    invoke_verify_totp(sess, TOTP_TEST_ID, tv->expected, 0, &match) ||
+	    match)
+		errors++;
+	if (invoke_verify_totp(sess, TOTP_TEST_ID, tv->expected, 1, &match) ||
+	    !match)
+		errors++;
+
+	/* TOTP credentials are refused by the HOTP commands */
+	if (invoke_id(sess, TA_HOTP_CMD_GET_HOTP_ID, TOTP_TEST_ID, NULL, 0,
+		      NULL) != TEEC_ERROR_BAD_STATE)
+		errors++;
+
+	invoke_id(sess, TA_HOTP_CMD_DELETE_ID, TOTP_TEST_ID, NULL, 0, NULL);
+
+	if (errors)
+		fprintf(stderr, "TOTP: %d errors\n", errors);
+
+	return errors ? 1 : 0;
+}
+
+/*
+ * A persistent HOTP counter never goes back across a TA restart. Drive the
+ * counter of a credential past its first reserved block, drop it from the TA
+ * memory so that it is read back from secure storage, then check the counter
+ * resumes from the end of the last reserved block and the OTPs generated
+ * before are refused. The expected OTP comes from a second credential with
+ * the same key walked up to that counter value.
+ */
+static int test_restart(TEEC_Session *sess, uint8_t *key, size_t key_len)
+{
+	const uint32_t id = IDS_ID(2);
+	const uint32_t ref_id = IDS_ID(3);
+	/* Leaving the first block reserves up to 2 * HOTP_COUNTER_BLOCK */
+	const unsigned long used = HOTP_COUNTER_BLOCK + 10;
+	const unsigned long resumed = 2 * HOTP_COUNTER_BLOCK;
+	uint32_t last = 0, expected = 0, hotp_value = 0;
+	unsigned long i;
+	int match, errors = 0;
+
+	if (invoke_id(sess, TA_HOTP_CMD_REGISTER_ID, id, key, key_len, NULL) ||
+	    invoke_id(sess, TA_HOTP_CMD_REGISTER_ID, ref_id, key, key_len,
+		      NULL)) {
+		fprintf(stderr, "restart: register failed\n");
+		return 1;
+	}
+
+	for (i = 0; i < used; i++)
+		if (invoke_id(sess, TA_HOTP_CMD_GET_HOTP_ID, id, NULL, 0,
+			      &last))
+			errors++;
+	for (i = 0; i <= resumed; i++)
+		if (invoke_id(sess, TA_HOTP_CMD_GET_HOTP_ID, ref_id, NULL, 0,
+			      &expected))
+			errors++;
+
+	/* As after a restart of the TA */
+	if (invoke_id(sess, TA_HOTP_CMD_UNLOAD_ID, id, NULL, 0, NULL))
+		errors++;
+
+	/* The last OTP before the restart is out of reach of the counter */
+	if (invoke_verify(sess, id, last, HOTP_MAX_WINDOW, &match) || match)
+		errors++;
+
+	if (invoke_id(sess, TA_HOTP_CMD_GET_HOTP_ID, id, NULL, 0,
+		      &hotp_value) || hotp_value != expected)
+		errors++;
+
+	fprintf(stdout, "HOTP after restart: %d\n", hotp_value);
+
+	invoke_id(sess, TA_HOTP_CMD_DELETE_ID, id, NULL, 0, NULL);
+	invoke_id(sess, TA_HOTP_CMD_DELETE_ID, ref_id, NULL, 0, NULL);
+
+	if (errors)
+		fprintf(stderr, "restart: %d errors\n", errors);
+
+	return errors ? 1 : 0;
+}
+
+/*
+ * Exercise the credential table: register count users sharing the RFC4226
+ * key, walk the test values for all of them in turn (each user has its own
+ * counter), delete every other user on the way and check they are gone.
+ */
+static int test_ids(TEEC_Session *sess, uint8_t *key, size_t key_len,
+		    unsigned long count)
+{
+	size_t rounds = sizeof(rfc4226_test_values) / sizeof(struct test_value);
+	unsigned long i, otps = 0;
+	uint32_t hotp_value;
+	TEEC_Result res;
+	double start, elapsed = 0;
+	size_t r;
+	int errors = 0;
+
+	for (i = 0; i < count; i++) {
+		res = invoke_id(sess, TA_HOTP_CMD_REGISTER_ID, IDS_ID(i),
+				key, key_len, NULL);
+		if (res != TEEC_SUCCESS) {
+			fprintf(stderr, "ids: register of %lu failed with code "
+				"0x%x\n", i, res);
+			return 1;
+		}
+	}
+
+	for (r = 0; r < rounds; r++) {
+		/* Half way through, drop the users with an even index */
+		if (r == rounds / 2) {
+			for (i = 0; i < count; i += 2)
+				if (invoke_id(sess, TA_HOTP_CMD_DELETE_ID,
+					      IDS_ID(i), NULL, 0, NULL))
+					errors++;
+		}
+
+		start = now_seconds();
+		for (i = 0; i < count; i++) {
+			res = invoke_id(sess, TA_HOTP_CMD_GET_HOTP_ID,
+					IDS_ID(i), NULL, 0, &hotp_value);
+			if (r >= rounds / 2 && !(i & 1)) {
+				if (res != TEEC_ERROR_ITEM_NOT_FOUND)
+					errors++;
+				continue;
+			}
+
+			otps++;
+			if (res != TEEC_SUCCESS ||
+			    hotp_value != rfc4226_test_values[r].expected)
+				errors++;
+		}
+		elapsed += now_seconds() - start;
+	}
+
+	for (i = 1; i < count; i += 2)
+		if (invoke_id(sess, TA_HOTP_CMD_DELETE_ID, IDS_ID(i), NULL, 0,
+			      NULL))
+			errors++;
+
+	fprintf(stdout, "ids: %lu users, %lu OTPs in %.3f s, %.0f OTPs/s, "
+		"%d errors\n", count, otps, elapsed,
+		elapsed > 0 ? otps / elapsed : 0, errors);
+
+	return errors ? 1 : 0;
+}
+
 int main(int argc, char *argv[])
 {
 	TEEC_Context ctx;
@@ -85,6 +573,30 @@ int main(int argc, char *argv[])
 		goto exit;
 	}
 
+	/* Optional: "bench [count]" measures the OTP rate instead */
+	if (argc > 1 && !strcmp(argv[1], "bench")) {
+		unsigned long count = argc > 2 ? strtoul(argv[2], NULL, 0) :
+				      BENCH_DEFAULT_COUNT;
+
+		if (!bench_hotp(&sess, K, sizeof(K), HOTP_OPT_VOLATILE, count))
+			bench_hotp(&sess, K, sizeof(K), 0, count);
+		goto exit;
+	}
+
+	/* Optional: "verify [window]" tests the server side verification */
+	if (argc > 1 && !strcmp(argv[1], "verify")) {
+		test_verify(&sess, K, sizeof(K), argc > 2 ?
+			    strtoul(argv[2], NULL, 0) : HOTP_MAX_WINDOW);
+		goto exit;
+	}
+
+	/* Optional: "ids [count]" tests the credential table instead */
+	if (argc > 1 && !strcmp(argv[1], "ids")) {
+		test_ids(&sess, K, sizeof(K), argc > 2 ?
+			 strtoul(argv[2], NULL, 0) : IDS_DEFAULT_COUNT);
+		goto exit;
+	}
+
 	/* 2. Get HMAC based One Time Passwords */
 	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_OUTPUT, TEEC_NONE,
 					 TEEC_NONE, TEEC_NONE);
@@ -108,6 +620,12 @@ int main(int argc, char *argv[])
 				rfc4226_test_values[i].expected, hotp_value);
 		}
 	}
+
+	/* 3. Get time based One Time Passwords */
+	test_totp(&sess);
+
+	/* 4. Resume a persistent counter as after a TA restart */
+	test_restart(&sess, K, sizeof(K));
 exit:
 	TEEC_CloseSession(&sess);
 	TEEC_FinalizeContext(&ctx);
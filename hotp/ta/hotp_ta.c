@@ -9,127 +9,741 @@
 #include <tee_internal_api_extensions.h>
 #include <tee_internal_api.h>
 
-/* The size of a SHA1 hash in bytes. */
-#define SHA1_HASH_SIZE 20
+/* The size of the largest (SHA512) hash in bytes. */
+#define MAX_HASH_SIZE 64
 
-/* GP says that for HMAC SHA-1, max is 512 bits and min 80 bits. */
+/*
+ * GP says that for HMAC SHA-1, max is 512 bits and min 80 bits. SHA-256 and
+ * SHA-512 need at least 192 and 256 bits, keys are kept up to 512 bits.
+ */
 #define MAX_KEY_SIZE 64 /* In bytes */
-#define MIN_KEY_SIZE 10 /* In bytes */
 
-/* Dynamic Binary Code 2 Modulo, which is 10^6 according to the spec. */
-#define DBC2_MODULO 1000000
+/* Initial size of the credential index (bits) and of the credential array */
+#define CRED_MIN_BITS	4
+#define CRED_MIN_COUNT	16
+
+/* Marks a free slot of the credential index */
+#define CRED_SLOT_EMPTY	0xffffffff
+
+/* Persistent object of a credential: the prefix followed by the ID */
+#define CRED_OBJ_ID_PREFIX	"hotp.cred."
+#define CRED_OBJ_ID_SIZE	(sizeof(CRED_OBJ_ID_PREFIX) - 1 + \
+				 sizeof(uint32_t))
 
 /*
- * Currently this only supports a single key, in the future this could be
- * updated to support multiple users, all with different unique keys (stored
- * using secure storage).
+ * The HMAC algorithms of the OTPs, indexed by HOTP_ALG_*.
  */
-static uint8_t K[MAX_KEY_SIZE];
-static uint32_t K_len;
+static const struct hotp_alg {
+	uint32_t algo;		/* TEE_ALG_HMAC_* */
+	uint32_t key_type;	/* TEE_TYPE_HMAC_* */
+	uint32_t min_key_size;	/* In bytes */
+	uint32_t hash_size;	/* In bytes */
+} hotp_algs[HOTP_ALG_COUNT] = {
+	[HOTP_ALG_SHA1] = { TEE_ALG_HMAC_SHA1, TEE_TYPE_HMAC_SHA1, 10, 20 },
+	[HOTP_ALG_SHA256] = { TEE_ALG_HMAC_SHA256, TEE_TYPE_HMAC_SHA256, 24, 32 },
+	[HOTP_ALG_SHA512] = { TEE_ALG_HMAC_SHA512, TEE_TYPE_HMAC_SHA512, 32, 64 },
+};
 
-/* The counter as defined by RFC4226. */
-static uint8_t counter[] = { 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0 };
+/* Dynamic Binary Code 2 Modulo, 10^Digit as RFC4226 puts it. */
+static const uint32_t dbc2_modulo[] = {
+	[6] = 1000000, [7] = 10000000, [8] = 100000000,
+};
 
 /*
- *  HMAC a block of memory to produce the authentication tag
- *  @param key       The secret key
- *  @param keylen    The length of the secret key (bytes)
- *  @param in        The data to HMAC
- *  @param inlen     The length of the data to HMAC (bytes)
- *  @param out       [out] Destination of the authentication tag
- *  @param outlen    [in/out] Max size and resulting size of authentication tag
+ * The shared key K and the counter C of one user, as defined by RFC4226.
+ *
+ * A TOTP credential (RFC6238) also has the time step X and the origin T0 of
+ * the time steps. Its counter is the first time step that can still be
+ * accepted by a verification, so that an OTP is accepted only once.
+ *
+ * Unless registered with HOTP_OPT_VOLATILE, a credential is also kept in a
+ * persistent object along with the reserved counter: the counter values below
+ * it may have been used already, the TA starts from there after a restart.
+ * The counter never gets past the reserved one, which is moved HOTP counter
+ * blocks at a time (one write per HOTP_COUNTER_BLOCK OTPs) and by single time
+ * steps for TOTP (one write per accepted OTP).
+ *
+ * The credentials are packed in a dense array, the index below maps an ID to
+ * its position in that array.
+ */
+struct hotp_cred {
+	uint64_t counter;
+	uint64_t reserved;
+	int64_t t0;
+	uint32_t id;
+	uint32_t step;		/* 0 for a HOTP credential */
+	uint8_t key_len;
+	uint8_t alg;		/* HOTP_ALG_* */
+	uint8_t digits;
+	uint8_t system_time;	/* TOTP: TEE_GetSystemTime, not TEE_GetREETime */
+	uint8_t persistent;
+	uint8_t key[MAX_KEY_SIZE];
+};
+
+/*
+ * Slot of the credential index: an open addressing hash table with linear
+ * probing. The ID is kept next to the position so that probing does not have
+ * to touch the credentials themselves.
  */
-static TEE_Result hmac_sha1(const uint8_t *key, const size_t keylen,
-			    const uint8_t *in, const size_t inlen,
-			    uint8_t *out, uint32_t *outlen)
+struct hotp_slot {
+	uint32_t id;
+	uint32_t cred;
+};
+
+static struct hotp_slot *slots;
+static uint32_t slots_bits;	/* The index has (1 << slots_bits) slots */
+static struct hotp_cred *creds;
+static uint32_t creds_count;
+static uint32_t creds_max;	/* Allocated entries of creds[] */
+
+/*
+ * One HMAC operation and key object per algorithm are allocated when the TA
+ * is created and reused by all the credentials. An operation stays keyed for
+ * the last credential using it (hmac_id) so that consecutive OTPs of the same
+ * user only reset it with TEE_MACInit.
+ */
+static TEE_OperationHandle hmac_op[HOTP_ALG_COUNT];
+static TEE_ObjectHandle hmac_key[HOTP_ALG_COUNT];
+static uint32_t hmac_id[HOTP_ALG_COUNT];
+static bool hmac_keyed[HOTP_ALG_COUNT];
+
+/*
+ * Fibonacci hashing of a credential ID into the index, IDs handed out in
+ * sequence end up spread over the whole table.
+ */
+static uint32_t cred_hash(uint32_t id)
+{
+	return (id * 0x9e3779b9U) >> (32 - slots_bits);
+}
+
+/*
+ * Return the slot holding the ID, or the free slot where it would be inserted.
+ * The index is never full, so the probing always ends.
+ */
+static uint32_t cred_slot(uint32_t id)
+{
+	uint32_t mask = (1U << slots_bits) - 1;
+	uint32_t i = cred_hash(id);
+
+	while (slots[i].cred != CRED_SLOT_EMPTY && slots[i].id != id)
+		i = (i + 1) & mask;
+
+	return i;
+}
+
+static struct hotp_cred *cred_find(uint32_t id)
+{
+	uint32_t i;
+
+	if (!slots)
+		return NULL;
+
+	i = cred_slot(id);
+	if (slots[i].cred == CRED_SLOT_EMPTY)
+		return NULL;
+
+	return &creds[slots[i].cred];
+}
+
+/*
+ * Rebuild the index with (1 << bits) slots from the credential array.
+ */
+static TEE_Result cred_rehash(uint32_t bits)
+{
+	struct hotp_slot *old = slots;
+	uint32_t i;
+
+	slots = TEE_Malloc(sizeof(*slots) << bits, TEE_MALLOC_FILL_ZERO);
+	if (!slots) {
+		slots = old;
+		return TEE_ERROR_OUT_OF_MEMORY;
+	}
+
+	slots_bits = bits;
+	for (i = 0; i < (1U << bits); i++)
+		slots[i].cred = CRED_SLOT_EMPTY;
+
+	for (i = 0; i < creds_count; i++) {
+		uint32_t s = cred_slot(creds[i].id);
+
+		slots[s].id = creds[i].id;
+		slots[s].cred = i;
+	}
+
+	TEE_Free(old);
+	return TEE_SUCCESS;
+}
+
+/*
+ * Return the credential of the ID, adding a blank one (no key, counter 0) if
+ * the ID is not known yet.
+ */
+static TEE_Result cred_insert(uint32_t id, struct hotp_cred **cred)
 {
-	TEE_Attribute attr = { 0 };
-	TEE_ObjectHandle key_handle = TEE_HANDLE_NULL;
-	TEE_OperationHandle op_handle = TEE_HANDLE_NULL;
 	TEE_Result res = TEE_SUCCESS;
+	uint32_t s;
 
-	if (keylen < MIN_KEY_SIZE || keylen > MAX_KEY_SIZE)
-		return TEE_ERROR_BAD_PARAMETERS;
+	*cred = cred_find(id);
+	if (*cred)
+		return TEE_SUCCESS;
 
-	if (!in || !out || !outlen)
-		return TEE_ERROR_BAD_PARAMETERS;
+	if (creds_count >= HOTP_MAX_CREDENTIALS)
+		return TEE_ERROR_OUT_OF_MEMORY;
 
-	/*
-	 * 1. Allocate cryptographic (operation) handle for the HMAC operation.
-	 *    Note that the expected size here is in bits (and therefore times
-	 *    8)!
-	 */
-	res = TEE_AllocateOperation(&op_handle, TEE_ALG_HMAC_SHA1, TEE_MODE_MAC,
-				    keylen * 8);
-	if (res != TEE_SUCCESS) {
-		EMSG("0x%08x", res);
-		goto exit;
+	/* 1. Keep the index at most 3/4 full */
+	if (!slots || (creds_count + 1) * 4 > (3U << slots_bits)) {
+		res = cred_rehash(slots ? slots_bits + 1 : CRED_MIN_BITS);
+		if (res != TEE_SUCCESS)
+			return res;
+	}
+
+	/* 2. Make room in the credential array */
+	if (creds_count == creds_max) {
+		uint32_t max = creds_max ? creds_max * 2 : CRED_MIN_COUNT;
+		struct hotp_cred *c = NULL;
+
+		if (max > HOTP_MAX_CREDENTIALS)
+			max = HOTP_MAX_CREDENTIALS;
+
+		c = TEE_Realloc(creds, max * sizeof(*c));
+		if (!c)
+			return TEE_ERROR_OUT_OF_MEMORY;
+
+		creds = c;
+		creds_max = max;
 	}
 
+	/* 3. Append the credential and index it */
+	s = cred_slot(id);
+	slots[s].id = id;
+	slots[s].cred = creds_count;
+
+	*cred = &creds[creds_count++];
+	TEE_MemFill(*cred, 0, sizeof(**cred));
+	(*cred)->id = id;
+
+	return TEE_SUCCESS;
+}
+
+static TEE_Result cred_remove(uint32_t id)
+{
+	uint32_t mask = (1U << slots_bits) - 1;
+	uint32_t i, j, k, pos;
+
+	if (!cred_find(id))
+		return TEE_ERROR_ITEM_NOT_FOUND;
+
+	i = cred_slot(id);
+	pos = slots[i].cred;
+
 	/*
-	 * 2. Allocate a container (key handle) for the HMAC attributes. Note
-	 *    that the expected size here is in bits (and therefore times 8)!
+	 * 1. Free the slot, shifting back the entries probed past it so that
+	 *    no tombstone is needed: an entry at j whose home slot k is not
+	 *    cyclically within (i, j] can fill the hole at i.
 	 */
-	res = TEE_AllocateTransientObject(TEE_TYPE_HMAC_SHA1, keylen * 8,
-					  &key_handle);
-	if (res != TEE_SUCCESS) {
-		EMSG("0x%08x", res);
-		goto exit;
+	for (;;) {
+		slots[i].cred = CRED_SLOT_EMPTY;
+		j = i;
+		do {
+			j = (j + 1) & mask;
+			if (slots[j].cred == CRED_SLOT_EMPTY)
+				goto shifted;
+			k = cred_hash(slots[j].id);
+		} while (i <= j ? (i < k && k <= j) : (i < k || k <= j));
+
+		slots[i] = slots[j];
+		i = j;
 	}
+shifted:
+
+	/* 2. Keep creds[] dense by moving the last credential into the hole */
+	creds_count--;
+	if (pos != creds_count) {
+		creds[pos] = creds[creds_count];
+		slots[cred_slot(creds[pos].id)].cred = pos;
+	}
+	TEE_MemFill(&creds[creds_count], 0, sizeof(creds[creds_count]));
+
+	return TEE_SUCCESS;
+}
+
+static void cred_object_id(uint32_t id, uint8_t obj_id[CRED_OBJ_ID_SIZE])
+{
+	size_t prefix_sz = sizeof(CRED_OBJ_ID_PREFIX) - 1;
+
+	TEE_MemMove(obj_id, CRED_OBJ_ID_PREFIX, prefix_sz);
+	TEE_MemMove(obj_id + prefix_sz, &id, sizeof(id));
+}
+
+/*
+ * Write the persistent object of a credential, with the reserved counter as
+ * its counter. The object is replaced as a whole: an interrupted write leaves
+ * the previous one.
+ */
+static TEE_Result cred_store(const struct hotp_cred *cred)
+{
+	uint8_t obj_id[CRED_OBJ_ID_SIZE];
+	struct hotp_cred rec = *cred;
+	TEE_Result res = TEE_SUCCESS;
+
+	rec.counter = cred->reserved;
+
+	cred_object_id(cred->id, obj_id);
+	res = TEE_CreatePersistentObject(TEE_STORAGE_PRIVATE,
+					 obj_id, sizeof(obj_id),
+					 TEE_DATA_FLAG_ACCESS_READ |
+					 TEE_DATA_FLAG_OVERWRITE,
+					 TEE_HANDLE_NULL, &rec, sizeof(rec),
+					 NULL);
+	if (res != TEE_SUCCESS)
+		EMSG("Credential 0x%08x: create failed 0x%x", cred->id, res);
+
+	TEE_MemFill(&rec, 0, sizeof(rec));
+
+	return res;
+}
+
+static TEE_Result cred_unstore(uint32_t id)
+{
+	uint8_t obj_id[CRED_OBJ_ID_SIZE];
+	TEE_ObjectHandle obj = TEE_HANDLE_NULL;
+	TEE_Result res = TEE_SUCCESS;
+
+	cred_object_id(id, obj_id);
+	res = TEE_OpenPersistentObject(TEE_STORAGE_PRIVATE,
+				       obj_id, sizeof(obj_id),
+				       TEE_DATA_FLAG_ACCESS_WRITE_META, &obj);
+	if (res != TEE_SUCCESS)
+		return res;
+
+	return TEE_CloseAndDeletePersistentObject1(obj);
+}
+
+/*
+ * Bring the persistent object of a credential into the table. The counter
+ * restarts from the reserved one, skipping what was left of its block.
+ */
+static TEE_Result cred_load(uint32_t id, struct hotp_cred **cred)
+{
+	uint8_t obj_id[CRED_OBJ_ID_SIZE];
+	TEE_ObjectHandle obj = TEE_HANDLE_NULL;
+	TEE_Result res = TEE_SUCCESS;
+	struct hotp_cred rec;
+	uint32_t count = 0;
+
+	cred_object_id(id, obj_id);
+	res = TEE_OpenPersistentObject(TEE_STORAGE_PRIVATE,
+				       obj_id, sizeof(obj_id),
+				       TEE_DATA_FLAG_ACCESS_READ, &obj);
+	if (res != TEE_SUCCESS)
+		return res;
+
+	res = TEE_ReadObjectData(obj, &rec, sizeof(rec), &count);
+	TEE_CloseObject(obj);
+
+	if (res == TEE_SUCCESS &&
+	    (count != sizeof(rec) || rec.id != id || !rec.persistent ||
+	     rec.alg >= HOTP_ALG_COUNT || rec.digits < HOTP_MIN_DIGITS ||
+	     rec.digits > HOTP_MAX_DIGITS || rec.key_len > MAX_KEY_SIZE ||
+	     rec.counter != rec.reserved)) {
+		EMSG("Credential 0x%08x: bad object", id);
+		res = TEE_ERROR_CORRUPT_OBJECT;
+	}
+
+	if (res == TEE_SUCCESS)
+		res = cred_insert(id, cred);
+	if (res == TEE_SUCCESS)
+		**cred = rec;
+
+	TEE_MemFill(&rec, 0, sizeof(rec));
+
+	return res;
+}
+
+/*
+ * Make sure that the counter can be moved up to next, reserving a new range
+ * in the persistent object first if needed. On error the counter must not
+ * move.
+ */
+static TEE_Result cred_reserve(struct hotp_cred *cred, uint64_t next)
+{
+	uint64_t reserved = cred->reserved;
+	TEE_Result res = TEE_SUCCESS;
+
+	if (!cred->persistent || next <= cred->reserved)
+		return TEE_SUCCESS;
+
+	if (cred->step)
+		cred->reserved = next;
+	else
+		cred->reserved = next + HOTP_COUNTER_BLOCK - 1;
+
+	res = cred_store(cred);
+	if (res != TEE_SUCCESS)
+		cred->reserved = reserved;
+
+	return res;
+}
+
+/*
+ * Forget the credential the HMAC operations are keyed for, when its key
+ * changes or it is deleted.
+ */
+static void hmac_forget(uint32_t id)
+{
+	int i;
+
+	for (i = 0; i < HOTP_ALG_COUNT; i++)
+		if (hmac_id[i] == id)
+			hmac_keyed[i] = false;
+}
+
+/*
+ *  Key the shared HMAC operation of the credential's algorithm with its key
+ *  @param cred      The credential holding the secret key
+ */
+static TEE_Result hmac_set_key(const struct hotp_cred *cred)
+{
+	TEE_Attribute attr = { 0 };
+	TEE_Result res = TEE_SUCCESS;
+	uint8_t a = cred->alg;
+
+	if (hmac_keyed[a] && hmac_id[a] == cred->id)
+		return TEE_SUCCESS;
+
+	/* The operation is keyed with something else (or nothing) from now */
+	hmac_keyed[a] = false;
 
 	/*
-	 * 3. Initialize the attributes, i.e., point to the actual HMAC key.
-	 *    Here, the expected size is in bytes and not bits as above!
+	 * 1. Initialize the attributes, i.e., point to the actual HMAC key.
+	 *    Here, the expected size is in bytes and not bits!
 	 */
-	TEE_InitRefAttribute(&attr, TEE_ATTR_SECRET_VALUE, key, keylen);
+	TEE_InitRefAttribute(&attr, TEE_ATTR_SECRET_VALUE, cred->key,
+			     cred->key_len);
 
-	/* 4. Populate/assign the attributes with the key object */
-	res = TEE_PopulateTransientObject(key_handle, &attr, 1);
+	/* 2. Populate/assign the attributes with the (emptied) key object */
+	TEE_ResetTransientObject(hmac_key[a]);
+	res = TEE_PopulateTransientObject(hmac_key[a], &attr, 1);
 	if (res != TEE_SUCCESS) {
 		EMSG("0x%08x", res);
-		goto exit;
+		return res;
 	}
 
-	/* 5. Associate the key (object) with the operation */
-	res = TEE_SetOperationKey(op_handle, key_handle);
+	/*
+	 * 3. Associate the key (object) with the operation. The operation keeps
+	 *    its own copy of the key, the object can be reset right away.
+	 */
+	res = TEE_SetOperationKey(hmac_op[a], hmac_key[a]);
+	TEE_ResetTransientObject(hmac_key[a]);
 	if (res != TEE_SUCCESS) {
 		EMSG("0x%08x", res);
-		goto exit;
+		return res;
 	}
 
-	/* 6. Do the HMAC operations */
-	TEE_MACInit(op_handle, NULL, 0);
-	TEE_MACUpdate(op_handle, in, inlen);
-	res = TEE_MACComputeFinal(op_handle, NULL, 0, out, outlen);
-exit:
-	if (op_handle != TEE_HANDLE_NULL)
-		TEE_FreeOperation(op_handle);
+	hmac_id[a] = cred->id;
+	hmac_keyed[a] = true;
 
-	/* It is OK to call this when key_handle is TEE_HANDLE_NULL */
-	TEE_FreeTransientObject(key_handle);
+	return TEE_SUCCESS;
+}
 
-	return res;
+/*
+ *  HMAC a block of memory to produce the authentication tag
+ *  @param cred      The credential holding the secret key
+ *  @param in        The data to HMAC
+ *  @param inlen     The length of the data to HMAC (bytes)
+ *  @param out       [out] Destination of the authentication tag
+ *  @param outlen    [in/out] Max size and resulting size of authentication tag
+ */
+static TEE_Result hmac(const struct hotp_cred *cred,
+		       const uint8_t *in, const size_t inlen,
+		       uint8_t *out, uint32_t *outlen)
+{
+	TEE_Result res = TEE_SUCCESS;
+
+	if (!in || !out || !outlen)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	res = hmac_set_key(cred);
+	if (res != TEE_SUCCESS)
+		return res;
+
+	/* Restart the keyed operation and do the HMAC operations */
+	TEE_MACInit(hmac_op[cred->alg], NULL, 0);
+	TEE_MACUpdate(hmac_op[cred->alg], in, inlen);
+	return TEE_MACComputeFinal(hmac_op[cred->alg], NULL, 0, out, outlen);
 }
 
 /*
- * Truncate function working as described in RFC4226.
+ * Truncate function working as described in RFC4226, the offset comes from
+ * the last byte of the HMAC whatever its size (RFC6238).
  */
-static void truncate(uint8_t *hmac_result, uint32_t *bin_code)
+static void truncate(uint8_t *hmac_result, uint32_t hmac_len, uint32_t digits,
+		     uint32_t *bin_code)
 {
-	int offset = hmac_result[19] & 0xf;
+	int offset = hmac_result[hmac_len - 1] & 0xf;
 
 	*bin_code = (hmac_result[offset] & 0x7f) << 24 |
 		(hmac_result[offset+1] & 0xff) << 16 |
 		(hmac_result[offset+2] & 0xff) <<  8 |
 		(hmac_result[offset+3] & 0xff);
 
-	*bin_code %= DBC2_MODULO;
+	*bin_code %= dbc2_modulo[digits];
 }
 
-static TEE_Result register_shared_key(uint32_t param_types, TEE_Param params[4])
+/*
+ * Compute the HOTP value of a credential for a given counter value.
+ */
+static TEE_Result cred_hotp(const struct hotp_cred *cred, uint64_t count,
+			    uint32_t *hotp_val)
 {
 	TEE_Result res = TEE_SUCCESS;
+	uint8_t counter[8];
+	uint8_t mac[MAX_HASH_SIZE];
+	uint32_t mac_len = sizeof(mac);
+	int i;
+
+	/* The counter is hashed as an 8-byte big-endian value */
+	for (i = 0; i < 8; i++)
+		counter[i] = count >> (56 - 8 * i);
+
+	res = hmac(cred, counter, sizeof(counter), mac, &mac_len);
+	if (res != TEE_SUCCESS)
+		return res;
+
+	truncate(mac, mac_len, cred->digits, hotp_val);
+
+	return TEE_SUCCESS;
+}
+
+/*
+ * Compute the HOTP value of the credential's counter and move the counter on.
+ */
+static TEE_Result cred_next_hotp(struct hotp_cred *cred, uint32_t *hotp_val)
+{
+	TEE_Result res = cred_hotp(cred, cred->counter, hotp_val);
+
+	if (res == TEE_SUCCESS)
+		res = cred_reserve(cred, cred->counter + 1);
+	if (res != TEE_SUCCESS)
+		return res;
+
+	cred->counter++;
+	DMSG("HOTP is: %d", *hotp_val);
+
+	return TEE_SUCCESS;
+}
+
+/*
+ * Look for a HOTP value among the next window counter values of a credential
+ * (the look-ahead resynchronization of RFC4226, section 7.4). On a match the
+ * counter is moved past the matching value, otherwise it is left untouched.
+ */
+static TEE_Result cred_verify(struct hotp_cred *cred, uint32_t hotp_val,
+			      uint32_t window, bool *match)
+{
+	TEE_Result res = TEE_SUCCESS;
+	uint32_t value;
+	uint32_t i;
+
+	*match = false;
+
+	/* Too many digits, no need to compute anything */
+	if (hotp_val >= dbc2_modulo[cred->digits])
+		return TEE_SUCCESS;
+
+	/* The HMAC operation is keyed once for the whole window */
+	for (i = 0; i < window; i++) {
+		res = cred_hotp(cred, cred->counter + i, &value);
+		if (res != TEE_SUCCESS)
+			return res;
+
+		if (value == hotp_val) {
+			res = cred_reserve(cred, cred->counter + i + 1);
+			if (res != TEE_SUCCESS)
+				return res;
+
+			cred->counter += i + 1;
+			*match = true;
+			break;
+		}
+	}
+
+	return TEE_SUCCESS;
+}
+
+/*
+ * The current time step of a TOTP credential, T = (Current Unix time - T0) / X
+ * as RFC6238 puts it.
+ */
+static TEE_Result totp_time_step(const struct hotp_cred *cred, uint64_t *t)
+{
+	TEE_Time now = { 0 };
+
+	if (cred->system_time)
+		TEE_GetSystemTime(&now);
+	else
+		TEE_GetREETime(&now);
+
+	if ((int64_t)now.seconds < cred->t0)
+		return TEE_ERROR_BAD_STATE;
+
+	*t = ((int64_t)now.seconds - cred->t0) / cred->step;
 
+	return TEE_SUCCESS;
+}
+
+/*
+ * Look for a TOTP value among the time steps T - skew to T + skew, the closest
+ * to the current step T first (RFC6238, section 6). Time steps before the
+ * counter are skipped; on a match the counter is moved past the matching step
+ * so that the same value cannot be accepted twice.
+ */
+static TEE_Result cred_verify_totp(struct hotp_cred *cred, uint32_t totp_val,
+				   uint32_t skew, bool *match)
+{
+	TEE_Result res = TEE_SUCCESS;
+	uint64_t t, step;
+	uint32_t value;
+	uint32_t i;
+
+	*match = false;
+
+	/* Too many digits, no need to compute anything */
+	if (totp_val >= dbc2_modulo[cred->digits])
+		return TEE_SUCCESS;
+
+	res = totp_time_step(cred, &t);
+	if (res != TEE_SUCCESS)
+		return res;
+
+	/* T, T - 1, T + 1, T - 2, ... with the HMAC operation keyed once */
+	for (i = 0; i <= 2 * skew; i++) {
+		if (i & 1) {
+			if (t < (i + 1) / 2)
+				continue;
+			step = t - (i + 1) / 2;
+		} else {
+			step = t + i / 2;
+		}
+
+		if (step < cred->counter)
+			continue;
+
+		res = cred_hotp(cred, step, &value);
+		if (res != TEE_SUCCESS)
+			return res;
+
+		if (value == totp_val) {
+			res = cred_reserve(cred, step + 1);
+			if (res != TEE_SUCCESS)
+				return res;
+
+			cred->counter = step + 1;
+			*match = true;
+			break;
+		}
+	}
+
+	return TEE_SUCCESS;
+}
+
+/*
+ * (Re-)register the shared key of a credential, its counter starts from 0.
+ *  @param options   HOTP_OPT_*, the HMAC algorithm, number of digits and flags
+ *  @param step      The TOTP time step in seconds, 0 for a HOTP credential
+ *  @param t0        The TOTP origin of the time steps
+ */
+static TEE_Result register_key(uint32_t id, const void *key, uint32_t key_len,
+			       uint32_t options, uint32_t step, int64_t t0)
+{
+	struct hotp_cred *cred = NULL;
+	TEE_Result res = TEE_SUCCESS;
+	uint32_t alg = HOTP_OPT_ALG(options);
+	uint32_t digits = HOTP_OPT_DIGITS(options);
+
+	if (!digits)
+		digits = HOTP_MIN_DIGITS;
+
+	if (alg >= HOTP_ALG_COUNT || digits < HOTP_MIN_DIGITS ||
+	    digits > HOTP_MAX_DIGITS)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	if (!key || key_len < hotp_algs[alg].min_key_size ||
+	    key_len > MAX_KEY_SIZE)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	res = cred_insert(id, &cred);
+	if (res != TEE_SUCCESS)
+		return res;
+
+	hmac_forget(id);
+
+	TEE_MemFill(cred->key, 0, sizeof(cred->key));
+	memcpy(cred->key, key, key_len);
+	cred->key_len = key_len;
+	cred->alg = alg;
+	cred->digits = digits;
+	cred->system_time = !!(options & HOTP_OPT_SYSTEM_TIME);
+	cred->step = step;
+	cred->t0 = t0;
+	cred->counter = 0;
+	cred->reserved = 0;
+	cred->persistent = !(options & HOTP_OPT_VOLATILE);
+
+	/* A volatile credential must not come back from an older object */
+	if (cred->persistent) {
+		res = cred_store(cred);
+	} else {
+		res = cred_unstore(id);
+		if (res == TEE_ERROR_ITEM_NOT_FOUND)
+			res = TEE_SUCCESS;
+	}
+
+	if (res != TEE_SUCCESS) {
+		/* The object is as it was, reload it when needed */
+		hmac_forget(id);
+		cred_remove(id);
+		return res;
+	}
+
+	DMSG("Got shared key for 0x%08x (%u bytes).", id, key_len);
+
+	return TEE_SUCCESS;
+}
+
+/*
+ * Find a credential of the given kind, HOTP (counter based) or TOTP.
+ */
+static TEE_Result cred_get(uint32_t id, bool totp, struct hotp_cred **cred)
+{
+	TEE_Result res = TEE_SUCCESS;
+
+	*cred = cred_find(id);
+	if (!*cred) {
+		res = cred_load(id, cred);
+		if (res != TEE_SUCCESS)
+			return res;
+	}
+
+	if (!(*cred)->step != !totp)
+		return TEE_ERROR_BAD_STATE;
+
+	return TEE_SUCCESS;
+}
+
+static TEE_Result get_hotp_id(uint32_t id, uint32_t *hotp_val)
+{
+	struct hotp_cred *cred = NULL;
+	TEE_Result res = cred_get(id, false, &cred);
+
+	if (res != TEE_SUCCESS)
+		return res;
+
+	return cred_next_hotp(cred, hotp_val);
+}
+
+static TEE_Result register_shared_key(uint32_t param_types, TEE_Param params[4])
+{
 	uint32_t exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT,
 						   TEE_PARAM_TYPE_NONE,
 						   TEE_PARAM_TYPE_NONE,
@@ -140,24 +754,80 @@ static TEE_Result register_shared_key(uint32_t param_types, TEE_Param params[4])
 		return TEE_ERROR_BAD_PARAMETERS;
 	}
 
-	memset(K, 0, sizeof(K));
-	memcpy(K, params[0].memref.buffer, params[0].memref.size);
+	return register_key(HOTP_DEFAULT_ID, params[0].memref.buffer,
+			    params[0].memref.size,
+			    HOTP_OPTIONS(HOTP_ALG_SHA1, 6), 0, 0);
+}
+
+static TEE_Result get_hotp(uint32_t param_types, TEE_Param params[4])
+{
+	TEE_Result res = TEE_SUCCESS;
+	uint32_t exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_OUTPUT,
+						   TEE_PARAM_TYPE_NONE,
+						   TEE_PARAM_TYPE_NONE,
+						   TEE_PARAM_TYPE_NONE);
+
+	if (param_types != exp_param_types) {
+		EMSG("Expected: 0x%x, got: 0x%x", exp_param_types, param_types);
+		return TEE_ERROR_BAD_PARAMETERS;
+	}
+
+	res = get_hotp_id(HOTP_DEFAULT_ID, &params[0].value.a);
 
-	K_len = params[0].memref.size;
-	DMSG("Got shared key %s (%u bytes).", K, params[0].memref.size);
+	/* No shared key registered yet */
+	if (res == TEE_ERROR_ITEM_NOT_FOUND)
+		res = TEE_ERROR_BAD_STATE;
 
 	return res;
 }
 
-static TEE_Result get_hotp(uint32_t param_types, TEE_Param params[4])
+static TEE_Result register_id(uint32_t param_types, TEE_Param params[4])
+{
+	uint32_t exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+						   TEE_PARAM_TYPE_MEMREF_INPUT,
+						   TEE_PARAM_TYPE_NONE,
+						   TEE_PARAM_TYPE_NONE);
+
+	if (param_types != exp_param_types) {
+		EMSG("Expected: 0x%x, got: 0x%x", exp_param_types, param_types);
+		return TEE_ERROR_BAD_PARAMETERS;
+	}
+
+	return register_key(params[0].value.a, params[1].memref.buffer,
+			    params[1].memref.size,
+			    HOTP_OPTIONS(HOTP_ALG_SHA1, 6) |
+			    (params[0].value.b & HOTP_OPT_VOLATILE), 0, 0);
+}
+
+static TEE_Result delete_id(uint32_t param_types, TEE_Param params[4])
 {
 	TEE_Result res = TEE_SUCCESS;
-	uint32_t hotp_val;
-	uint8_t mac[SHA1_HASH_SIZE];
-	uint32_t mac_len = sizeof(mac);
-	int i;
+	TEE_Result res2 = TEE_SUCCESS;
+	uint32_t exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+						   TEE_PARAM_TYPE_NONE,
+						   TEE_PARAM_TYPE_NONE,
+						   TEE_PARAM_TYPE_NONE);
 
-	uint32_t exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_OUTPUT,
+	if (param_types != exp_param_types) {
+		EMSG("Expected: 0x%x, got: 0x%x", exp_param_types, param_types);
+		return TEE_ERROR_BAD_PARAMETERS;
+	}
+
+	hmac_forget(params[0].value.a);
+
+	/* The credential may be in the table, in storage or both */
+	res = cred_remove(params[0].value.a);
+	res2 = cred_unstore(params[0].value.a);
+	if (res2 != TEE_ERROR_ITEM_NOT_FOUND || res != TEE_SUCCESS)
+		res = res2;
+
+	return res;
+}
+
+static TEE_Result unload_id(uint32_t param_types, TEE_Param params[4])
+{
+	struct hotp_cred *cred = NULL;
+	uint32_t exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
 						   TEE_PARAM_TYPE_NONE,
 						   TEE_PARAM_TYPE_NONE,
 						   TEE_PARAM_TYPE_NONE);
@@ -167,19 +837,145 @@ static TEE_Result get_hotp(uint32_t param_types, TEE_Param params[4])
 		return TEE_ERROR_BAD_PARAMETERS;
 	}
 
-	res = hmac_sha1(K, K_len, counter, sizeof(counter), mac, &mac_len);
+	cred = cred_find(params[0].value.a);
+	if (!cred)
+		return TEE_ERROR_ITEM_NOT_FOUND;
 
-	/* Increment the counter. */
-	for (i = sizeof(counter) - 1; i >= 0; i--) {
-		if (++counter[i])
-			break;
+	/* Only the persistent object would be left */
+	if (!cred->persistent)
+		return TEE_ERROR_BAD_STATE;
+
+	hmac_forget(params[0].value.a);
+
+	return cred_remove(params[0].value.a);
+}
+
+static TEE_Result get_hotp_by_id(uint32_t param_types, TEE_Param params[4])
+{
+	uint32_t exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+						   TEE_PARAM_TYPE_VALUE_OUTPUT,
+						   TEE_PARAM_TYPE_NONE,
+						   TEE_PARAM_TYPE_NONE);
+
+	if (param_types != exp_param_types) {
+		EMSG("Expected: 0x%x, got: 0x%x", exp_param_types, param_types);
+		return TEE_ERROR_BAD_PARAMETERS;
 	}
 
-	truncate(mac, &hotp_val);
-	DMSG("HOTP is: %d", hotp_val);
-	params[0].value.a = hotp_val;
+	return get_hotp_id(params[0].value.a, &params[1].value.a);
+}
 
-	return res;
+static TEE_Result verify(uint32_t param_types, TEE_Param params[4])
+{
+	struct hotp_cred *cred = NULL;
+	TEE_Result res = TEE_SUCCESS;
+	bool match = false;
+
+	uint32_t exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+						   TEE_PARAM_TYPE_VALUE_INPUT,
+						   TEE_PARAM_TYPE_VALUE_OUTPUT,
+						   TEE_PARAM_TYPE_NONE);
+
+	if (param_types != exp_param_types) {
+		EMSG("Expected: 0x%x, got: 0x%x", exp_param_types, param_types);
+		return TEE_ERROR_BAD_PARAMETERS;
+	}
+
+	if (!params[1].value.b || params[1].value.b > HOTP_MAX_WINDOW)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	res = cred_get(params[0].value.a, false, &cred);
+	if (res != TEE_SUCCESS)
+		return res;
+
+	res = cred_verify(cred, params[1].value.a, params[1].value.b, &match);
+	if (res != TEE_SUCCESS)
+		return res;
+
+	params[2].value.a = match ? HOTP_VERIFY_MATCH : HOTP_VERIFY_NO_MATCH;
+
+	return TEE_SUCCESS;
+}
+
+static TEE_Result register_totp(uint32_t param_types, TEE_Param params[4])
+{
+	uint32_t exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+						   TEE_PARAM_TYPE_MEMREF_INPUT,
+						   TEE_PARAM_TYPE_VALUE_INPUT,
+						   TEE_PARAM_TYPE_VALUE_INPUT);
+	uint32_t step;
+	int64_t t0;
+
+	if (param_types != exp_param_types) {
+		EMSG("Expected: 0x%x, got: 0x%x", exp_param_types, param_types);
+		return TEE_ERROR_BAD_PARAMETERS;
+	}
+
+	step = params[2].value.a ? params[2].value.a : TOTP_DEFAULT_STEP;
+	t0 = (int64_t)((uint64_t)params[3].value.b << 32 | params[3].value.a);
+
+	return register_key(params[0].value.a, params[1].memref.buffer,
+			    params[1].memref.size, params[0].value.b, step, t0);
+}
+
+static TEE_Result get_totp(uint32_t param_types, TEE_Param params[4])
+{
+	struct hotp_cred *cred = NULL;
+	TEE_Result res = TEE_SUCCESS;
+	uint64_t t;
+
+	uint32_t exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+						   TEE_PARAM_TYPE_VALUE_OUTPUT,
+						   TEE_PARAM_TYPE_NONE,
+						   TEE_PARAM_TYPE_NONE);
+
+	if (param_types != exp_param_types) {
+		EMSG("Expected: 0x%x, got: 0x%x", exp_param_types, param_types);
+		return TEE_ERROR_BAD_PARAMETERS;
+	}
+
+	res = cred_get(params[0].value.a, true, &cred);
+	if (res != TEE_SUCCESS)
+		return res;
+
+	res = totp_time_step(cred, &t);
+	if (res != TEE_SUCCESS)
+		return res;
+
+	return cred_hotp(cred, t, &params[1].value.a);
+}
+
+static TEE_Result verify_totp(uint32_t param_types, TEE_Param params[4])
+{
+	struct hotp_cred *cred = NULL;
+	TEE_Result res = TEE_SUCCESS;
+	bool match = false;
+
+	uint32_t exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+						   TEE_PARAM_TYPE_VALUE_INPUT,
+						   TEE_PARAM_TYPE_VALUE_OUTPUT,
+						   TEE_PARAM_TYPE_NONE);
+
+	if (param_types != exp_param_types) {
+		EMSG("Expected: 0x%x, got: 0x%x", exp_param_types, param_types);
+		return TEE_ERROR_BAD_PARAMETERS;
+	}
+
+	if (params[1].value.b > TOTP_MAX_SKEW)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	res = cred_get(params[0].value.a, true, &cred);
+	if (res != TEE_SUCCESS)
+		return res;
+
+	res = cred_verify_totp(cred, params[1].value.a, params[1].value.b,
+			       &match);
+	if (res != TEE_SUCCESS)
+		return res;
+
+	params[2].value.a = match ? HOTP_VERIFY_MATCH : HOTP_VERIFY_NO_MATCH;
+
+	return TEE_SUCCESS;
 }
 
 /*******************************************************************************
@@ -187,11 +983,60 @@ static TEE_Result get_hotp(uint32_t param_types, TEE_Param params[4])
  ******************************************************************************/
 TEE_Result TA_CreateEntryPoint(void)
 {
-	return TEE_SUCCESS;
+	TEE_Result res = TEE_SUCCESS;
+	int i;
+
+	/*
+	 * Allocate the HMAC operations and the key containers once, for the
+	 * largest key. Note that the expected sizes here are in bits!
+	 */
+	for (i = 0; i < HOTP_ALG_COUNT; i++) {
+		res = TEE_AllocateOperation(&hmac_op[i], hotp_algs[i].algo,
+					    TEE_MODE_MAC, MAX_KEY_SIZE * 8);
+		if (res != TEE_SUCCESS) {
+			EMSG("0x%08x", res);
+			break;
+		}
+
+		res = TEE_AllocateTransientObject(hotp_algs[i].key_type,
+						  MAX_KEY_SIZE * 8,
+						  &hmac_key[i]);
+		if (res != TEE_SUCCESS) {
+			EMSG("0x%08x", res);
+			break;
+		}
+	}
+
+	if (res != TEE_SUCCESS)
+		TA_DestroyEntryPoint();
+
+	return res;
 }
 
 void TA_DestroyEntryPoint(void)
 {
+	int i;
+
+	for (i = 0; i < HOTP_ALG_COUNT; i++) {
+		if (hmac_op[i] != TEE_HANDLE_NULL)
+			TEE_FreeOperation(hmac_op[i]);
+		hmac_op[i] = TEE_HANDLE_NULL;
+
+		/* It is OK to call this when hmac_key is TEE_HANDLE_NULL */
+		TEE_FreeTransientObject(hmac_key[i]);
+		hmac_key[i] = TEE_HANDLE_NULL;
+		hmac_keyed[i] = false;
+	}
+
+	/* Wipe the shared keys before giving the memory back */
+	if (creds)
+		TEE_MemFill(creds, 0, creds_max * sizeof(*creds));
+	TEE_Free(creds);
+	TEE_Free(slots);
+	creds = NULL;
+	slots = NULL;
+	creds_count = 0;
+	creds_max = 0;
 }
 
 TEE_Result TA_OpenSessionEntryPoint(uint32_t param_types,
@@ -223,6 +1068,30 @@ TEE_Result TA_InvokeCommandEntryPoint(void __unused *sess_ctx,
 	case TA_HOTP_CMD_GET_HOTP:
 		return get_hotp(param_types, params);
 
+	case TA_HOTP_CMD_REGISTER_ID:
+		return register_id(param_types, params);
+
+	case TA_HOTP_CMD_DELETE_ID:
+		return delete_id(param_types, params);
+
+	case TA_HOTP_CMD_GET_HOTP_ID:
+		return get_hotp_by_id(param_types, params);
+
+	case TA_HOTP_CMD_VERIFY:
+		return verify(param_types, params);
+
+	case TA_HOTP_CMD_REGISTER_TOTP:
+		return register_totp(param_types, params);
+
+	case TA_HOTP_CMD_GET_TOTP:
+		return get_totp(param_types, params);
+
+	case TA_HOTP_CMD_VERIFY_TOTP:
+		return verify_totp(param_types, params);
+
+	case TA_HOTP_CMD_UNLOAD_ID:
+		return unload_id(param_types, params);
+
 	default:
 		return TEE_ERROR_BAD_PARAMETERS;
 	}
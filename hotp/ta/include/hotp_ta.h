@@ -10,14 +10,104 @@
 /*
  * This TA implements HOTP according to:
  * https://www.ietf.org/rfc/rfc4226.txt
+ * and TOTP according to:
+ * https://www.ietf.org/rfc/rfc6238.txt
  */
 
 #define TA_HOTP_UUID \
 	{ 0x484d4143, 0x2d53, 0x4841, \
 		{ 0x31, 0x20, 0x4a, 0x6f, 0x63, 0x6b, 0x65, 0x42 } }
 
-/* The function ID(s) implemented in this TA */
+/*
+ * The function ID(s) implemented in this TA
+ *
+ * REGISTER_SHARED_KEY and GET_HOTP work on the credential HOTP_DEFAULT_ID.
+ * The *_ID commands take the credential ID in params[0].value.a:
+ * - REGISTER_ID: params[0].value.b the options, only HOTP_OPT_VOLATILE is
+ *   taken into account. params[1] memref input, the shared key. Registering
+ *   a known ID replaces its key and restarts its counter from 0.
+ * - DELETE_ID:   no other parameter.
+ * - UNLOAD_ID:   no other parameter. Drops the TA memory copy of a credential
+ *   kept in secure storage, the next command on the ID reads it back as after
+ *   a TA restart. A HOTP_OPT_VOLATILE credential would be lost, it fails with
+ *   TEE_ERROR_BAD_STATE, one not in TA memory with TEE_ERROR_ITEM_NOT_FOUND.
+ * - GET_HOTP_ID: params[1] value output, the HOTP value in value.a.
+ * - VERIFY:      params[1] value input, the HOTP value to check in value.a
+ *   and the window W (1 to HOTP_MAX_WINDOW) in value.b. params[2] value
+ *   output, HOTP_VERIFY_MATCH or HOTP_VERIFY_NO_MATCH in value.a. The value
+ *   is looked for among the next W counter values; on a match the counter is
+ *   moved past it, else the counter is left as it was.
+ *
+ * TOTP credentials share the same IDs:
+ * - REGISTER_TOTP: params[0].value.b the options, HOTP_OPTIONS() possibly
+ *   with HOTP_OPT_SYSTEM_TIME. params[1] memref input, the shared key.
+ *   params[2] value input, the time step X in seconds in value.a (0 for
+ *   TOTP_DEFAULT_STEP). params[3] value input, T0 as a signed 64-bit number
+ *   of seconds, low 32 bits in value.a.
+ * - GET_TOTP:    params[1] value output, the TOTP value of the current time
+ *   step in value.a.
+ * - VERIFY_TOTP: params[1] value input, the TOTP value to check in value.a
+ *   and the skew N (0 to TOTP_MAX_SKEW) in value.b. params[2] value output,
+ *   as for VERIFY. The value is looked for from N steps before to N steps
+ *   after the current one, a value that already matched is refused.
+ * An unknown ID fails with TEE_ERROR_ITEM_NOT_FOUND, a HOTP command on a TOTP
+ * credential (or the reverse) with TEE_ERROR_BAD_STATE.
+ *
+ * Credentials are kept in secure storage and survive the TA, unless they are
+ * registered with HOTP_OPT_VOLATILE (the one of REGISTER_SHARED_KEY is kept).
+ * After a restart a HOTP counter resumes from the end of its last reserved
+ * block of HOTP_COUNTER_BLOCK values, so it never goes back.
+ */
 #define TA_HOTP_CMD_REGISTER_SHARED_KEY	0
 #define TA_HOTP_CMD_GET_HOTP		1
+#define TA_HOTP_CMD_REGISTER_ID		2
+#define TA_HOTP_CMD_DELETE_ID		3
+#define TA_HOTP_CMD_GET_HOTP_ID		4
+#define TA_HOTP_CMD_VERIFY		5
+#define TA_HOTP_CMD_REGISTER_TOTP	6
+#define TA_HOTP_CMD_GET_TOTP		7
+#define TA_HOTP_CMD_VERIFY_TOTP		8
+#define TA_HOTP_CMD_UNLOAD_ID		9
+
+/* The credential used by the commands without an ID */
+#define HOTP_DEFAULT_ID			0
+
+/* Credentials held by the TA, registering more fails with OUT_OF_MEMORY */
+#define HOTP_MAX_CREDENTIALS		32768
+
+/* Largest look-ahead window of TA_HOTP_CMD_VERIFY */
+#define HOTP_MAX_WINDOW			1000
+
+/* Largest skew of TA_HOTP_CMD_VERIFY_TOTP, in time steps */
+#define TOTP_MAX_SKEW			10
+
+/* Time step of TOTP credentials registered without one, in seconds */
+#define TOTP_DEFAULT_STEP		30
+
+/* HMAC algorithm of TOTP credentials, HOTP ones are always HMAC-SHA1 */
+#define HOTP_ALG_SHA1			0
+#define HOTP_ALG_SHA256			1
+#define HOTP_ALG_SHA512			2
+#define HOTP_ALG_COUNT			3
+
+/* Number of digits of the values, 0 means HOTP_MIN_DIGITS */
+#define HOTP_MIN_DIGITS			6
+#define HOTP_MAX_DIGITS			8
+
+/* Options of TA_HOTP_CMD_REGISTER_TOTP (and REGISTER_ID) */
+#define HOTP_OPTIONS(alg, digits)	((alg) | (digits) << 8)
+#define HOTP_OPT_ALG(options)		((options) & 0xff)
+#define HOTP_OPT_DIGITS(options)	(((options) >> 8) & 0xff)
+/* Time steps from TEE_GetSystemTime (origin defined by the platform) */
+#define HOTP_OPT_SYSTEM_TIME		(1 << 16)
+/* Keep the credential in TA memory only, it is lost with the TA */
+#define HOTP_OPT_VOLATILE		(1 << 17)
+
+/* HOTP counter values reserved in secure storage at a time */
+#define HOTP_COUNTER_BLOCK		1000
+
+/* Result of TA_HOTP_CMD_VERIFY and TA_HOTP_CMD_VERIFY_TOTP */
+#define HOTP_VERIFY_NO_MATCH		0
+#define HOTP_VERIFY_MATCH		1
 
 #endif
@@ -14,13 +14,22 @@
 
 #define TA_UUID		TA_HOTP_UUID
 
-#define TA_FLAGS	TA_FLAG_EXEC_DDR
+/*
+ * A single instance, kept alive between sessions, holds the credentials of all
+ * the users.
+ */
+#define TA_FLAGS	(TA_FLAG_SINGLE_INSTANCE | TA_FLAG_MULTI_SESSION | \
+			 TA_FLAG_INSTANCE_KEEP_ALIVE | TA_FLAG_EXEC_DDR)
 
 /* Provisioned stack size */
 #define TA_STACK_SIZE	(2 * 1024)
 
-/* Provisioned heap size for TEE_Malloc() and friends */
-#define TA_DATA_SIZE	(32 * 1024)
+/*
+ * Provisioned heap size for TEE_Malloc() and friends. HOTP_MAX_CREDENTIALS
+ * take 3.25 MiB (104 bytes each) plus 0.5 MiB of index, and the credential
+ * array may be held twice for a moment while it grows.
+ */
+#define TA_DATA_SIZE	(6 * 1024 * 1024)
 
 /* Extra properties (give a version id and a string name) */
 #define TA_CURRENT_TA_EXT_PROPERTIES \
@@ -12,7 +12,7 @@ include $(CLEAR_VARS)
 LOCAL_CFLAGS += -DANDROID_BUILD
 LOCAL_CFLAGS += -Wall
 
-LOCAL_SRC_FILES += host/main.c
+LOCAL_SRC_FILES += host/main.c host/sha_client.c host/sha_kat.c
 
 LOCAL_C_INCLUDES := $(LOCAL_PATH)/ta/include \
 		$(CFG_TEEC_PUBLIC_INCLUDE) \
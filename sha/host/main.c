@@ -26,21 +26,61 @@
  */
 
 #include <err.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
 
 /* OP-TEE TEE client API (built by optee_client) */
 #include <tee_client_api.h>
 
 /* To the the UUID (found the the TA's h-file(s)) */
 #include "sha_ca.h"
+#include "sha_client.h"
+#include "sha_kat.h"
+
+/* Hashes of 64 bytes timed by the bench, per client configuration */
+#define SHA_BENCH_LOOPS     2000
+#define SHA_BENCH_MSG_SIZE  64
+#define SHA_BENCH_THREADS   4
+#define SHA_BENCH_BATCH     1000
+
+/*
+ * hash-file: files are sent SHA_FILE_UPDATE_SIZE bytes per command. A Merkle
+ * tree is split into tasks of a power of two leaves, about
+ * SHA_FILE_TASKS_PER_THREAD per thread and SHA_FILE_MAX_TASK bytes at most.
+ */
+#define SHA_FILE_UPDATE_SIZE        (1024U * 1024U)
+#define SHA_FILE_TASKS_PER_THREAD   4U
+#define SHA_FILE_MAX_TASK           (256U * 1024U * 1024U)
+
+/*
+ * Throughput sweep: messages of 0 B then 64 B to 16 MiB, by factors of 4.
+ * Each size is hashed SHA_SWEEP_BYTES worth of times within the loop bounds,
+ * messages larger than SHA_SWEEP_CHUNK as sequences of chunks of that size.
+ */
+#define SHA_SWEEP_MAX_SIZE      (16U * 1024U * 1024U)
+#define SHA_SWEEP_BYTES         (32U * 1024U * 1024U)
+#define SHA_SWEEP_MIN_LOOPS     3U
+#define SHA_SWEEP_MAX_LOOPS     1000U
+#define SHA_SWEEP_CHUNK         (1024U * 1024U)
+#define SHA_SWEEP_SIZES         11U     /* 0, then 64 B to SHA_SWEEP_MAX_SIZE */
+
+/* Known answer tests: one-shot, hash sequence and exportable hash sequence */
+#define SHA_KAT_RUNS            3U
+
+/* g_CA_PrintfBuffer: "0xNN," plus separator per byte, 16 bytes per line */
+#define CA_PRINT_LINE_SIZE      (16 * 6)
+#define CA_PRINT_SCRATCH_SIZE   (16 * CA_PRINT_LINE_SIZE)
 
 
 
-static int g_TaskInitFlag = -1;    /* Flag if the task done initialize operation */
 TEEC_UUID svc_id = TA_SHA_UUID;
-TEEC_Context g_TaskContext;
 CHAR g_RandomOut[512] = {0};
 /* Buffer for sha operation */
 CHAR g_ShaTestBuf[] ={
@@ -59,102 +99,108 @@ CHAR g_Sha1Result[] =
 CHAR g_Sha256Result[] = 
 {   
     0xda, 0x52, 0xe9, 0xc2, 0x53, 0xae, 0x03, 0x30, 0xbd, 0x97, 0x3f, 0xa5, 0xf3, 0xea, 0x51, 0x1d, 
-    0x31, 0x0a, 0xdf, 0x1f, 0x0a, 0xc0, 0x0e, 0x62, 0x0f, 0x2d, 0x5e, 0x99, 0xf5, 0xc8, 0x6b, 0x80
+    0x31, 0x0a, 0xdf, 0x1f, 0x0a, 0xc0, 0x0e, 0x62, 0x0f, 0x2d, 0x5e, 0x99, 0xf5, 0xc8, 0x6b, 0x8f
 };
 
 CHAR g_Sha384Result[] = 
 {   
-    0xda, 0x52, 0xe9, 0xc2, 0x53, 0xae, 0x03, 0x30, 0xbd, 0x97, 0x3f, 0xa5, 0xf3, 0xea, 0x51, 0x1d, 
-    0x31, 0x0a, 0xff, 0x1f, 0x0a, 0xc0, 0x0e, 0x62, 0x0f, 0x2d, 0x5e, 0x99, 0xf5, 0xc8, 0x6b, 0x8f,
-    0xdb, 0xdc, 0xdd, 0xde, 0xdf, 0xe0, 0xe1, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea
+    0x58, 0x93, 0xc0, 0xc5, 0xd0, 0xe5, 0xe2, 0x05, 0xe4, 0x92, 0xd0, 0x87, 0xb1, 0x7d, 0x27, 0x9f,
+    0xb1, 0xaa, 0xc1, 0x29, 0x0e, 0xcb, 0x12, 0x30, 0x3d, 0x99, 0xf8, 0x1b, 0x03, 0x88, 0x9e, 0xb4,
+    0xa2, 0xda, 0x12, 0x94, 0x35, 0xf9, 0x6d, 0xbd, 0x6b, 0x64, 0x8d, 0xde, 0xa8, 0xe7, 0x92, 0x08
 };
 
 
 CHAR g_Sha512Result[] = 
 {   
-    0xda, 0x52, 0xe9, 0xc2, 0x53, 0xae, 0x03, 0x30, 0xbd, 0x97, 0x3f, 0xa5, 0xf3, 0xea, 0x51, 0x1d, 
-    0x31, 0x0a, 0xdf, 0x1f, 0x0a, 0xc0, 0x0e, 0x62, 0x0f, 0x2d, 0x5e, 0x99, 0xf5, 0xc8, 0x6b, 0x8f,
-    0xda, 0x52, 0xe9, 0xc2, 0x53, 0xae, 0x03, 0x30, 0xbd, 0x97, 0x3f, 0xa5, 0xf3, 0xea, 0x51, 0x1d, 
-    0x31, 0x0a, 0xdf, 0x1f, 0x0a, 0xc0, 0x0e, 0x62, 0x0f, 0x2d, 0x5e, 0x99, 0xf5, 0xc8, 0x6b, 0x8f
+    0x6f, 0xee, 0x52, 0xa8, 0xaf, 0x87, 0x6d, 0x94, 0x30, 0xaf, 0x82, 0xbd, 0x7c, 0x69, 0xd0, 0xe1,
+    0xb6, 0xfc, 0xad, 0x7e, 0xa1, 0x75, 0x63, 0xc0, 0x72, 0x5f, 0x30, 0xc1, 0xa6, 0xa9, 0x1d, 0xbf,
+    0xd4, 0x53, 0xbb, 0x0f, 0xb3, 0x88, 0x6d, 0xa2, 0x5d, 0x97, 0x93, 0x98, 0xc5, 0xae, 0x5a, 0xca,
+    0xc3, 0xd4, 0x80, 0x93, 0x96, 0x62, 0xa5, 0x35, 0xc4, 0xcb, 0x9b, 0xc3, 0xa7, 0xd8, 0x02, 0x54
 };
 
 
+CHAR g_Sha224Result[] = 
+{   
+    0xcc, 0xda, 0x99, 0x62, 0xd8, 0x6c, 0xdf, 0xb8, 0x94, 0x39, 0xf3, 0x52, 0x1e, 0x42, 0xdb, 0x62,
+    0xef, 0x12, 0x7a, 0xc3, 0x7c, 0xdd, 0xf9, 0x26, 0x33, 0x3d, 0xb3, 0x03
+};
 
+CHAR g_Sha3_256Result[] = 
+{   
+    0xa5, 0xcd, 0x16, 0xbb, 0x04, 0x4c, 0x10, 0xf4, 0x90, 0x67, 0x97, 0x62, 0xcd, 0xab, 0x24, 0x82,
+    0x21, 0x3f, 0x09, 0x37, 0xdb, 0xef, 0x89, 0xe1, 0x4c, 0xca, 0x2b, 0x1e, 0x14, 0xb5, 0x49, 0xb5
+};
 
+CHAR g_Sha3_384Result[] = 
+{   
+    0x3c, 0xc5, 0xcf, 0x17, 0xe0, 0xbf, 0xbc, 0xc7, 0xe7, 0x42, 0x0e, 0x86, 0x3c, 0x5b, 0x00, 0xc3,
+    0x8e, 0x18, 0x06, 0x21, 0x6f, 0xfe, 0x26, 0x16, 0xe0, 0x1d, 0xcc, 0x74, 0xce, 0x89, 0xa6, 0x31,
+    0xe5, 0xda, 0x45, 0x3c, 0x36, 0x30, 0x15, 0xc2, 0x4d, 0x7a, 0x7b, 0xd7, 0xaa, 0xed, 0x2d, 0x1f
+};
 
-void g_CA_PrintfBuffer(CHAR* buf, UINT32 len)
-{
-    UINT32 index = 0U;
-    for(index = 0U; index < len; index++)
-    {
-        if(index < 15U)
-        {
-        }
-        else if(0U == index%16U)
-        {
-            printf("\n");
-            
-        }
-        else
-        {
-        }
-        
-        printf("0x%04x, ", (buf[index] & 0x0000000000000000FFU));
-        
+CHAR g_Sha3_512Result[] = 
+{   
+    0xcd, 0x82, 0x01, 0x67, 0x7f, 0xbd, 0x40, 0xc4, 0xdc, 0x2c, 0x87, 0xfa, 0x94, 0xc8, 0x2d, 0x5e,
+    0x66, 0x01, 0x81, 0x07, 0x2b, 0x36, 0x47, 0x77, 0xfd, 0x50, 0xee, 0xba, 0x8d, 0x60, 0x1a, 0x21,
+    0x06, 0x52, 0x3d, 0x82, 0xf0, 0x42, 0xe8, 0x2c, 0xe4, 0x9e, 0x80, 0xb7, 0xb6, 0x95, 0x14, 0x1e,
+    0x88, 0x52, 0x7d, 0x48, 0x03, 0x24, 0x55, 0x39, 0x61, 0xa0, 0x64, 0xda, 0x10, 0xbe, 0x98, 0xcf
+};
 
-    }
-    printf("\n");
-   
-}
+CHAR g_Shake128Result[] = 
+{   
+    0x3f, 0x7c, 0x1a, 0xa9, 0x24, 0x86, 0xdc, 0xcd, 0x93, 0x05, 0xee, 0xa7, 0xc2, 0xda, 0xf7, 0xa8,
+    0xac, 0xa1, 0xd9, 0x60, 0x3b, 0x1f, 0x10, 0x76, 0x87, 0x1d, 0x85, 0x58, 0x3c, 0xa7, 0x6c, 0x51
+};
 
+CHAR g_Shake256Result[] = 
+{   
+    0x72, 0xc9, 0xaf, 0x1c, 0x20, 0x27, 0x1a, 0xb9, 0x20, 0xf5, 0xe9, 0x72, 0x09, 0x80, 0xde, 0xbf,
+    0x11, 0x21, 0x05, 0x75, 0x2c, 0x60, 0x2d, 0x65, 0x8b, 0xfe, 0x90, 0x33, 0x1b, 0xaa, 0xad, 0x88,
+    0x68, 0x3a, 0x40, 0x9a, 0x6f, 0x56, 0x0e, 0x28, 0x31, 0x18, 0xc0, 0x4b, 0x4b, 0x3b, 0x10, 0x15,
+    0xf3, 0xd7, 0x69, 0xa8, 0x5e, 0xb0, 0xfc, 0x5c, 0x95, 0xa8, 0xef, 0x80, 0xc5, 0x1e, 0x12, 0x61
+};
 
-int l_CryptoVerifyCa_TaskInit(void)
+/* Digests of g_ShaTestBuf, of the default size for SHAKE, indexed by EN_SHA_MODE */
+CHAR* g_ShaResults[EN_OP_SHA_INVALID] =
 {
-    TEEC_Result result;
-    int l_RetVal = OK;
-    
-    /**1) Check if need to do task initialization operation */
-    if(-1 == g_TaskInitFlag)
-    {
-        result = TEEC_InitializeContext(NULL, &g_TaskContext);
-        if(result != TEEC_SUCCESS) 
-        {
-            printf("InitializeContext failed, ReturnCode=0x%x\n", result);
-            l_RetVal= FAIL;
-        } 
-        else 
-        {
-            g_TaskInitFlag = 0;
-            printf("InitializeContext success\n");
-            l_RetVal = OK;
-        }
-    }
-    
-    return l_RetVal;
-}
+    NULL, g_Sha1Result, g_Sha224Result, g_Sha256Result, g_Sha384Result, g_Sha512Result,
+    g_Sha3_256Result, g_Sha3_384Result, g_Sha3_512Result, g_Shake128Result, g_Shake256Result
+};
 
 
-int l_CryptoVerifyCa_OpenSession(TEEC_Session* session)
+
+
+
+/* Format the buffer 16 bytes per line in the scratch area, print it at once */
+void g_CA_PrintfBuffer(CHAR* buf, UINT32 len)
 {
-    TEEC_Result result;
-    int l_RetVal = FAIL;
-    uint32_t origin;
+    static CHAR l_Scratch[CA_PRINT_SCRATCH_SIZE];
+    static const CHAR l_Hex[] = "0123456789abcdef";
+    UINT32 index = 0U;
+    CHAR* l_pPos = l_Scratch;
 
-    result = TEEC_OpenSession(&g_TaskContext, session, &svc_id, 
-                                TEEC_LOGIN_PUBLIC, NULL, NULL, &origin);
-    if(result != TEEC_SUCCESS) 
+    for(index = 0U; index < len; index++)
     {
-        printf("OpenSession failed, ReturnCode=0x%x, ReturnOrigin=0x%x\n", result, origin);
-        g_TaskInitFlag = -1;
-        l_RetVal = FAIL;
-    } 
-    else 
+        /* Flush before a line that would not fit in the scratch area */
+        if((0U == index % 16U) && (l_pPos + CA_PRINT_LINE_SIZE > l_Scratch + sizeof(l_Scratch)))
+        {
+            fwrite(l_Scratch, 1, l_pPos - l_Scratch, stdout);
+            l_pPos = l_Scratch;
+        }
+
+        *l_pPos++ = '0';
+        *l_pPos++ = 'x';
+        *l_pPos++ = l_Hex[(buf[index] >> 4) & 0x0FU];
+        *l_pPos++ = l_Hex[buf[index] & 0x0FU];
+        *l_pPos++ = ',';
+        *l_pPos++ = ((15U == index % 16U) || (index + 1U == len)) ? '\n' : ' ';
+    }
+    if(0U == len)
     {
-        printf("OpenSession success\n");
-        l_RetVal = OK;
+        *l_pPos++ = '\n';
     }
 
-    return l_RetVal;
+    fwrite(l_Scratch, 1, l_pPos - l_Scratch, stdout);
 }
 
 
@@ -172,7 +218,7 @@ int l_CryptoVerifyCa_SendCommand(TEEC_Operation* operation, TEEC_Session* sessio
     } 
     else 
     {
-        printf("InvokeCommand success\n");
+        SHA_CA_TRACE("InvokeCommand success\n");
         l_RetVal = OK;
     }
 
@@ -183,24 +229,17 @@ int l_CryptoVerifyCa_SendCommand(TEEC_Operation* operation, TEEC_Session* sessio
 
 void g_CryptoVerifyCa_Helloworld(void)
 {
-    TEEC_Session   l_session;    /* Define the session of TA&CA */
+    TEEC_Session*  l_pSession;   /* Session borrowed from the pool */
     TEEC_Operation l_operation;  /* Define the operation for communicating between TA&CA */
     int l_RetVal = FAIL;       /* Define the return value of function */
 
-    /**1) Initialize this task */
-    l_RetVal = l_CryptoVerifyCa_TaskInit();
-    if(FAIL == l_RetVal)
+    /**1) Borrow a session from the pool */
+    l_pSession = g_ShaClient_Acquire();
+    if(NULL == l_pSession)
     {
         goto cleanup_1;
     }
 
-    /**2) Open session */
-    l_RetVal = l_CryptoVerifyCa_OpenSession(&l_session);
-    if(FAIL == l_RetVal)
-    {
-        goto cleanup_2;
-    }
-
     /**3) Clear the TEEC_Operation struct */
     memset(&l_operation, 0, sizeof(TEEC_Operation));
 
@@ -213,17 +252,10 @@ void g_CryptoVerifyCa_Helloworld(void)
     l_operation.params[0].value.a = 42;
 
     /**4) Send command to TA */
-    l_RetVal = l_CryptoVerifyCa_SendCommand(&l_operation, &l_session, TA_SHA_CMD_INC_VALUE);
-    if(FAIL == l_RetVal)
-    {
-        goto cleanup_3;
-    }
+    l_RetVal = l_CryptoVerifyCa_SendCommand(&l_operation, l_pSession, TA_SHA_CMD_INC_VALUE);
 
-    /**5) The clean up operation */
-    cleanup_3:
-        TEEC_CloseSession(&l_session);
-    cleanup_2:
-        TEEC_FinalizeContext(&g_TaskContext);
+    /**5) Give back the session */
+    g_ShaClient_Release(l_pSession, FAIL == l_RetVal);
     cleanup_1:
         printf("over\n");
 
@@ -231,22 +263,15 @@ void g_CryptoVerifyCa_Helloworld(void)
 
 int g_CryptoVerifyCa_Random(UINT32 len, CHAR* output)
 {
-    TEEC_Session   l_session;    /* Define the session of TA&CA */
+    TEEC_Session*  l_pSession;   /* Session borrowed from the pool */
     TEEC_Operation l_operation;  /* Define the operation for communicating between TA&CA */
     int l_RetVal = FAIL;       /* Define the return value of function */
 
-    /**1) Initialize this task */
-    l_RetVal = l_CryptoVerifyCa_TaskInit();
-    if(FAIL == l_RetVal)
-    {
-        goto cleanup_1;
-    }
-
-    /**2) Open session */
-    l_RetVal = l_CryptoVerifyCa_OpenSession(&l_session);
-    if(FAIL == l_RetVal)
+    /**1) Borrow a session from the pool */
+    l_pSession = g_ShaClient_Acquire();
+    if(NULL == l_pSession)
     {
-        goto cleanup_2;
+        return FAIL;
     }
 
     /**3) Set the communication context between CA&TA */
@@ -258,19 +283,11 @@ int g_CryptoVerifyCa_Random(UINT32 len, CHAR* output)
     l_operation.params[0].tmpref.buffer = output;
 
     /**4) Send command to TA */
-    l_RetVal = l_CryptoVerifyCa_SendCommand(&l_operation, &l_session, TA_SHA_CMD_RANDOM);
-    if(FAIL == l_RetVal)
-    {
-        goto cleanup_3;
-    }
+    l_RetVal = l_CryptoVerifyCa_SendCommand(&l_operation, l_pSession, TA_SHA_CMD_RANDOM);
 
-    /**5) The clean up operation */
-    cleanup_3:
-        TEEC_CloseSession(&l_session);
-    cleanup_2:
-        TEEC_FinalizeContext(&g_TaskContext);
-    cleanup_1:
-        return l_RetVal;
+    /**5) Give back the session */
+    g_ShaClient_Release(l_pSession, FAIL == l_RetVal);
+    return l_RetVal;
 }
 
 
@@ -278,22 +295,15 @@ int g_CryptoVerifyCa_Random(UINT32 len, CHAR* output)
 
 int g_CryptoVerifyCa_Sha(CHAR* pData, UINT32 len, EN_SHA_MODE shaMode, CHAR* output, UINT32 outLen)
 {
-    TEEC_Session   l_session;    /* Define the session of TA&CA */
+    TEEC_Session*  l_pSession;   /* Session borrowed from the pool */
     TEEC_Operation l_operation;  /* Define the operation for communicating between TA&CA */
     int l_RetVal = FAIL;       /* Define the return value of function */
 
-    /**1) Initialize this task */
-    l_RetVal = l_CryptoVerifyCa_TaskInit();
-    if(FAIL == l_RetVal)
-    {
-        goto cleanup_1;
-    }
-
-    /**2) Open session */
-    l_RetVal = l_CryptoVerifyCa_OpenSession(&l_session);
-    if(FAIL == l_RetVal)
+    /**1) Borrow a session from the pool */
+    l_pSession = g_ShaClient_Acquire();
+    if(NULL == l_pSession)
     {
-        goto cleanup_2;
+        return FAIL;
     }
 
     /**3) Set the communication context between CA&TA */
@@ -308,88 +318,1736 @@ int g_CryptoVerifyCa_Sha(CHAR* pData, UINT32 len, EN_SHA_MODE shaMode, CHAR* out
     l_operation.params[2].tmpref.buffer = output;
 
     /**4) Send command to TA */
-    l_RetVal = l_CryptoVerifyCa_SendCommand(&l_operation, &l_session, TA_SHA_CMD_HASH);
-    printf("The respond data length is 0x%04x\n", outLen);
-    if(FAIL == l_RetVal)
+    l_RetVal = l_CryptoVerifyCa_SendCommand(&l_operation, l_pSession, TA_SHA_CMD_HASH);
+    SHA_CA_TRACE("The respond data length is 0x%04x\n", outLen);
+
+    /**5) Give back the session */
+    g_ShaClient_Release(l_pSession, FAIL == l_RetVal);
+    return l_RetVal;
+}
+
+
+
+
+
+
+
+/* Run one command of a hash sequence on an open session */
+int l_CryptoVerifyCa_ShaSeqCmd(TEEC_Session* session, uint32_t commandID, CHAR* pData,
+                               UINT32 len, EN_SHA_MODE shaMode, CHAR* output, UINT32* pOutLen)
+{
+    TEEC_Operation l_operation;  /* Define the operation for communicating between TA&CA */
+    int l_RetVal = FAIL;       /* Define the return value of function */
+
+    memset(&l_operation, 0x0, sizeof(TEEC_Operation));
+    l_operation.started = 1;
+    switch(commandID)
     {
-        goto cleanup_3;
+        case TA_SHA_CMD_HASH_INIT:
+            l_operation.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_NONE,
+                                                      TEEC_NONE, TEEC_NONE);
+            l_operation.params[0].value.a = shaMode;
+            break;
+        case TA_SHA_CMD_HASH_UPDATE:
+            l_operation.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT, TEEC_NONE,
+                                                      TEEC_NONE, TEEC_NONE);
+            l_operation.params[0].tmpref.size = len;
+            l_operation.params[0].tmpref.buffer = pData;
+            break;
+        default:
+            l_operation.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT, TEEC_MEMREF_TEMP_OUTPUT,
+                                                      TEEC_NONE, TEEC_NONE);
+            l_operation.params[0].tmpref.size = len;
+            l_operation.params[0].tmpref.buffer = pData;
+            l_operation.params[1].tmpref.size = *pOutLen;
+            l_operation.params[1].tmpref.buffer = output;
+            break;
     }
 
-    /**5) The clean up operation */
-    cleanup_3:
-        TEEC_CloseSession(&l_session);
-    cleanup_2:
-        TEEC_FinalizeContext(&g_TaskContext);
-    cleanup_1:
-        return l_RetVal;
+    l_RetVal = l_CryptoVerifyCa_SendCommand(&l_operation, session, commandID);
+    if((OK == l_RetVal) && (TA_SHA_CMD_HASH_FINAL == commandID))
+    {
+        *pOutLen = l_operation.params[1].tmpref.size;
+    }
+
+    return l_RetVal;
 }
 
 
 
+/*
+ * Hash a buffer as a sequence of chunkLen bytes updates: the TA only ever
+ * sees one chunk, whatever the total length.
+ */
+int g_CryptoVerifyCa_ShaSequence(CHAR* pData, UINT32 len, UINT32 chunkLen, EN_SHA_MODE shaMode,
+                                 CHAR* output, UINT32* pOutLen)
+{
+    TEEC_Session*  l_pSession;   /* Session borrowed from the pool */
+    int l_RetVal = FAIL;       /* Define the return value of function */
+    UINT32 l_Offset = 0U;
+
+    /**1) Borrow a session from the pool */
+    l_pSession = g_ShaClient_Acquire();
+    if(NULL == l_pSession)
+    {
+        return FAIL;
+    }
+
+    /**3) Start the sequence, send all chunks but the last one */
+    l_RetVal = l_CryptoVerifyCa_ShaSeqCmd(l_pSession, TA_SHA_CMD_HASH_INIT, NULL, 0U,
+                                          shaMode, NULL, NULL);
+    while((OK == l_RetVal) && (len - l_Offset > chunkLen))
+    {
+        l_RetVal = l_CryptoVerifyCa_ShaSeqCmd(l_pSession, TA_SHA_CMD_HASH_UPDATE,
+                                              pData + l_Offset, chunkLen, shaMode, NULL, NULL);
+        l_Offset += chunkLen;
+    }
+
+    /**4) Get the digest with the last chunk */
+    if(OK == l_RetVal)
+    {
+        l_RetVal = l_CryptoVerifyCa_ShaSeqCmd(l_pSession, TA_SHA_CMD_HASH_FINAL,
+                                              pData + l_Offset, len - l_Offset, shaMode,
+                                              output, pOutLen);
+    }
 
+    /**5) Give back the session */
+    g_ShaClient_Release(l_pSession, FAIL == l_RetVal);
+    return l_RetVal;
+}
 
 
 
-int main(int argc, char *argv[])
+/*
+ * Hash count records of pData in a single TA_SHA_CMD_HASH_BATCH, the digests
+ * are written one after the other in output.
+ */
+int g_CryptoVerifyCa_ShaBatch(CHAR* pData, UINT32 len, ST_SHA_BATCH_ENTRY* pEntries, UINT32 count,
+                              EN_SHA_MODE shaMode, CHAR* output, UINT32* pOutLen)
 {
-    
-    if(0 == memcmp(argv[1], "helloworld", 10))
+    TEEC_Session*  l_pSession;   /* Session borrowed from the pool */
+    TEEC_Operation l_operation;  /* Define the operation for communicating between TA&CA */
+    TEEC_Result result;
+    uint32_t origin;
+
+    /**1) Borrow a session from the pool */
+    l_pSession = g_ShaClient_Acquire();
+    if(NULL == l_pSession)
     {
-        printf("Entry get helloworld CA\n");
-        g_CryptoVerifyCa_Helloworld();
-        printf("The Respond helloworld from TA just like follow:\n");
+        return FAIL;
     }
 
-     if(0 == memcmp(argv[1], "random", 10))
+    /**2) Set the communication context between CA&TA */
+    memset(&l_operation, 0x0, sizeof(TEEC_Operation));
+    l_operation.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT, TEEC_MEMREF_TEMP_INPUT,
+                                              TEEC_VALUE_INPUT, TEEC_MEMREF_TEMP_OUTPUT);
+    l_operation.params[0].tmpref.size = len;
+    l_operation.params[0].tmpref.buffer = pData;
+    l_operation.params[1].tmpref.size = count * sizeof(ST_SHA_BATCH_ENTRY);
+    l_operation.params[1].tmpref.buffer = pEntries;
+    l_operation.params[2].value.a = shaMode;
+    l_operation.params[3].tmpref.size = *pOutLen;
+    l_operation.params[3].tmpref.buffer = output;
+
+    /**3) Send command to TA, without tracing: batches are for the hot path */
+    result = TEEC_InvokeCommand(l_pSession, TA_SHA_CMD_HASH_BATCH, &l_operation, &origin);
+    *pOutLen = l_operation.params[3].tmpref.size;
+    if((result != TEEC_SUCCESS) && (result != TEEC_ERROR_SHORT_BUFFER))
     {
-        printf("Entry get random CA\n");
-        g_CryptoVerifyCa_Random(64, g_RandomOut);
-        printf("The Respond random from TA just like follow:\n");
-        g_CA_PrintfBuffer(g_RandomOut, 64);
+        printf("InvokeCommand failed, ReturnCode=0x%x, ReturnOrigin=0x%x\n", result, origin);
+    }
+
+    /**4) Give back the session */
+    g_ShaClient_Release(l_pSession, (TEEC_SUCCESS != result) && (TEEC_ERROR_SHORT_BUFFER != result));
+    return (TEEC_SUCCESS == result) ? OK : FAIL;
+}
+
+
+
+/*
+ * Merkle tree root of pData over leaves of leafSize bytes, in a single
+ * TA_SHA_CMD_MERKLE. The leaf hashes are written to leaves unless it is NULL.
+ * On a too short output the sizes are set to the required ones.
+ */
+int g_CryptoVerifyCa_ShaMerkle(CHAR* pData, UINT32 len, EN_SHA_MODE shaMode, UINT32 leafSize,
+                               CHAR* root, UINT32* pRootLen, CHAR* leaves, UINT32* pLeavesLen)
+{
+    TEEC_Session*  l_pSession;   /* Session borrowed from the pool */
+    TEEC_Operation l_operation;  /* Define the operation for communicating between TA&CA */
+    TEEC_Result result;
+    uint32_t origin;
+
+    /**1) Borrow a session from the pool */
+    l_pSession = g_ShaClient_Acquire();
+    if(NULL == l_pSession)
+    {
+        return FAIL;
+    }
+
+    /**2) Set the communication context between CA&TA */
+    memset(&l_operation, 0x0, sizeof(TEEC_Operation));
+    l_operation.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT, TEEC_VALUE_INPUT,
+                                              TEEC_MEMREF_TEMP_OUTPUT,
+                                              (NULL == leaves) ? TEEC_NONE : TEEC_MEMREF_TEMP_OUTPUT);
+    l_operation.params[0].tmpref.size = len;
+    l_operation.params[0].tmpref.buffer = pData;
+    l_operation.params[1].value.a = shaMode;
+    l_operation.params[1].value.b = leafSize;
+    l_operation.params[2].tmpref.size = *pRootLen;
+    l_operation.params[2].tmpref.buffer = root;
+    if(NULL != leaves)
+    {
+        l_operation.params[3].tmpref.size = *pLeavesLen;
+        l_operation.params[3].tmpref.buffer = leaves;
     }
 
-    if(0 == memcmp(argv[1], "sha1", 4))
+    /**3) Send command to TA */
+    result = TEEC_InvokeCommand(l_pSession, TA_SHA_CMD_MERKLE, &l_operation, &origin);
+    *pRootLen = l_operation.params[2].tmpref.size;
+    if(NULL != leaves)
+    {
+        *pLeavesLen = l_operation.params[3].tmpref.size;
+    }
+    if((result != TEEC_SUCCESS) && (result != TEEC_ERROR_SHORT_BUFFER))
     {
-        printf("Entry sha1 CA\n");
-        g_CryptoVerifyCa_Sha(g_ShaTestBuf, sizeof(g_ShaTestBuf), EN_OP_SHA1, g_ShaOutput, 20);
-        printf("The Respond hash data from TA just like follow:\n");
-        g_CA_PrintfBuffer(g_ShaOutput, 20);
+        printf("InvokeCommand failed, ReturnCode=0x%x, ReturnOrigin=0x%x\n", result, origin);
     }
 
+    /**4) Give back the session */
+    g_ShaClient_Release(l_pSession, (TEEC_SUCCESS != result) && (TEEC_ERROR_SHORT_BUFFER != result));
+    return (TEEC_SUCCESS == result) ? OK : FAIL;
+}
+
+
+
+/*
+ * Same as g_CryptoVerifyCa_ShaMerkle() with MERKLE_INIT, MERKLE_UPDATE of
+ * chunkLen bytes and MERKLE_FINAL on an open session. leaves, unless NULL,
+ * shall hold all the leaf hashes.
+ */
+int l_CryptoVerifyCa_ShaMerkleSeqOn(TEEC_Session* session, CHAR* pData, UINT32 len, UINT32 chunkLen,
+                                    EN_SHA_MODE shaMode, UINT32 leafSize, CHAR* root, UINT32* pRootLen,
+                                    CHAR* leaves, UINT32* pLeavesLen)
+{
+    TEEC_Operation l_operation;  /* Define the operation for communicating between TA&CA */
+    UINT32 l_LeavesCap = (NULL == leaves) ? 0U : *pLeavesLen;
+    UINT32 l_LeavesLen = 0U;
+    UINT32 l_Offset = 0U;
+    UINT32 l_Chunk = 0U;
+    int l_RetVal = FAIL;       /* Define the return value of function */
+
+    /**1) Start the tree */
+    memset(&l_operation, 0x0, sizeof(TEEC_Operation));
+    l_operation.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_NONE, TEEC_NONE, TEEC_NONE);
+    l_operation.params[0].value.a = shaMode;
+    l_operation.params[0].value.b = leafSize;
+    l_RetVal = l_CryptoVerifyCa_SendCommand(&l_operation, session, TA_SHA_CMD_MERKLE_INIT);
 
+    /**2) Send the data, collecting the leaf hashes */
+    while((OK == l_RetVal) && (l_Offset < len))
+    {
+        l_Chunk = (len - l_Offset < chunkLen) ? (len - l_Offset) : chunkLen;
+        memset(&l_operation, 0x0, sizeof(TEEC_Operation));
+        l_operation.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT,
+                                                  (NULL == leaves) ? TEEC_NONE : TEEC_MEMREF_TEMP_OUTPUT,
+                                                  TEEC_NONE, TEEC_NONE);
+        l_operation.params[0].tmpref.size = l_Chunk;
+        l_operation.params[0].tmpref.buffer = pData + l_Offset;
+        if(NULL != leaves)
+        {
+            l_operation.params[1].tmpref.size = l_LeavesCap - l_LeavesLen;
+            l_operation.params[1].tmpref.buffer = leaves + l_LeavesLen;
+        }
+        l_RetVal = l_CryptoVerifyCa_SendCommand(&l_operation, session, TA_SHA_CMD_MERKLE_UPDATE);
+        l_LeavesLen += (NULL == leaves) ? 0U : l_operation.params[1].tmpref.size;
+        l_Offset += l_Chunk;
+    }
 
-    if(0 == memcmp(argv[1], "sha256", 6))
+    /**3) Get the root & the last leaf hash */
+    if(OK == l_RetVal)
+    {
+        memset(&l_operation, 0x0, sizeof(TEEC_Operation));
+        l_operation.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_OUTPUT,
+                                                  (NULL == leaves) ? TEEC_NONE : TEEC_MEMREF_TEMP_OUTPUT,
+                                                  TEEC_NONE, TEEC_NONE);
+        l_operation.params[0].tmpref.size = *pRootLen;
+        l_operation.params[0].tmpref.buffer = root;
+        if(NULL != leaves)
+        {
+            l_operation.params[1].tmpref.size = l_LeavesCap - l_LeavesLen;
+            l_operation.params[1].tmpref.buffer = leaves + l_LeavesLen;
+        }
+        l_RetVal = l_CryptoVerifyCa_SendCommand(&l_operation, session, TA_SHA_CMD_MERKLE_FINAL);
+        *pRootLen = l_operation.params[0].tmpref.size;
+        l_LeavesLen += (NULL == leaves) ? 0U : l_operation.params[1].tmpref.size;
+    }
+    if(NULL != leaves)
     {
+        *pLeavesLen = l_LeavesLen;
+    }
+
+    return l_RetVal;
+}
+
 
-        printf("Entry sha256 CA\n");
-        g_CryptoVerifyCa_Sha(g_ShaTestBuf, sizeof(g_ShaTestBuf), EN_OP_SHA256, g_ShaOutput, 32);
-        printf("The Respond hash data from TA just like follow:\n");
-        g_CA_PrintfBuffer(g_ShaOutput, 32);
+
+/* g_CryptoVerifyCa_ShaMerkle() as a sequence, on a session of the pool */
+int g_CryptoVerifyCa_ShaMerkleSequence(CHAR* pData, UINT32 len, UINT32 chunkLen, EN_SHA_MODE shaMode,
+                                       UINT32 leafSize, CHAR* root, UINT32* pRootLen,
+                                       CHAR* leaves, UINT32* pLeavesLen)
+{
+    TEEC_Session*  l_pSession;   /* Session borrowed from the pool */
+    int l_RetVal = FAIL;       /* Define the return value of function */
+
+    l_pSession = g_ShaClient_Acquire();
+    if(NULL == l_pSession)
+    {
+        return FAIL;
     }
-   
 
-    if(0 == memcmp(argv[1], "sha384", 6))
+    l_RetVal = l_CryptoVerifyCa_ShaMerkleSeqOn(l_pSession, pData, len, chunkLen, shaMode, leafSize,
+                                               root, pRootLen, leaves, pLeavesLen);
+
+    g_ShaClient_Release(l_pSession, FAIL == l_RetVal);
+    return l_RetVal;
+}
+
+
+
+static uint64_t l_CryptoVerifyCa_NowNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000U + ts.tv_nsec;
+}
+
+
+
+/* Hash a buffer on an open session, without tracing. *pOutLen is updated */
+static TEEC_Result l_CryptoVerifyCa_ShaQuiet(TEEC_Session* session, EN_SHA_MODE shaMode, CHAR* pData,
+                                             UINT32 len, CHAR* output, UINT32* pOutLen)
+{
+    TEEC_Result result;
+    TEEC_Operation l_operation;
+    uint32_t origin;
+
+    memset(&l_operation, 0x0, sizeof(TEEC_Operation));
+    l_operation.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT,TEEC_VALUE_INPUT,
+                                              TEEC_MEMREF_TEMP_OUTPUT, TEEC_NONE);
+    l_operation.params[0].tmpref.size = len;
+    l_operation.params[0].tmpref.buffer = pData;
+    l_operation.params[1].value.a = shaMode;
+    l_operation.params[2].tmpref.size = *pOutLen;
+    l_operation.params[2].tmpref.buffer = output;
+
+    result = TEEC_InvokeCommand(session, TA_SHA_CMD_HASH, &l_operation, &origin);
+    *pOutLen = l_operation.params[2].tmpref.size;
+    return result;
+}
+
+
+
+/* Hash with a context and a session set up around every hash */
+static TEEC_Result l_CryptoVerifyCa_ShaUnpooled(CHAR* pData, UINT32 len, CHAR* output, UINT32 outLen)
+{
+    TEEC_Context l_Context;
+    TEEC_Session l_Session;
+    TEEC_Result result;
+    uint32_t origin;
+
+    result = TEEC_InitializeContext(NULL, &l_Context);
+    if(result != TEEC_SUCCESS)
     {
+        return result;
+    }
 
-        printf("Entry sha384 CA\n");
-        g_CryptoVerifyCa_Sha(g_ShaTestBuf, sizeof(g_ShaTestBuf), EN_OP_SHA384, g_ShaOutput, 48);
-        printf("The Respond hash data from TA just like follow:\n");
-        g_CA_PrintfBuffer(g_ShaOutput, 48);
+    result = TEEC_OpenSession(&l_Context, &l_Session, &svc_id,
+                              TEEC_LOGIN_PUBLIC, NULL, NULL, &origin);
+    if(result == TEEC_SUCCESS)
+    {
+        result = l_CryptoVerifyCa_ShaQuiet(&l_Session, EN_OP_SHA256, pData, len, output, &outLen);
+        TEEC_CloseSession(&l_Session);
     }
-   
+
+    TEEC_FinalizeContext(&l_Context);
+    return result;
+}
 
 
-    if(0 == memcmp(argv[1], "sha512", 6))
+
+/* Hash with a session borrowed from the pool */
+static TEEC_Result l_CryptoVerifyCa_ShaPooled(EN_SHA_MODE shaMode, CHAR* pData, UINT32 len,
+                                              CHAR* output, UINT32* pOutLen)
+{
+    TEEC_Session* l_pSession;
+    TEEC_Result result;
+
+    l_pSession = g_ShaClient_Acquire();
+    if(NULL == l_pSession)
     {
+        return TEEC_ERROR_GENERIC;
+    }
+
+    result = l_CryptoVerifyCa_ShaQuiet(l_pSession, shaMode, pData, len, output, pOutLen);
+    g_ShaClient_Release(l_pSession, TEEC_SUCCESS != result);
+
+    return result;
+}
 
-        printf("Entry sha512 CA\n");
-        g_CryptoVerifyCa_Sha(g_ShaTestBuf, sizeof(g_ShaTestBuf), EN_OP_SHA512, g_ShaOutput, 64);
-        printf("The Respond hash data from TA just like follow:\n");
-        g_CA_PrintfBuffer(g_ShaOutput, 64);
+
+
+/* Hash SHA_BENCH_LOOPS messages, borrowing from the pool if *arg is not 0 */
+static void* l_CryptoVerifyCa_BenchWorker(void* arg)
+{
+    const int* l_pPooled = arg;
+    CHAR l_Msg[SHA_BENCH_MSG_SIZE];
+    CHAR l_Digest[32];
+    UINT32 l_DigestLen = 0U;
+    UINT32 index = 0U;
+    TEEC_Result result;
+
+    memset(l_Msg, 0x5a, sizeof(l_Msg));
+    for(index = 0U; index < SHA_BENCH_LOOPS; index++)
+    {
+        l_DigestLen = sizeof(l_Digest);
+        if(*l_pPooled)
+        {
+            result = l_CryptoVerifyCa_ShaPooled(EN_OP_SHA256, l_Msg, sizeof(l_Msg),
+                                                l_Digest, &l_DigestLen);
+        }
+        else
+        {
+            result = l_CryptoVerifyCa_ShaUnpooled(l_Msg, sizeof(l_Msg), l_Digest, sizeof(l_Digest));
+        }
+        if(TEEC_SUCCESS != result)
+        {
+            errx(1, "%s sha256 failed", *l_pPooled ? "Pooled" : "Unpooled");
+        }
     }
+
+    return arg;
+}
+
+
+
+/* Run the bench worker from the given number of threads, print the rate */
+static void l_CryptoVerifyCa_BenchRun(int pooled, UINT32 threads)
+{
+    pthread_t l_Threads[SHA_BENCH_THREADS];
+    const CHAR* l_pName = pooled ? "session pool" : "session per hash";
+    CHAR l_Label[32];
+    uint64_t l_Start = 0U;
+    uint64_t l_Ns = 0U;
+    UINT32 index = 0U;
+
+    l_Start = l_CryptoVerifyCa_NowNs();
+    if(1U == threads)
+    {
+        l_CryptoVerifyCa_BenchWorker(&pooled);
+    }
+    else
+    {
+        for(index = 0U; index < threads; index++)
+        {
+            if(0 != pthread_create(&l_Threads[index], NULL, l_CryptoVerifyCa_BenchWorker, &pooled))
+            {
+                errx(1, "pthread_create failed");
+            }
+        }
+        for(index = 0U; index < threads; index++)
+        {
+            pthread_join(l_Threads[index], NULL);
+        }
+    }
+    l_Ns = l_CryptoVerifyCa_NowNs() - l_Start;
+
+    if(1U == threads)
+    {
+        snprintf(l_Label, sizeof(l_Label), "%s", l_pName);
+    }
+    else
+    {
+        snprintf(l_Label, sizeof(l_Label), "%s, %u thr", l_pName, threads);
+    }
+    printf("%-24s %12.0f hashes/s\n", l_Label,
+           (double)SHA_BENCH_LOOPS * threads * 1000000000U / l_Ns);
+}
+
+
+
+/*
+ * SHA-256 hashes per second of SHA_BENCH_MSG_SIZE bytes messages, with a
+ * context and session per hash as the CA used to do, then borrowing from
+ * the session pool, each from one and from SHA_BENCH_THREADS threads.
+ */
+int g_CryptoVerifyCa_Bench(void)
+{
+    CHAR l_Label[32];
+    CHAR* l_pBatchData = NULL;
+    CHAR* l_pBatchOut = NULL;
+    ST_SHA_BATCH_ENTRY* l_pBatchEntries = NULL;
+    UINT32 l_OutLen = 0U;
+    uint64_t l_Start = 0U;
+    uint64_t l_Ns = 0U;
+    UINT32 index = 0U;
+
+    l_CryptoVerifyCa_BenchRun(0, 1U);
+    l_CryptoVerifyCa_BenchRun(0, SHA_BENCH_THREADS);
+    l_CryptoVerifyCa_BenchRun(1, 1U);
+    l_CryptoVerifyCa_BenchRun(1, SHA_BENCH_THREADS);
+
+    /* Same records, SHA_BENCH_BATCH per invocation */
+    l_pBatchData = malloc(SHA_BENCH_BATCH * SHA_BENCH_MSG_SIZE);
+    l_pBatchEntries = malloc(SHA_BENCH_BATCH * sizeof(ST_SHA_BATCH_ENTRY));
+    l_pBatchOut = malloc(SHA_BENCH_BATCH * 32U);
+    if((NULL == l_pBatchData) || (NULL == l_pBatchEntries) || (NULL == l_pBatchOut))
+    {
+        errx(1, "Out of memory");
+    }
+    memset(l_pBatchData, 0x5a, SHA_BENCH_BATCH * SHA_BENCH_MSG_SIZE);
+    for(index = 0U; index < SHA_BENCH_BATCH; index++)
+    {
+        l_pBatchEntries[index].Offset = index * SHA_BENCH_MSG_SIZE;
+        l_pBatchEntries[index].Length = SHA_BENCH_MSG_SIZE;
+    }
+
+    l_Start = l_CryptoVerifyCa_NowNs();
+    for(index = 0U; index < SHA_BENCH_LOOPS / 100U; index++)
+    {
+        l_OutLen = SHA_BENCH_BATCH * 32U;
+        if(OK != g_CryptoVerifyCa_ShaBatch(l_pBatchData, SHA_BENCH_BATCH * SHA_BENCH_MSG_SIZE,
+                                           l_pBatchEntries, SHA_BENCH_BATCH, EN_OP_SHA256,
+                                           l_pBatchOut, &l_OutLen))
+        {
+            errx(1, "Batch sha256 failed");
+        }
+    }
+    l_Ns = l_CryptoVerifyCa_NowNs() - l_Start;
+    snprintf(l_Label, sizeof(l_Label), "batch of %d", SHA_BENCH_BATCH);
+    printf("%-24s %12.0f hashes/s\n", l_Label,
+           (double)(SHA_BENCH_LOOPS / 100U) * SHA_BENCH_BATCH * 1000000000U / l_Ns);
+
+    free(l_pBatchData);
+    free(l_pBatchEntries);
+    free(l_pBatchOut);
+
+    return OK;
+}
+
+
+
+/*
+ * Hash in every mode of the algorithm table with an output of the digest
+ * size, then one byte shorter: the TA shall report the digest size back.
+ * A XOF outputs any length, it reports its default size for an empty output.
+ */
+int g_CryptoVerifyCa_ShaSizes(void)
+{
+    const ST_SHA_ALGO* l_pAlgo = NULL;
+    CHAR l_Digest[SHA_MAX_DIGEST_SIZE];
+    UINT32 l_OutLen = 0U;
+    UINT32 l_Mode = 0U;
+    TEEC_Result result;
+    int l_RetVal = OK;
+
+    for(l_Mode = EN_OP_SHA1; l_Mode < EN_OP_SHA_INVALID; l_Mode++)
+    {
+        l_pAlgo = g_ShaAlgo_Get(l_Mode);
+
+        l_OutLen = l_pAlgo->DigestSize;
+        result = l_CryptoVerifyCa_ShaPooled(l_Mode, g_ShaTestBuf, sizeof(g_ShaTestBuf),
+                                            l_Digest, &l_OutLen);
+        if((TEEC_SUCCESS != result) || (l_pAlgo->DigestSize != l_OutLen))
+        {
+            printf("%s digest of 0x%x bytes, 0x%x => ERROR\n", l_pAlgo->Name, l_OutLen, result);
+            l_RetVal = FAIL;
+        }
+
+        l_OutLen = (0U != (l_pAlgo->Flags & SHA_ALGO_F_XOF)) ? 0U : l_pAlgo->DigestSize - 1U;
+        result = l_CryptoVerifyCa_ShaPooled(l_Mode, g_ShaTestBuf, sizeof(g_ShaTestBuf),
+                                            l_Digest, &l_OutLen);
+        if((TEEC_ERROR_SHORT_BUFFER != result) || (l_pAlgo->DigestSize != l_OutLen))
+        {
+            printf("%s short output reported 0x%x bytes, 0x%x => ERROR\n", l_pAlgo->Name,
+                   l_OutLen, result);
+            l_RetVal = FAIL;
+        }
+    }
+
+    return l_RetVal;
+}
+
+
+
+/*
+ * Reference Merkle tree hash of count leaf hashes, as RFC 6962 spells it:
+ * the left subtree holds the largest power of two leaves below count. Each
+ * node is hashed with the one-shot HASH command.
+ */
+static int l_CryptoVerifyCa_MerkleRef(const ST_SHA_ALGO* pAlgo, CHAR* leaves, UINT32 count,
+                                      CHAR* output)
+{
+    CHAR l_Node[1U + 2U * SHA_MAX_DIGEST_SIZE];
+    UINT32 l_OutLen = pAlgo->DigestSize;
+    UINT32 l_Split = 1U;
+
+    if(1U == count)
+    {
+        memcpy(output, leaves, pAlgo->DigestSize);
+        return OK;
+    }
+
+    while(2U * l_Split < count)
+    {
+        l_Split *= 2U;
+    }
+    l_Node[0] = 0x01;
+    if((OK != l_CryptoVerifyCa_MerkleRef(pAlgo, leaves, l_Split, l_Node + 1U)) ||
+       (OK != l_CryptoVerifyCa_MerkleRef(pAlgo, leaves + l_Split * pAlgo->DigestSize, count - l_Split,
+                                         l_Node + 1U + pAlgo->DigestSize)))
+    {
+        return FAIL;
+    }
+
+    return (TEEC_SUCCESS == l_CryptoVerifyCa_ShaPooled(pAlgo->Mode, l_Node, 1U + 2U * pAlgo->DigestSize,
+                                                       output, &l_OutLen)) ? OK : FAIL;
+}
+
+
+
+/*
+ * Check the Merkle commands over the leaf sizes below, for every mode: the
+ * leaf hashes against one-shot digests, the root against the reference
+ * tree, and the sequence against the one-shot command.
+ */
+int g_CryptoVerifyCa_ShaMerkleTest(void)
+{
+    static const UINT32 l_LeafSizes[] = { 1U, 7U, 16U, 48U, 64U };
+    const ST_SHA_ALGO* l_pAlgo = NULL;
+    CHAR l_Leaves[sizeof(g_ShaTestBuf) * SHA_MAX_DIGEST_SIZE];
+    CHAR l_SeqLeaves[sizeof(l_Leaves)];
+    CHAR l_Leaf[1U + sizeof(g_ShaTestBuf)];
+    CHAR l_Root[SHA_MAX_DIGEST_SIZE];
+    CHAR l_Ref[SHA_MAX_DIGEST_SIZE];
+    UINT32 l_LeavesLen = 0U;
+    UINT32 l_SeqLen = 0U;
+    UINT32 l_RootLen = 0U;
+    UINT32 l_RefLen = 0U;
+    UINT32 l_Count = 0U;
+    UINT32 l_Size = 0U;
+    UINT32 l_Mode = 0U;
+    UINT32 index = 0U;
+    UINT32 leaf = 0U;
+    int l_Errors = 0;
+
+    for(l_Mode = EN_OP_SHA1; l_Mode < EN_OP_SHA_INVALID; l_Mode++)
+    {
+        l_pAlgo = g_ShaAlgo_Get(l_Mode);
+        for(index = 0U; index < sizeof(l_LeafSizes) / sizeof(l_LeafSizes[0]); index++)
+        {
+            l_Size = l_LeafSizes[index];
+            l_Count = (sizeof(g_ShaTestBuf) + l_Size - 1U) / l_Size;
+
+            /**1) Root & leaf hashes in one command */
+            l_RootLen = sizeof(l_Root);
+            l_LeavesLen = sizeof(l_Leaves);
+            if((OK != g_CryptoVerifyCa_ShaMerkle(g_ShaTestBuf, sizeof(g_ShaTestBuf), l_Mode, l_Size,
+                                                 l_Root, &l_RootLen, l_Leaves, &l_LeavesLen)) ||
+               (l_pAlgo->DigestSize != l_RootLen) || (l_Count * l_pAlgo->DigestSize != l_LeavesLen))
+            {
+                printf("%s Merkle tree of %u bytes leaves => ERROR\n", l_pAlgo->Name, l_Size);
+                l_Errors++;
+                continue;
+            }
+
+            /**2) Leaf hashes are H(0x00 || leaf) */
+            for(leaf = 0U; leaf < l_Count; leaf++)
+            {
+                l_Leaf[0] = 0x00;
+                memcpy(l_Leaf + 1U, g_ShaTestBuf + leaf * l_Size,
+                       (leaf + 1U < l_Count) ? l_Size : sizeof(g_ShaTestBuf) - leaf * l_Size);
+                l_RefLen = l_pAlgo->DigestSize;
+                if((TEEC_SUCCESS != l_CryptoVerifyCa_ShaPooled(l_Mode, l_Leaf,
+                        1U + ((leaf + 1U < l_Count) ? l_Size : sizeof(g_ShaTestBuf) - leaf * l_Size),
+                        l_Ref, &l_RefLen)) ||
+                   (0 != memcmp(l_Ref, l_Leaves + leaf * l_pAlgo->DigestSize, l_RefLen)))
+                {
+                    printf("%s Merkle leaf %u of %u bytes leaves => ERROR\n", l_pAlgo->Name, leaf, l_Size);
+                    l_Errors++;
+                }
+            }
+
+            /**3) Root against the reference tree */
+            if((OK != l_CryptoVerifyCa_MerkleRef(l_pAlgo, l_Leaves, l_Count, l_Ref)) ||
+               (0 != memcmp(l_Ref, l_Root, l_pAlgo->DigestSize)))
+            {
+                printf("%s Merkle root of %u bytes leaves => ERROR\n", l_pAlgo->Name, l_Size);
+                l_Errors++;
+            }
+
+            /**4) Sequence of 5 bytes updates, across the leaves */
+            l_RefLen = sizeof(l_Ref);
+            l_SeqLen = sizeof(l_SeqLeaves);
+            if((OK != g_CryptoVerifyCa_ShaMerkleSequence(g_ShaTestBuf, sizeof(g_ShaTestBuf), 5U, l_Mode,
+                                                         l_Size, l_Ref, &l_RefLen, l_SeqLeaves, &l_SeqLen)) ||
+               (l_RootLen != l_RefLen) || (0 != memcmp(l_Ref, l_Root, l_RootLen)) ||
+               (l_LeavesLen != l_SeqLen) || (0 != memcmp(l_SeqLeaves, l_Leaves, l_LeavesLen)))
+            {
+                printf("%s Merkle sequence of %u bytes leaves => ERROR\n", l_pAlgo->Name, l_Size);
+                l_Errors++;
+            }
+        }
+
+        /**5) The root of an empty input is H() */
+        l_RootLen = sizeof(l_Root);
+        l_RefLen = l_pAlgo->DigestSize;
+        if((OK != g_CryptoVerifyCa_ShaMerkle(g_ShaTestBuf, 0U, l_Mode, 16U, l_Root, &l_RootLen,
+                                             NULL, NULL)) ||
+           (TEEC_SUCCESS != l_CryptoVerifyCa_ShaPooled(l_Mode, g_ShaTestBuf, 0U, l_Ref, &l_RefLen)) ||
+           (0 != memcmp(l_Ref, l_Root, l_RefLen)))
+        {
+            printf("%s Merkle root of no leaf => ERROR\n", l_pAlgo->Name);
+            l_Errors++;
+        }
+    }
+
+    /**6) A too short leaf output reports the required size */
+    l_RootLen = sizeof(l_Root);
+    l_LeavesLen = 1U;
+    if((OK == g_CryptoVerifyCa_ShaMerkle(g_ShaTestBuf, sizeof(g_ShaTestBuf), EN_OP_SHA256, 16U,
+                                         l_Root, &l_RootLen, l_Leaves, &l_LeavesLen)) ||
+       (3U * 32U != l_LeavesLen))
+    {
+        printf("Short Merkle leaves output not reported => ERROR\n");
+        l_Errors++;
+    }
+
+    return (0 == l_Errors) ? OK : FAIL;
+}
+
+
+
+/* Run HASH_INIT with flags, HASH_EXPORT or HASH_IMPORT on an open session, quietly */
+static TEEC_Result l_CryptoVerifyCa_ShaStateCmd(TEEC_Session* session, uint32_t commandID,
+                                                EN_SHA_MODE shaMode, UINT32 flags, CHAR* pBlob,
+                                                UINT32* pBlobLen)
+{
+    TEEC_Operation l_operation;
+    TEEC_Result result;
+    uint32_t origin;
+
+    memset(&l_operation, 0x0, sizeof(TEEC_Operation));
+    switch(commandID)
+    {
+        case TA_SHA_CMD_HASH_INIT:
+            l_operation.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_NONE,
+                                                      TEEC_NONE, TEEC_NONE);
+            l_operation.params[0].value.a = shaMode;
+            l_operation.params[0].value.b = flags;
+            break;
+        default:
+            l_operation.paramTypes = TEEC_PARAM_TYPES((TA_SHA_CMD_HASH_EXPORT == commandID) ?
+                                                      TEEC_MEMREF_TEMP_OUTPUT : TEEC_MEMREF_TEMP_INPUT,
+                                                      TEEC_NONE, TEEC_NONE, TEEC_NONE);
+            l_operation.params[0].tmpref.size = *pBlobLen;
+            l_operation.params[0].tmpref.buffer = pBlob;
+            break;
+    }
+
+    result = TEEC_InvokeCommand(session, commandID, &l_operation, &origin);
+    if(TA_SHA_CMD_HASH_EXPORT == commandID)
+    {
+        *pBlobLen = l_operation.params[0].tmpref.size;
+    }
+    return result;
+}
+
+
+
+/*
+ * Check the context save & load of hash sequences, for every mode: a
+ * sequence exported half way from one session and imported into another
+ * one gives the one-shot digest, twice from the same blob; an altered blob
+ * is refused, and so is the export of a sequence of the TEE core.
+ */
+int g_CryptoVerifyCa_ShaExportTest(void)
+{
+    const ST_SHA_ALGO* l_pAlgo = NULL;
+    TEEC_Session* l_pFrom = NULL;
+    TEEC_Session* l_pTo = NULL;
+    CHAR l_Blob[SHA_STATE_BLOB_MAX_SIZE];
+    CHAR l_Digest[SHA_MAX_DIGEST_SIZE];
+    UINT32 l_Half = sizeof(g_ShaTestBuf) / 2U + 1U;
+    UINT32 l_BlobLen = 0U;
+    UINT32 l_OutLen = 0U;
+    UINT32 l_Mode = 0U;
+    UINT32 l_Round = 0U;
+    int l_Errors = 0;
+
+    l_pFrom = g_ShaClient_Acquire();
+    l_pTo = g_ShaClient_Acquire();
+    if((NULL == l_pFrom) || (NULL == l_pTo))
+    {
+        errx(1, "Cannot open the sessions");
+    }
+
+    for(l_Mode = EN_OP_SHA1; l_Mode < EN_OP_SHA_INVALID; l_Mode++)
+    {
+        l_pAlgo = g_ShaAlgo_Get(l_Mode);
+
+        /**1) Export half a sequence, start another one in the session */
+        l_BlobLen = sizeof(l_Blob);
+        if((TEEC_SUCCESS != l_CryptoVerifyCa_ShaStateCmd(l_pFrom, TA_SHA_CMD_HASH_INIT, l_Mode,
+                                                         SHA_SEQ_F_EXPORTABLE, NULL, NULL)) ||
+           (OK != l_CryptoVerifyCa_ShaSeqCmd(l_pFrom, TA_SHA_CMD_HASH_UPDATE, g_ShaTestBuf, l_Half,
+                                             l_Mode, NULL, NULL)) ||
+           (TEEC_SUCCESS != l_CryptoVerifyCa_ShaStateCmd(l_pFrom, TA_SHA_CMD_HASH_EXPORT, l_Mode, 0U,
+                                                         l_Blob, &l_BlobLen)) ||
+           (TEEC_SUCCESS != l_CryptoVerifyCa_ShaStateCmd(l_pFrom, TA_SHA_CMD_HASH_INIT, l_Mode, 0U,
+                                                         NULL, NULL)))
+        {
+            printf("%s export of a sequence => ERROR\n", l_pAlgo->Name);
+            l_Errors++;
+            continue;
+        }
+
+        /**2) Import it in the other session then in the first one, finish it */
+        for(l_Round = 0U; l_Round < 2U; l_Round++)
+        {
+            l_OutLen = l_pAlgo->DigestSize;
+            if((TEEC_SUCCESS != l_CryptoVerifyCa_ShaStateCmd((0U == l_Round) ? l_pTo : l_pFrom,
+                                                             TA_SHA_CMD_HASH_IMPORT, l_Mode, 0U,
+                                                             l_Blob, &l_BlobLen)) ||
+               (OK != l_CryptoVerifyCa_ShaSeqCmd((0U == l_Round) ? l_pTo : l_pFrom,
+                                                 TA_SHA_CMD_HASH_FINAL, g_ShaTestBuf + l_Half,
+                                                 sizeof(g_ShaTestBuf) - l_Half, l_Mode,
+                                                 l_Digest, &l_OutLen)) ||
+               (l_pAlgo->DigestSize != l_OutLen) ||
+               (0 != memcmp(l_Digest, g_ShaResults[l_Mode], l_OutLen)))
+            {
+                printf("%s import of a sequence, round %u => ERROR\n", l_pAlgo->Name, l_Round);
+                l_Errors++;
+            }
+        }
+
+        /**3) An altered blob fails authentication */
+        l_Blob[l_BlobLen - 1U] ^= 0x01;
+        if(TEEC_ERROR_MAC_INVALID != l_CryptoVerifyCa_ShaStateCmd(l_pTo, TA_SHA_CMD_HASH_IMPORT, l_Mode,
+                                                                  0U, l_Blob, &l_BlobLen))
+        {
+            printf("%s import of an altered state => ERROR\n", l_pAlgo->Name);
+            l_Errors++;
+        }
+
+        /**4) A SHA-1/SHA-2 sequence of the TEE core has no readable state */
+        if(0U == (l_pAlgo->Flags & SHA_ALGO_F_KECCAK))
+        {
+            l_BlobLen = sizeof(l_Blob);
+            if((TEEC_SUCCESS != l_CryptoVerifyCa_ShaStateCmd(l_pTo, TA_SHA_CMD_HASH_INIT, l_Mode, 0U,
+                                                             NULL, NULL)) ||
+               (TEEC_SUCCESS == l_CryptoVerifyCa_ShaStateCmd(l_pTo, TA_SHA_CMD_HASH_EXPORT, l_Mode, 0U,
+                                                             l_Blob, &l_BlobLen)))
+            {
+                printf("%s export of a TEE core sequence => ERROR\n", l_pAlgo->Name);
+                l_Errors++;
+            }
+        }
+    }
+
+    g_ShaClient_Release(l_pFrom, 0);
+    g_ShaClient_Release(l_pTo, 0);
+    return (0 == l_Errors) ? OK : FAIL;
+}
+
+
+
+/* A file of hash-file, mapped in memory */
+typedef struct
+{
+    const char* Name;
+    CHAR* pData;                            /**< Mapping, NULL when empty    */
+    uint64_t Size;
+    CHAR Digest[SHA_MAX_DIGEST_SIZE];
+    UINT32 DigestLen;
+    int RetVal;
+}ST_SHA_FILE;
+
+/*
+ * Work of the hash-file threads: the digests of Count files, or the Merkle
+ * tree of one file split into Count tasks of TaskLeaves leaves.
+ */
+typedef struct
+{
+    pthread_mutex_t Lock;
+    UINT32 Next;                            /**< Next task to take           */
+    UINT32 Count;                           /**< Tasks                       */
+    const ST_SHA_ALGO* pAlgo;
+    ST_SHA_FILE* pFiles;
+    UINT32 LeafSize;                        /**< 0 for digests of the files  */
+    UINT32 TaskLeaves;
+    CHAR* pRoots;                           /**< Root of each task           */
+    CHAR* pLeaves;                          /**< Hashes of all the leaves    */
+    int Errors;
+}ST_SHA_FILE_JOB;
+
+
+
+/* Digest of a mapped file as a hash sequence, on the session of a thread */
+static int l_CryptoVerifyCa_HashMapped(TEEC_Session* session, EN_SHA_MODE shaMode, ST_SHA_FILE* pFile)
+{
+    uint64_t l_Offset = 0U;
+    int l_RetVal = OK;
+
+    pFile->DigestLen = sizeof(pFile->Digest);
+
+    /* Small files take a single HASH command */
+    if(pFile->Size <= SHA_FILE_UPDATE_SIZE)
+    {
+        return (TEEC_SUCCESS == l_CryptoVerifyCa_ShaQuiet(session, shaMode, pFile->pData, pFile->Size,
+                                                          pFile->Digest, &pFile->DigestLen)) ? OK : FAIL;
+    }
+
+    l_RetVal = l_CryptoVerifyCa_ShaSeqCmd(session, TA_SHA_CMD_HASH_INIT, NULL, 0U, shaMode, NULL, NULL);
+    while((OK == l_RetVal) && (pFile->Size - l_Offset > SHA_FILE_UPDATE_SIZE))
+    {
+        l_RetVal = l_CryptoVerifyCa_ShaSeqCmd(session, TA_SHA_CMD_HASH_UPDATE, pFile->pData + l_Offset,
+                                              SHA_FILE_UPDATE_SIZE, shaMode, NULL, NULL);
+        l_Offset += SHA_FILE_UPDATE_SIZE;
+    }
+    if(OK == l_RetVal)
+    {
+        l_RetVal = l_CryptoVerifyCa_ShaSeqCmd(session, TA_SHA_CMD_HASH_FINAL, pFile->pData + l_Offset,
+                                              pFile->Size - l_Offset, shaMode, pFile->Digest,
+                                              &pFile->DigestLen);
+    }
+
+    return l_RetVal;
+}
+
+
+
+/*
+ * hash-file thread: borrow a session, take tasks in turn. A failed task drops
+ * the session, a new one is borrowed for the next tasks.
+ */
+static void* l_CryptoVerifyCa_HashFileWorker(void* arg)
+{
+    ST_SHA_FILE_JOB* l_pJob = arg;
+    ST_SHA_FILE* l_pFile = NULL;
+    TEEC_Session* l_pSession = NULL;
+    uint64_t l_TaskBytes = 0U;
+    uint64_t l_Offset = 0U;
+    UINT32 l_RootLen = 0U;
+    UINT32 l_LeavesLen = 0U;
+    UINT32 l_Task = 0U;
+    int l_Errors = 0;
+    int l_RetVal = OK;
+
+    for(;;)
+    {
+        /**1) Take the next task */
+        pthread_mutex_lock(&l_pJob->Lock);
+        l_Task = l_pJob->Next;
+        if(l_Task < l_pJob->Count)
+        {
+            l_pJob->Next++;
+        }
+        pthread_mutex_unlock(&l_pJob->Lock);
+        if(l_Task >= l_pJob->Count)
+        {
+            break;
+        }
+
+        /**2) Borrow a session, the task stays failed without one */
+        if(NULL == l_pSession)
+        {
+            l_pSession = g_ShaClient_Acquire();
+            if(NULL == l_pSession)
+            {
+                l_Errors++;
+                continue;
+            }
+        }
+
+        /**3) Digest of a whole file */
+        if(0U == l_pJob->LeafSize)
+        {
+            l_pFile = &l_pJob->pFiles[l_Task];
+            l_pFile->RetVal = l_CryptoVerifyCa_HashMapped(l_pSession, l_pJob->pAlgo->Mode, l_pFile);
+            l_RetVal = l_pFile->RetVal;
+        }
+        /**4) Root of a subtree & its leaves, a part of the single file */
+        else
+        {
+            l_pFile = &l_pJob->pFiles[0];
+            l_TaskBytes = (uint64_t)l_pJob->TaskLeaves * l_pJob->LeafSize;
+            l_Offset = l_Task * l_TaskBytes;
+            l_RootLen = l_pJob->pAlgo->DigestSize;
+            l_LeavesLen = l_pJob->TaskLeaves * l_pJob->pAlgo->DigestSize;
+            l_RetVal = l_CryptoVerifyCa_ShaMerkleSeqOn(l_pSession, l_pFile->pData + l_Offset,
+                                                       (l_pFile->Size - l_Offset < l_TaskBytes) ?
+                                                       (UINT32)(l_pFile->Size - l_Offset) : (UINT32)l_TaskBytes,
+                                                       SHA_FILE_UPDATE_SIZE, l_pJob->pAlgo->Mode,
+                                                       l_pJob->LeafSize,
+                                                       l_pJob->pRoots + l_Task * l_pJob->pAlgo->DigestSize,
+                                                       &l_RootLen,
+                                                       l_pJob->pLeaves + (uint64_t)l_Task * l_LeavesLen,
+                                                       &l_LeavesLen);
+        }
+
+        /**5) Drop the session of a failed task, its state is unknown */
+        if(OK != l_RetVal)
+        {
+            l_Errors++;
+            g_ShaClient_Release(l_pSession, 1);
+            l_pSession = NULL;
+        }
+    }
+
+    if(0 != l_Errors)
+    {
+        pthread_mutex_lock(&l_pJob->Lock);
+        l_pJob->Errors += l_Errors;
+        pthread_mutex_unlock(&l_pJob->Lock);
+    }
+    if(NULL != l_pSession)
+    {
+        g_ShaClient_Release(l_pSession, 0);
+    }
+    return NULL;
+}
+
+
+
+/*
+ * tpm_sha hash-file [-a mode] [-j threads] [-l leaf size [-o leaves file]] file...
+ * Print the digest of each file as sha256sum does, computed by up to
+ * SHA_CLIENT_POOL_SIZE threads each with a session of the pool. With -l,
+ * print the Merkle tree root of the single file instead, its leaves hashed
+ * in parallel, and write the leaf hashes to the -o file. Timing goes to
+ * stderr.
+ */
+int g_CryptoVerifyCa_HashFile(int argc, char* argv[])
+{
+    ST_SHA_FILE_JOB l_Job;
+    pthread_t l_Threads[SHA_CLIENT_POOL_SIZE];
+    const char* l_pLeavesName = NULL;
+    ST_SHA_FILE* l_pFile = NULL;
+    struct stat l_Stat;
+    uint64_t l_Leaves = 0U;
+    uint64_t l_Bytes = 0U;
+    uint64_t l_Start = 0U;
+    uint64_t l_Ns = 0U;
+    CHAR l_Root[SHA_MAX_DIGEST_SIZE];
+    UINT32 l_RootLen = 0U;
+    UINT32 l_Mode = 0U;
+    long l_ThreadCount = sysconf(_SC_NPROCESSORS_ONLN);
+    FILE* l_pOut = NULL;
+    int l_Fd = -1;
+    int l_Opt = 0;
+    int index = 0;
+    UINT32 i = 0U;
+
+    memset(&l_Job, 0, sizeof(l_Job));
+    l_Job.pAlgo = g_ShaAlgo_Get(EN_OP_SHA256);
+
+    /**1) Parse the options */
+    while(-1 != (l_Opt = getopt(argc, argv, "a:j:l:o:")))
+    {
+        switch(l_Opt)
+        {
+            case 'a':
+                for(l_Mode = EN_OP_SHA1; l_Mode < EN_OP_SHA_INVALID; l_Mode++)
+                {
+                    if(0 == strcmp(optarg, g_ShaAlgo_Get(l_Mode)->Name))
+                    {
+                        l_Job.pAlgo = g_ShaAlgo_Get(l_Mode);
+                        break;
+                    }
+                }
+                if(EN_OP_SHA_INVALID == l_Mode)
+                {
+                    errx(1, "Unknown algorithm %s", optarg);
+                }
+                break;
+            case 'j':
+                l_ThreadCount = strtol(optarg, NULL, 0);
+                break;
+            case 'l':
+                l_Job.LeafSize = strtoul(optarg, NULL, 0);
+                if(0U == l_Job.LeafSize)
+                {
+                    errx(1, "Bad leaf size %s", optarg);
+                }
+                break;
+            case 'o':
+                l_pLeavesName = optarg;
+                break;
+            default:
+                errx(1, "usage: hash-file [-a mode] [-j threads] [-l leaf size [-o leaves file]] file...");
+        }
+    }
+    if((optind >= argc) || ((0U != l_Job.LeafSize) && (optind + 1 != argc)))
+    {
+        errx(1, "usage: hash-file [-a mode] [-j threads] [-l leaf size [-o leaves file]] file...");
+    }
+    l_ThreadCount = (l_ThreadCount < 1) ? 1 : l_ThreadCount;
+    l_ThreadCount = (l_ThreadCount > SHA_CLIENT_POOL_SIZE) ? SHA_CLIENT_POOL_SIZE : l_ThreadCount;
+
+    /**2) Map the files */
+    l_Job.Count = argc - optind;
+    l_Job.pFiles = calloc(l_Job.Count, sizeof(ST_SHA_FILE));
+    if(NULL == l_Job.pFiles)
+    {
+        errx(1, "Out of memory");
+    }
+    for(i = 0U; i < l_Job.Count; i++)
+    {
+        l_pFile = &l_Job.pFiles[i];
+        l_pFile->Name = argv[optind + i];
+        l_Fd = open(l_pFile->Name, O_RDONLY);
+        if((l_Fd < 0) || (0 != fstat(l_Fd, &l_Stat)))
+        {
+            err(1, "%s", l_pFile->Name);
+        }
+        l_pFile->Size = l_Stat.st_size;
+        if(0U != l_pFile->Size)
+        {
+            l_pFile->pData = mmap(NULL, l_pFile->Size, PROT_READ, MAP_PRIVATE, l_Fd, 0);
+            if(MAP_FAILED == l_pFile->pData)
+            {
+                err(1, "%s", l_pFile->Name);
+            }
+            madvise(l_pFile->pData, l_pFile->Size, MADV_SEQUENTIAL);
+        }
+        close(l_Fd);
+        l_Bytes += l_pFile->Size;
+    }
+
+    /**3) A Merkle tree is split into subtrees of the same power of two leaves */
+    if(0U != l_Job.LeafSize)
+    {
+        l_pFile = &l_Job.pFiles[0];
+        l_Leaves = (l_pFile->Size + l_Job.LeafSize - 1U) / l_Job.LeafSize;
+        l_Job.TaskLeaves = 1U;
+        while(((uint64_t)l_Job.TaskLeaves * SHA_FILE_TASKS_PER_THREAD * l_ThreadCount < l_Leaves) &&
+              (2U * (uint64_t)l_Job.TaskLeaves * l_Job.LeafSize <= SHA_FILE_MAX_TASK) &&
+              (2U * (uint64_t)l_Job.TaskLeaves * l_Job.pAlgo->DigestSize <= SHA_FILE_MAX_TASK))
+        {
+            l_Job.TaskLeaves *= 2U;
+        }
+        l_Job.Count = (l_Leaves + l_Job.TaskLeaves - 1U) / l_Job.TaskLeaves;
+        l_Job.pRoots = malloc((uint64_t)l_Job.Count * l_Job.pAlgo->DigestSize + 1U);
+        l_Job.pLeaves = malloc(l_Leaves * l_Job.pAlgo->DigestSize + 1U);
+        if((NULL == l_Job.pRoots) || (NULL == l_Job.pLeaves))
+        {
+            errx(1, "Out of memory");
+        }
+    }
+    if((long)l_Job.Count < l_ThreadCount)
+    {
+        l_ThreadCount = (0U == l_Job.Count) ? 1 : l_Job.Count;
+    }
+
+    /**4) Hash on the threads, a file is failed until a thread hashes it */
+    for(i = 0U; (0U == l_Job.LeafSize) && (i < l_Job.Count); i++)
+    {
+        l_Job.pFiles[i].RetVal = FAIL;
+    }
+    pthread_mutex_init(&l_Job.Lock, NULL);
+    l_Start = l_CryptoVerifyCa_NowNs();
+    for(index = 0; index < l_ThreadCount; index++)
+    {
+        if(0 != pthread_create(&l_Threads[index], NULL, l_CryptoVerifyCa_HashFileWorker, &l_Job))
+        {
+            errx(1, "pthread_create failed");
+        }
+    }
+    for(index = 0; index < l_ThreadCount; index++)
+    {
+        pthread_join(l_Threads[index], NULL);
+    }
+
+    /**5) The root of the tree is the tree of the subtree roots */
+    if(0U != l_Job.LeafSize)
+    {
+        l_RootLen = sizeof(l_Root);
+        if(0U == l_Job.Count)
+        {
+            l_Job.Errors += (OK != g_CryptoVerifyCa_ShaMerkle(NULL, 0U, l_Job.pAlgo->Mode, l_Job.LeafSize,
+                                                             l_Root, &l_RootLen, NULL, NULL));
+        }
+        else if(0 == l_Job.Errors)
+        {
+            l_Job.Errors += (OK != l_CryptoVerifyCa_MerkleRef(l_Job.pAlgo, l_Job.pRoots, l_Job.Count,
+                                                             l_Root));
+        }
+    }
+    l_Ns = l_CryptoVerifyCa_NowNs() - l_Start;
+    pthread_mutex_destroy(&l_Job.Lock);
+
+    /**6) Print the results */
+    if(0U == l_Job.LeafSize)
+    {
+        for(i = 0U; i < l_Job.Count; i++)
+        {
+            l_pFile = &l_Job.pFiles[i];
+            if(OK != l_pFile->RetVal)
+            {
+                printf("%s: FAILED\n", l_pFile->Name);
+                continue;
+            }
+            for(l_Mode = 0U; l_Mode < l_pFile->DigestLen; l_Mode++)
+            {
+                printf("%02x", (unsigned char)l_pFile->Digest[l_Mode]);
+            }
+            printf("  %s\n", l_pFile->Name);
+        }
+    }
+    else if(0 == l_Job.Errors)
+    {
+        for(i = 0U; i < l_Job.pAlgo->DigestSize; i++)
+        {
+            printf("%02x", (unsigned char)l_Root[i]);
+        }
+        printf("  %s\n", l_Job.pFiles[0].Name);
+        if(NULL != l_pLeavesName)
+        {
+            l_pOut = fopen(l_pLeavesName, "wb");
+            if((NULL == l_pOut) ||
+               (l_Leaves != fwrite(l_Job.pLeaves, l_Job.pAlgo->DigestSize, l_Leaves, l_pOut)) ||
+               (0 != fclose(l_pOut)))
+            {
+                err(1, "%s", l_pLeavesName);
+            }
+        }
+    }
+    fprintf(stderr, "%s: %u tasks, %llu bytes on %ld threads in %.1f ms, %.1f MB/s\n",
+            l_Job.pAlgo->Name, l_Job.Count, (unsigned long long)l_Bytes, l_ThreadCount, l_Ns / 1000000.0,
+            (0U == l_Ns) ? 0.0 : l_Bytes * 1000.0 / l_Ns);
+
+    /**7) Do the clean up operation& return the result */
+    for(i = 0U; i < argc - optind; i++)
+    {
+        if(NULL != l_Job.pFiles[i].pData)
+        {
+            munmap(l_Job.pFiles[i].pData, l_Job.pFiles[i].Size);
+        }
+    }
+    free(l_Job.pFiles);
+    free(l_Job.pRoots);
+    free(l_Job.pLeaves);
+
+    return (0 == l_Job.Errors) ? OK : FAIL;
+}
+
+
+
+/* Output format of the sha-suite report */
+typedef enum
+{
+    EN_REPORT_TEXT = 0,
+    EN_REPORT_CSV,
+    EN_REPORT_JSON
+}EN_REPORT_FORMAT;
+
+/* Timing of one mode at one size of the sweep */
+typedef struct
+{
+    const ST_SHA_ALGO* pAlgo;
+    UINT32 Size;
+    UINT32 Loops;
+    double MBps;
+    double MeanUs;
+    double P50Us;
+    double P99Us;
+}ST_SHA_SWEEP_ROW;
+
+
+
+/* Convert a hex string into bytes, return the number of bytes */
+static UINT32 l_CryptoVerifyCa_Unhex(const char* hex, CHAR* output)
+{
+    UINT32 index = 0U;
+    unsigned int l_Byte = 0U;
+
+    for(index = 0U; ('\0' != hex[2U * index]) && (1 == sscanf(hex + 2U * index, "%2x", &l_Byte)); index++)
+    {
+        output[index] = (CHAR)l_Byte;
+    }
+
+    return index;
+}
+
+
+
+/*
+ * Hash a buffer as an exportable sequence of chunkLen bytes updates, hashed by
+ * the TA itself for SHA-1/SHA-2. The state is exported and imported back half
+ * way.
+ */
+static int l_CryptoVerifyCa_ShaExportableSeq(CHAR* pData, UINT32 len, UINT32 chunkLen,
+                                             EN_SHA_MODE shaMode, CHAR* output, UINT32* pOutLen)
+{
+    TEEC_Session* l_pSession = NULL;
+    CHAR l_Blob[SHA_STATE_BLOB_MAX_SIZE];
+    UINT32 l_BlobLen = sizeof(l_Blob);
+    UINT32 l_Offset = 0U;
+    int l_RetVal = FAIL;
+
+    /**1) Borrow a session from the pool */
+    l_pSession = g_ShaClient_Acquire();
+    if(NULL == l_pSession)
+    {
+        return FAIL;
+    }
+
+    /**2) Start the sequence, send all chunks but the last one */
+    l_RetVal = (TEEC_SUCCESS == l_CryptoVerifyCa_ShaStateCmd(l_pSession, TA_SHA_CMD_HASH_INIT, shaMode,
+                                                             SHA_SEQ_F_EXPORTABLE, NULL, NULL)) ? OK : FAIL;
+    while((OK == l_RetVal) && (len - l_Offset > chunkLen))
+    {
+        l_RetVal = l_CryptoVerifyCa_ShaSeqCmd(l_pSession, TA_SHA_CMD_HASH_UPDATE,
+                                              pData + l_Offset, chunkLen, shaMode, NULL, NULL);
+        l_Offset += chunkLen;
+
+        /**3) Save & load the state once half the data is hashed */
+        if((OK == l_RetVal) && (l_Offset < len / 2U + chunkLen) && (l_Offset >= len / 2U))
+        {
+            l_RetVal = ((TEEC_SUCCESS == l_CryptoVerifyCa_ShaStateCmd(l_pSession, TA_SHA_CMD_HASH_EXPORT,
+                                                                      shaMode, 0U, l_Blob, &l_BlobLen)) &&
+                        (TEEC_SUCCESS == l_CryptoVerifyCa_ShaStateCmd(l_pSession, TA_SHA_CMD_HASH_IMPORT,
+                                                                      shaMode, 0U, l_Blob, &l_BlobLen))) ?
+                       OK : FAIL;
+        }
+    }
+
+    /**4) Get the digest with the last chunk */
+    if(OK == l_RetVal)
+    {
+        l_RetVal = l_CryptoVerifyCa_ShaSeqCmd(l_pSession, TA_SHA_CMD_HASH_FINAL,
+                                              pData + l_Offset, len - l_Offset, shaMode,
+                                              output, pOutLen);
+    }
+
+    /**5) Give back the session */
+    g_ShaClient_Release(l_pSession, FAIL == l_RetVal);
+    return l_RetVal;
+}
+
+
+
+/*
+ * Run the known answer tests of sha_kat.c, each with the one-shot HASH
+ * command, as a hash sequence of chunks of the block size plus one byte, so
+ * that updates straddle the blocks, and as an exportable sequence of such
+ * chunks, which covers the SHA-1/SHA-2 code of the TA. Failures are written
+ * to log. Return the number of failed tests.
+ */
+int g_CryptoVerifyCa_ShaKat(FILE* log)
+{
+    const ST_SHA_KAT* l_pKat = NULL;
+    const ST_SHA_ALGO* l_pAlgo = NULL;
+    CHAR l_Expected[SHA_MAX_DIGEST_SIZE];
+    CHAR l_Digest[SHA_MAX_DIGEST_SIZE];
+    CHAR* l_pMsg = NULL;
+    UINT32 l_PartLen = 0U;
+    UINT32 l_MsgLen = 0U;
+    UINT32 l_ExpLen = 0U;
+    UINT32 l_OutLen = 0U;
+    UINT32 index = 0U;
+    UINT32 l_Rep = 0U;
+    int l_Failed = 0;
+
+    for(index = 0U; index < g_ShaKatCount; index++)
+    {
+        l_pKat = &g_ShaKatTable[index];
+        l_pAlgo = g_ShaAlgo_Get(l_pKat->Mode);
+
+        /**1) Build the message & the expected digest */
+        l_PartLen = strlen(l_pKat->Msg) / 2U;
+        l_MsgLen = l_PartLen * l_pKat->Repeat;
+        l_pMsg = malloc(l_MsgLen + 1U);
+        if(NULL == l_pMsg)
+        {
+            errx(1, "Out of memory");
+        }
+        l_CryptoVerifyCa_Unhex(l_pKat->Msg, l_pMsg);
+        for(l_Rep = 1U; l_Rep < l_pKat->Repeat; l_Rep++)
+        {
+            memcpy(l_pMsg + l_Rep * l_PartLen, l_pMsg, l_PartLen);
+        }
+        l_ExpLen = l_CryptoVerifyCa_Unhex(l_pKat->Digest, l_Expected);
+
+        /**2) One-shot digest, of the expected length for a XOF */
+        l_OutLen = l_ExpLen;
+        if((TEEC_SUCCESS != l_CryptoVerifyCa_ShaPooled(l_pKat->Mode, l_pMsg, l_MsgLen,
+                                                       l_Digest, &l_OutLen)) ||
+           (l_ExpLen != l_OutLen) ||
+           (0 != memcmp(l_Digest, l_Expected, l_OutLen)))
+        {
+            fprintf(log, "%s KAT %u, %u bytes, one-shot => ERROR\n", l_pAlgo->Name, index, l_MsgLen);
+            l_Failed++;
+        }
+
+        /**3) Hash sequence */
+        l_OutLen = l_ExpLen;
+        if((OK != g_CryptoVerifyCa_ShaSequence(l_pMsg, l_MsgLen, l_pAlgo->BlockSize + 1U,
+                                               l_pKat->Mode, l_Digest, &l_OutLen)) ||
+           (l_ExpLen != l_OutLen) ||
+           (0 != memcmp(l_Digest, l_Expected, l_OutLen)))
+        {
+            fprintf(log, "%s KAT %u, %u bytes, sequence => ERROR\n", l_pAlgo->Name, index, l_MsgLen);
+            l_Failed++;
+        }
+
+        /**4) Exportable hash sequence */
+        l_OutLen = l_ExpLen;
+        if((OK != l_CryptoVerifyCa_ShaExportableSeq(l_pMsg, l_MsgLen, l_pAlgo->BlockSize + 1U,
+                                                    l_pKat->Mode, l_Digest, &l_OutLen)) ||
+           (l_ExpLen != l_OutLen) ||
+           (0 != memcmp(l_Digest, l_Expected, l_OutLen)))
+        {
+            fprintf(log, "%s KAT %u, %u bytes, exportable sequence => ERROR\n", l_pAlgo->Name, index,
+                    l_MsgLen);
+            l_Failed++;
+        }
+
+        free(l_pMsg);
+    }
+
+    return l_Failed;
+}
+
+
+
+static int l_CryptoVerifyCa_CompareNs(const void* a, const void* b)
+{
+    uint64_t l_A = *(const uint64_t*)a;
+    uint64_t l_B = *(const uint64_t*)b;
+
+    return (l_A > l_B) - (l_A < l_B);
+}
+
+
+
+/*
+ * Run the known answer tests, then time every mode of the algorithm table
+ * over the sweep sizes: MB/s, its ratio to SHA-256 at the same size (of
+ * the latencies for the empty message, above 1 is faster), and mean, median
+ * & 99th percentile latency of a whole message. Text for reading, CSV or
+ * JSON on stdout for tracking.
+ */
+int g_CryptoVerifyCa_ShaSuite(EN_REPORT_FORMAT format)
+{
+    static ST_SHA_SWEEP_ROW l_Rows[(EN_OP_SHA_INVALID - EN_OP_SHA1) * SHA_SWEEP_SIZES];
+    const ST_SHA_SWEEP_ROW* l_pRow = NULL;
+    const ST_SHA_SWEEP_ROW* l_pRef = NULL;
+    const ST_SHA_ALGO* l_pAlgo = NULL;
+    FILE* l_pLog = (EN_REPORT_TEXT == format) ? stdout : stderr;
+    uint64_t l_Lat[SHA_SWEEP_MAX_LOOPS];
+    uint64_t l_Total = 0U;
+    uint64_t l_Start = 0U;
+    CHAR l_Digest[SHA_MAX_DIGEST_SIZE];
+    CHAR* l_pMsg = NULL;
+    UINT32 l_OutLen = 0U;
+    UINT32 l_Loops = 0U;
+    UINT32 l_Size = 0U;
+    UINT32 l_Mode = 0U;
+    UINT32 l_Count = 0U;
+    UINT32 index = 0U;
+    double l_Ratio = 0.0;
+    int l_Failed = 0;
+    int l_RetVal = OK;
+
+    /**1) Known answer tests */
+    l_Failed = g_CryptoVerifyCa_ShaKat(l_pLog);
+
+    l_pMsg = malloc(SHA_SWEEP_MAX_SIZE);
+    if(NULL == l_pMsg)
+    {
+        errx(1, "Out of memory");
+    }
+    for(index = 0U; index < SHA_SWEEP_MAX_SIZE; index++)
+    {
+        l_pMsg[index] = (CHAR)index;
+    }
+
+    /**2) Sweep of the message sizes for every mode, in the order of the table */
+    for(l_Mode = EN_OP_SHA1; l_Mode < EN_OP_SHA_INVALID; l_Mode++)
+    {
+        l_pAlgo = g_ShaAlgo_Get(l_Mode);
+        for(l_Size = 0U; l_Size <= SHA_SWEEP_MAX_SIZE; l_Size = (0U == l_Size) ? 64U : 4U * l_Size)
+        {
+            l_Loops = SHA_SWEEP_BYTES / ((0U == l_Size) ? 1U : l_Size);
+            l_Loops = (l_Loops < SHA_SWEEP_MIN_LOOPS) ? SHA_SWEEP_MIN_LOOPS : l_Loops;
+            l_Loops = (l_Loops > SHA_SWEEP_MAX_LOOPS) ? SHA_SWEEP_MAX_LOOPS : l_Loops;
+
+            /* The first loop warms the session pool up, it is not timed */
+            l_Total = 0U;
+            for(index = 0U; index <= l_Loops; index++)
+            {
+                l_OutLen = l_pAlgo->DigestSize;
+                l_Start = l_CryptoVerifyCa_NowNs();
+                if(l_Size <= SHA_SWEEP_CHUNK)
+                {
+                    l_RetVal = (TEEC_SUCCESS == l_CryptoVerifyCa_ShaPooled(l_Mode, l_pMsg, l_Size,
+                                                                          l_Digest, &l_OutLen)) ? OK : FAIL;
+                }
+                else
+                {
+                    l_RetVal = g_CryptoVerifyCa_ShaSequence(l_pMsg, l_Size, SHA_SWEEP_CHUNK, l_Mode,
+                                                            l_Digest, &l_OutLen);
+                }
+                if(OK != l_RetVal)
+                {
+                    errx(1, "%s of %u bytes failed", l_pAlgo->Name, l_Size);
+                }
+                if(0U != index)
+                {
+                    l_Lat[index - 1U] = l_CryptoVerifyCa_NowNs() - l_Start;
+                    l_Total += l_Lat[index - 1U];
+                }
+            }
+            qsort(l_Lat, l_Loops, sizeof(l_Lat[0]), l_CryptoVerifyCa_CompareNs);
+
+            l_Rows[l_Count].pAlgo = l_pAlgo;
+            l_Rows[l_Count].Size = l_Size;
+            l_Rows[l_Count].Loops = l_Loops;
+            l_Rows[l_Count].MBps = (double)l_Size * l_Loops * 1000.0 / l_Total;
+            l_Rows[l_Count].MeanUs = l_Total / 1000.0 / l_Loops;
+            l_Rows[l_Count].P50Us = l_Lat[l_Loops / 2U] / 1000.0;
+            l_Rows[l_Count].P99Us = l_Lat[l_Loops * 99U / 100U] / 1000.0;
+            l_Count++;
+        }
+    }
+    free(l_pMsg);
+
+    /**3) Report, the SHA-256 row of the same size is the reference */
+    switch(format)
+    {
+        case EN_REPORT_CSV:
+            printf("mode,size,command,loops,mb_per_s,vs_sha256,mean_us,p50_us,p99_us\n");
+            break;
+        case EN_REPORT_JSON:
+            printf("{\"kat_passed\": %u, \"kat_failed\": %d, \"sweep\": [",
+                   SHA_KAT_RUNS * g_ShaKatCount - l_Failed, l_Failed);
+            break;
+        default:
+            printf("KAT: %u passed, %d failed\n", SHA_KAT_RUNS * g_ShaKatCount - l_Failed, l_Failed);
+            printf("%-8s %9s %-8s %10s %9s %10s %10s %10s\n", "mode", "bytes", "command",
+                   "MB/s", "/sha256", "mean us", "p50 us", "p99 us");
+            break;
+    }
+
+    for(index = 0U; index < l_Count; index++)
+    {
+        l_pRow = &l_Rows[index];
+        l_pRef = &l_Rows[(EN_OP_SHA256 - EN_OP_SHA1) * SHA_SWEEP_SIZES + index % SHA_SWEEP_SIZES];
+        l_Ratio = (0U == l_pRow->Size) ? (l_pRef->MeanUs / l_pRow->MeanUs) : (l_pRow->MBps / l_pRef->MBps);
+
+        switch(format)
+        {
+            case EN_REPORT_CSV:
+                printf("%s,%u,%s,%u,%.2f,%.3f,%.3f,%.3f,%.3f\n", l_pRow->pAlgo->Name, l_pRow->Size,
+                       (l_pRow->Size <= SHA_SWEEP_CHUNK) ? "hash" : "sequence", l_pRow->Loops,
+                       l_pRow->MBps, l_Ratio, l_pRow->MeanUs, l_pRow->P50Us, l_pRow->P99Us);
+                break;
+            case EN_REPORT_JSON:
+                printf("%s\n  {\"mode\": \"%s\", \"size\": %u, \"command\": \"%s\", \"loops\": %u, "
+                       "\"mb_per_s\": %.2f, \"vs_sha256\": %.3f, \"mean_us\": %.3f, \"p50_us\": %.3f, "
+                       "\"p99_us\": %.3f}",
+                       (0U == index) ? "" : ",", l_pRow->pAlgo->Name, l_pRow->Size,
+                       (l_pRow->Size <= SHA_SWEEP_CHUNK) ? "hash" : "sequence", l_pRow->Loops,
+                       l_pRow->MBps, l_Ratio, l_pRow->MeanUs, l_pRow->P50Us, l_pRow->P99Us);
+                break;
+            default:
+                printf("%-8s %9u %-8s %10.1f %9.2f %10.1f %10.1f %10.1f\n", l_pRow->pAlgo->Name,
+                       l_pRow->Size, (l_pRow->Size <= SHA_SWEEP_CHUNK) ? "hash" : "sequence",
+                       l_pRow->MBps, l_Ratio, l_pRow->MeanUs, l_pRow->P50Us, l_pRow->P99Us);
+                break;
+        }
+    }
+    if(EN_REPORT_JSON == format)
+    {
+        printf("\n]}\n");
+    }
+
+    return (0 == l_Failed) ? OK : FAIL;
+}
+
+
+
+int main(int argc, char *argv[])
+{
+    UINT32 l_Mode = 0U;
+    const ST_SHA_ALGO* l_pAlgo = NULL;
+    int l_Failed = 0;
+
+    if(0 == memcmp(argv[1], "helloworld", 10))
+    {
+        printf("Entry get helloworld CA\n");
+        g_CryptoVerifyCa_Helloworld();
+        printf("The Respond helloworld from TA just like follow:\n");
+    }
+
+     if(0 == memcmp(argv[1], "random", 10))
+    {
+        printf("Entry get random CA\n");
+        g_CryptoVerifyCa_Random(64, g_RandomOut);
+        printf("The Respond random from TA just like follow:\n");
+        g_CA_PrintfBuffer(g_RandomOut, 64);
+    }
+
+    for(l_Mode = EN_OP_SHA1; l_Mode < EN_OP_SHA_INVALID; l_Mode++)
+    {
+        l_pAlgo = g_ShaAlgo_Get(l_Mode);
+        if(0 == strcmp(argv[1], l_pAlgo->Name))
+        {
+            printf("Entry %s CA\n", l_pAlgo->Name);
+            g_CryptoVerifyCa_Sha(g_ShaTestBuf, sizeof(g_ShaTestBuf), l_Mode, g_ShaOutput,
+                                 l_pAlgo->DigestSize);
+            printf("The Respond hash data from TA just like follow:\n");
+            g_CA_PrintfBuffer(g_ShaOutput, l_pAlgo->DigestSize);
+        }
+    }
+
+    if(0 == memcmp(argv[1], "sha-size", 8))
+    {
+        printf("Entry sha size CA\n");
+        if(OK == g_CryptoVerifyCa_ShaSizes())
+        {
+            printf("The digest sizes match the algorithm table\n");
+        }
+    }
+
+    if(0 == memcmp(argv[1], "sha-seq", 7))
+    {
+        UINT32 l_OutLen = 0U;
+        UINT32 l_Chunk = 0U;
+        int l_Errors = 0;
+
+        printf("Entry sha sequence CA\n");
+        for(l_Chunk = 1U; l_Chunk <= sizeof(g_ShaTestBuf); l_Chunk *= 2U)
+        {
+            for(l_Mode = EN_OP_SHA1; l_Mode < EN_OP_SHA_INVALID; l_Mode++)
+            {
+                l_pAlgo = g_ShaAlgo_Get(l_Mode);
+                l_OutLen = l_pAlgo->DigestSize;
+                if((OK != g_CryptoVerifyCa_ShaSequence(g_ShaTestBuf, sizeof(g_ShaTestBuf), l_Chunk,
+                                                      l_Mode, g_ShaOutput, &l_OutLen)) ||
+                   (l_pAlgo->DigestSize != l_OutLen) ||
+                   (0 != memcmp(g_ShaOutput, g_ShaResults[l_Mode], l_OutLen)))
+                {
+                    printf("%s sequence of %u bytes chunks => ERROR\n", l_pAlgo->Name, l_Chunk);
+                    l_Errors++;
+                }
+            }
+        }
+        printf("The sha sequences %s the one-shot digests\n", l_Errors ? "differ from" : "match");
+    }
+
+    if(0 == memcmp(argv[1], "sha-batch", 9))
+    {
+        ST_SHA_BATCH_ENTRY l_Entries[] = {
+            { 0U, sizeof(g_ShaTestBuf) }, { 0U, 0U }, { 5U, 10U }, { 47U, 1U }, { 0U, 48U },
+        };
+        CHAR l_Digests[sizeof(l_Entries) / sizeof(l_Entries[0])][32];
+        CHAR l_Ref[32];
+        UINT32 l_RefLen = 0U;
+        UINT32 l_OutLen = sizeof(l_Digests);
+        UINT32 index = 0U;
+        int l_Errors = 0;
+
+        printf("Entry sha batch CA\n");
+        if(OK != g_CryptoVerifyCa_ShaBatch(g_ShaTestBuf, sizeof(g_ShaTestBuf), l_Entries,
+                                           sizeof(l_Entries) / sizeof(l_Entries[0]), EN_OP_SHA256,
+                                           (CHAR*)l_Digests, &l_OutLen) ||
+           (sizeof(l_Digests) != l_OutLen))
+        {
+            l_Errors++;
+        }
+        for(index = 0U; (0 == l_Errors) && (index < sizeof(l_Entries) / sizeof(l_Entries[0])); index++)
+        {
+            l_RefLen = sizeof(l_Ref);
+            if((TEEC_SUCCESS != l_CryptoVerifyCa_ShaPooled(EN_OP_SHA256,
+                                                          g_ShaTestBuf + l_Entries[index].Offset,
+                                                          l_Entries[index].Length, l_Ref,
+                                                          &l_RefLen)) ||
+               (0 != memcmp(l_Ref, l_Digests[index], sizeof(l_Ref))))
+            {
+                printf("Batch record %u => ERROR\n", index);
+                l_Errors++;
+            }
+        }
+
+        /* A too short output reports the required size */
+        l_OutLen = 32U;
+        if((OK == g_CryptoVerifyCa_ShaBatch(g_ShaTestBuf, sizeof(g_ShaTestBuf), l_Entries,
+                                            sizeof(l_Entries) / sizeof(l_Entries[0]), EN_OP_SHA256,
+                                            (CHAR*)l_Digests, &l_OutLen)) ||
+           (sizeof(l_Digests) != l_OutLen))
+        {
+            printf("Short batch output not reported => ERROR\n");
+            l_Errors++;
+        }
+        printf("The batch digests %s the one-shot digests\n", l_Errors ? "differ from" : "match");
+    }
+
+    if(0 == memcmp(argv[1], "sha-merkle", 10))
+    {
+        printf("Entry sha Merkle tree CA\n");
+        printf("The Merkle trees %s the reference trees\n",
+               (OK == g_CryptoVerifyCa_ShaMerkleTest()) ? "match" : "differ from");
+    }
+
+    if(0 == memcmp(argv[1], "sha-export", 10))
+    {
+        printf("Entry sha state export CA\n");
+        printf("The imported sequences %s the one-shot digests\n",
+               (OK == g_CryptoVerifyCa_ShaExportTest()) ? "match" : "differ from");
+    }
+
+    if(0 == strcmp(argv[1], "hash-file"))
+    {
+        l_Failed = (OK == g_CryptoVerifyCa_HashFile(argc - 1, argv + 1)) ? 0 : 1;
+    }
+
+    if(0 == memcmp(argv[1], "sha-kat", 7))
+    {
+        printf("Entry sha known answer tests CA\n");
+        l_Failed = g_CryptoVerifyCa_ShaKat(stdout);
+        printf("KAT: %u passed, %d failed\n", SHA_KAT_RUNS * g_ShaKatCount - l_Failed, l_Failed);
+    }
+
+    if(0 == memcmp(argv[1], "sha-suite", 9))
+    {
+        if((argc > 2) && (0 == strcmp(argv[2], "csv")))
+        {
+            g_CryptoVerifyCa_ShaSuite(EN_REPORT_CSV);
+        }
+        else if((argc > 2) && (0 == strcmp(argv[2], "json")))
+        {
+            g_CryptoVerifyCa_ShaSuite(EN_REPORT_JSON);
+        }
+        else
+        {
+            printf("Entry sha suite CA\n");
+            g_CryptoVerifyCa_ShaSuite(EN_REPORT_TEXT);
+        }
+    }
+
+    if(0 == memcmp(argv[1], "bench", 5))
+    {
+        printf("Entry sha bench CA\n");
+        g_CryptoVerifyCa_Bench();
+    }
+
+    g_ShaClient_Shutdown();
     
 
-    return 0;
+    return (0 == l_Failed) ? 0 : 1;
 }
 
 
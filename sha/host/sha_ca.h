@@ -34,6 +34,7 @@
  *                                INCLUDE FILES
  *******************************************************************************
 */
+#include "sha_algo.h"
 
 
 
@@ -50,27 +51,44 @@
 #define TA_SHA_CMD_INC_VALUE 	0
 #define TA_SHA_CMD_HASH 		1
 #define TA_SHA_CMD_RANDOM 		2
+#define TA_SHA_CMD_HASH_INIT 		3
+#define TA_SHA_CMD_HASH_UPDATE 		4
+#define TA_SHA_CMD_HASH_FINAL 		5
+#define TA_SHA_CMD_HASH_BATCH 		6
+#define TA_SHA_CMD_MERKLE 		7
+#define TA_SHA_CMD_MERKLE_INIT 		8
+#define TA_SHA_CMD_MERKLE_UPDATE 	9
+#define TA_SHA_CMD_MERKLE_FINAL 	10
+#define TA_SHA_CMD_HASH_EXPORT 		11
+#define TA_SHA_CMD_HASH_IMPORT 		12
+
+/* HASH_INIT flags & the largest HASH_EXPORT blob */
+#define SHA_SEQ_F_EXPORTABLE    0x1U
+#define SHA_STATE_BLOB_MAX_SIZE 288U
 
 
 #define FAIL -1
 #define OK 0
 
+/* Per command tracing of the CA, built in only with CFG_SHA_TRACE=y */
+#ifdef CFG_SHA_TRACE
+#define SHA_CA_TRACE(...)   printf(__VA_ARGS__)
+#else
+#define SHA_CA_TRACE(...)   do { } while (0)
+#endif
+
 
 /*
  *******************************************************************************
  *                STRUCTRUE DEFINITION USED ONLY BY THIS MODULE
  *******************************************************************************
 */
-/* SHA operation type */
-typedef enum
+/* Record of TA_SHA_CMD_HASH_BATCH: a range of the input buffer */
+typedef struct
 {
-    EN_OP_SHA1 = 1,
-    EN_OP_SHA224,
-    EN_OP_SHA256,
-    EN_OP_SHA384,
-    EN_OP_SHA512,
-    EN_OP_SHA_INVALID
-}EN_SHA_MODE;
+    uint32_t Offset;
+    uint32_t Length;
+}ST_SHA_BATCH_ENTRY;
 
 
 /* Define the type of variable */
@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2016, Linaro Limited
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/* OP-TEE TEE client API (built by optee_client) */
+#include <tee_client_api.h>
+
+#include "sha_ca.h"
+#include "sha_client.h"
+
+
+
+/*
+ *******************************************************************************
+ *                          VARIABLES USED ONLY BY THIS MODULE
+ *******************************************************************************
+*/
+/* Session comes first: a borrowed session pointer is its pool slot */
+typedef struct
+{
+    TEEC_Session Session;
+    int Opened;                 /**< Session is open with the TA   */
+    int Busy;                   /**< Session is borrowed by a user */
+}ST_SHA_CLIENT_SLOT;
+
+static pthread_mutex_t g_ShaClientLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_ShaClientFree = PTHREAD_COND_INITIALIZER;
+static int g_ShaClientCtxReady = 0;
+static TEEC_Context g_ShaClientCtx;
+static ST_SHA_CLIENT_SLOT g_ShaClientPool[SHA_CLIENT_POOL_SIZE];
+
+
+
+/*
+ *******************************************************************************
+ *                               FUNCTIONS IMPLEMENT
+ *******************************************************************************
+*/
+
+/* Called with g_ShaClientLock held */
+static int l_ShaClient_InitContext(void)
+{
+    TEEC_Result result;
+
+    if(1 == g_ShaClientCtxReady)
+    {
+        return OK;
+    }
+
+    result = TEEC_InitializeContext(NULL, &g_ShaClientCtx);
+    if(result != TEEC_SUCCESS)
+    {
+        printf("InitializeContext failed, ReturnCode=0x%x\n", result);
+        return FAIL;
+    }
+
+    g_ShaClientCtxReady = 1;
+    return OK;
+}
+
+
+
+/* Called with g_ShaClientLock held */
+static int l_ShaClient_OpenSession(ST_SHA_CLIENT_SLOT* pSlot)
+{
+    TEEC_UUID l_Uuid = TA_SHA_UUID;
+    TEEC_Result result;
+    uint32_t origin;
+
+    result = TEEC_OpenSession(&g_ShaClientCtx, &pSlot->Session, &l_Uuid,
+                              TEEC_LOGIN_PUBLIC, NULL, NULL, &origin);
+    if(result != TEEC_SUCCESS)
+    {
+        printf("OpenSession failed, ReturnCode=0x%x, ReturnOrigin=0x%x\n", result, origin);
+        return FAIL;
+    }
+
+    pSlot->Opened = 1;
+    return OK;
+}
+
+
+
+TEEC_Session* g_ShaClient_Acquire(void)
+{
+    ST_SHA_CLIENT_SLOT* l_pSlot = NULL;
+    UINT32 index = 0U;
+
+    pthread_mutex_lock(&g_ShaClientLock);
+
+    /**1) Lazily initialize the TEE context */
+    if(OK != l_ShaClient_InitContext())
+    {
+        goto out;
+    }
+
+    while(NULL == l_pSlot)
+    {
+        /**2) Prefer an idle open session, else open a new one */
+        for(index = 0U; index < SHA_CLIENT_POOL_SIZE; index++)
+        {
+            if((1 == g_ShaClientPool[index].Opened) && (0 == g_ShaClientPool[index].Busy))
+            {
+                l_pSlot = &g_ShaClientPool[index];
+                break;
+            }
+        }
+
+        for(index = 0U; (NULL == l_pSlot) && (index < SHA_CLIENT_POOL_SIZE); index++)
+        {
+            if(0 == g_ShaClientPool[index].Opened)
+            {
+                if(OK != l_ShaClient_OpenSession(&g_ShaClientPool[index]))
+                {
+                    goto out;
+                }
+                l_pSlot = &g_ShaClientPool[index];
+            }
+        }
+
+        /**3) All sessions are borrowed: wait for one */
+        if(NULL == l_pSlot)
+        {
+            pthread_cond_wait(&g_ShaClientFree, &g_ShaClientLock);
+        }
+    }
+
+    l_pSlot->Busy = 1;
+
+out:
+    pthread_mutex_unlock(&g_ShaClientLock);
+    return (NULL == l_pSlot) ? NULL : &l_pSlot->Session;
+}
+
+
+
+void g_ShaClient_Release(TEEC_Session* session, int drop)
+{
+    ST_SHA_CLIENT_SLOT* l_pSlot = (ST_SHA_CLIENT_SLOT*)session;
+
+    if(NULL == session)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&g_ShaClientLock);
+    if(0 != drop)
+    {
+        TEEC_CloseSession(&l_pSlot->Session);
+        l_pSlot->Opened = 0;
+    }
+    l_pSlot->Busy = 0;
+    pthread_cond_signal(&g_ShaClientFree);
+    pthread_mutex_unlock(&g_ShaClientLock);
+}
+
+
+
+void g_ShaClient_Shutdown(void)
+{
+    UINT32 index = 0U;
+
+    pthread_mutex_lock(&g_ShaClientLock);
+    for(index = 0U; index < SHA_CLIENT_POOL_SIZE; index++)
+    {
+        if(1 == g_ShaClientPool[index].Opened)
+        {
+            TEEC_CloseSession(&g_ShaClientPool[index].Session);
+        }
+        g_ShaClientPool[index].Opened = 0;
+        g_ShaClientPool[index].Busy = 0;
+    }
+
+    if(1 == g_ShaClientCtxReady)
+    {
+        TEEC_FinalizeContext(&g_ShaClientCtx);
+        g_ShaClientCtxReady = 0;
+    }
+    pthread_mutex_unlock(&g_ShaClientLock);
+}
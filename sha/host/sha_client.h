@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2016, Linaro Limited
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MOUDLE_SHA_CLIENT_H_
+#define MOUDLE_SHA_CLIENT_H_
+
+
+
+
+/*
+ *******************************************************************************
+ *                                INCLUDE FILES
+ *******************************************************************************
+*/
+#include <tee_client_api.h>
+
+
+
+
+/*
+ *******************************************************************************
+ *                  MACRO DEFINITION USED ONLY BY THIS MODULE
+ *******************************************************************************
+*/
+/* Sessions kept open with the SHA TA, shared by all the client threads */
+#define SHA_CLIENT_POOL_SIZE    8
+
+
+
+
+/*
+ *******************************************************************************
+ *                      FUNCTIONS SUPPLIED BY THIS MODULE
+ *******************************************************************************
+*/
+/*
+ * Borrow an open session with the SHA TA. The TEE context is initialized on
+ * first use and sessions are opened on demand, up to SHA_CLIENT_POOL_SIZE;
+ * callers wait for a session to be given back when all are borrowed.
+ * Return NULL if the context or a session cannot be opened.
+ */
+extern TEEC_Session* g_ShaClient_Acquire(void);
+
+/*
+ * Give back a borrowed session. A session whose last command failed in the
+ * TEE (not in the TA) shall be dropped: it is closed instead of reused.
+ */
+extern void g_ShaClient_Release(TEEC_Session* session, int drop);
+
+/* Close all the sessions and the TEE context, the pool can be used again */
+extern void g_ShaClient_Shutdown(void);
+
+
+
+
+#endif  /* MOUDLE_SHA_CLIENT_H_ */
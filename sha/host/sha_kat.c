@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) 2016, Linaro Limited
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *******************************************************************************
+ *                                INCLUDE FILES
+ *******************************************************************************
+*/
+#include "sha_kat.h"
+
+
+
+
+/*
+ *******************************************************************************
+ *                      VARIABLES SUPPLIED BY THIS MODULE
+ *******************************************************************************
+*/
+/*
+ * For every SHA-1/SHA-2 mode: the empty message and the first byte-oriented
+ * messages of the SHAVS ShortMsg files, the FIPS 180 examples ("abc", 448
+ * and 896 bits) and the one million 'a' long message. The same messages but
+ * the SHAVS ones for SHA-3 & SHAKE, whose output length is the one of the
+ * Digest: the default one and its double or half, in turn.
+ */
+const ST_SHA_KAT g_ShaKatTable[] =
+{
+    /* SHA-1 */
+    { EN_OP_SHA1, "", 1U,
+      "da39a3ee5e6b4b0d3255bfef95601890afd80709" },
+    { EN_OP_SHA1, "36", 1U,
+      "c1dfd96eea8cc2b62785275bca38ac261256e278" },
+    { EN_OP_SHA1, "195a", 1U,
+      "0a1c2d555bbe431ad6288af5a54f93e0449c9232" },
+    { EN_OP_SHA1, "616263", 1U,
+      "a9993e364706816aba3e25717850c26c9cd0d89d" },
+    { EN_OP_SHA1, "6162636462636465636465666465666765666768"
+      "666768696768696a68696a6b696a6b6c6a6b6c6d6b6c6d6e6c6d6e6f6d6e6f70"
+      "6e6f7071", 1U,
+      "84983e441c3bd26ebaae4aa1f95129e5e54670f1" },
+    { EN_OP_SHA1, "6162636465666768626364656667686963646566"
+      "6768696a6465666768696a6b65666768696a6b6c666768696a6b6c6d6768696a"
+      "6b6c6d6e68696a6b6c6d6e6f696a6b6c6d6e6f706a6b6c6d6e6f70716b6c6d6e"
+      "6f7071726c6d6e6f707172736d6e6f70717273746e6f707172737475", 1U,
+      "a49b2446a02c645bf419f995b67091253a04a259" },
+    { EN_OP_SHA1, "61", 1000000U,
+      "34aa973cd4c4daa4f61eeb2bdbad27316534016f" },
+    /* SHA-224 */
+    { EN_OP_SHA224, "", 1U,
+      "d14a028c2a3a2bc9476102bb288234c415a2b01f828ea62ac5b3e42f" },
+    { EN_OP_SHA224, "84", 1U,
+      "3cd36921df5d6963e73739cf4d20211e2d8877c19cff087ade9d0e3a" },
+    { EN_OP_SHA224, "616263", 1U,
+      "23097d223405d8228642a477bda255b32aadbce4bda0b3f7e36c9da7" },
+    { EN_OP_SHA224, "6162636462636465636465666465666765666768"
+      "666768696768696a68696a6b696a6b6c6a6b6c6d6b6c6d6e6c6d6e6f6d6e6f70"
+      "6e6f7071", 1U,
+      "75388b16512776cc5dba5da1fd890150b0c6455cb4f58b1952522525" },
+    { EN_OP_SHA224, "6162636465666768626364656667686963646566"
+      "6768696a6465666768696a6b65666768696a6b6c666768696a6b6c6d6768696a"
+      "6b6c6d6e68696a6b6c6d6e6f696a6b6c6d6e6f706a6b6c6d6e6f70716b6c6d6e"
+      "6f7071726c6d6e6f707172736d6e6f70717273746e6f707172737475", 1U,
+      "c97ca9a559850ce97a04a96def6d99a9e0e0e2ab14e6b8df265fc0b3" },
+    { EN_OP_SHA224, "61", 1000000U,
+      "20794655980c91d8bbb4c1ea97618a4bf03f42581948b2ee4ee7ad67" },
+    /* SHA-256 */
+    { EN_OP_SHA256, "", 1U,
+      "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" },
+    { EN_OP_SHA256, "d3", 1U,
+      "28969cdfa74a12c82f3bad960b0b000aca2ac329deea5c2328ebc6f2ba9802c1" },
+    { EN_OP_SHA256, "11af", 1U,
+      "5ca7133fa735326081558ac312c620eeca9970d1e70a4b95533d956f072d1f98" },
+    { EN_OP_SHA256, "616263", 1U,
+      "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" },
+    { EN_OP_SHA256, "6162636462636465636465666465666765666768"
+      "666768696768696a68696a6b696a6b6c6a6b6c6d6b6c6d6e6c6d6e6f6d6e6f70"
+      "6e6f7071", 1U,
+      "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" },
+    { EN_OP_SHA256, "6162636465666768626364656667686963646566"
+      "6768696a6465666768696a6b65666768696a6b6c666768696a6b6c6d6768696a"
+      "6b6c6d6e68696a6b6c6d6e6f696a6b6c6d6e6f706a6b6c6d6e6f70716b6c6d6e"
+      "6f7071726c6d6e6f707172736d6e6f70717273746e6f707172737475", 1U,
+      "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1" },
+    { EN_OP_SHA256, "61", 1000000U,
+      "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0" },
+    /* SHA-384 */
+    { EN_OP_SHA384, "", 1U,
+      "38b060a751ac96384cd9327eb1b1e36a21fdb71114be07434c0cc7bf63f6e1da"
+      "274edebfe76f65fbd51ad2f14898b95b" },
+    { EN_OP_SHA384, "c5", 1U,
+      "b52b72da75d0666379e20f9b4a79c33a329a01f06a2fb7865c9062a28c1de860"
+      "ba432edfd86b4cb1cb8a75b46076e3b1" },
+    { EN_OP_SHA384, "616263", 1U,
+      "cb00753f45a35e8bb5a03d699ac65007272c32ab0eded1631a8b605a43ff5bed"
+      "8086072ba1e7cc2358baeca134c825a7" },
+    { EN_OP_SHA384, "6162636462636465636465666465666765666768"
+      "666768696768696a68696a6b696a6b6c6a6b6c6d6b6c6d6e6c6d6e6f6d6e6f70"
+      "6e6f7071", 1U,
+      "3391fdddfc8dc7393707a65b1b4709397cf8b1d162af05abfe8f450de5f36bc6"
+      "b0455a8520bc4e6f5fe95b1fe3c8452b" },
+    { EN_OP_SHA384, "6162636465666768626364656667686963646566"
+      "6768696a6465666768696a6b65666768696a6b6c666768696a6b6c6d6768696a"
+      "6b6c6d6e68696a6b6c6d6e6f696a6b6c6d6e6f706a6b6c6d6e6f70716b6c6d6e"
+      "6f7071726c6d6e6f707172736d6e6f70717273746e6f707172737475", 1U,
+      "09330c33f71147e83d192fc782cd1b4753111b173b3b05d22fa08086e3b0f712"
+      "fcc7c71a557e2db966c3e9fa91746039" },
+    { EN_OP_SHA384, "61", 1000000U,
+      "9d0e1809716474cb086e834e310a4a1ced149e9c00f248527972cec5704c2a5b"
+      "07b8b3dc38ecc4ebae97ddd87f3d8985" },
+    /* SHA-512 */
+    { EN_OP_SHA512, "", 1U,
+      "cf83e1357eefb8bdf1542850d66d8007d620e4050b5715dc83f4a921d36ce9ce"
+      "47d0d13c5d85f2b0ff8318d2877eec2f63b931bd47417a81a538327af927da3e" },
+    { EN_OP_SHA512, "21", 1U,
+      "3831a6a6155e509dee59a7f451eb35324d8f8f2df6e3708894740f98fdee2388"
+      "9f4de5adb0c5010dfb555cda77c8ab5dc902094c52de3278f35a75ebc25f093a" },
+    { EN_OP_SHA512, "616263", 1U,
+      "ddaf35a193617abacc417349ae20413112e6fa4e89a97ea20a9eeee64b55d39a"
+      "2192992a274fc1a836ba3c23a3feebbd454d4423643ce80e2a9ac94fa54ca49f" },
+    { EN_OP_SHA512, "6162636462636465636465666465666765666768"
+      "666768696768696a68696a6b696a6b6c6a6b6c6d6b6c6d6e6c6d6e6f6d6e6f70"
+      "6e6f7071", 1U,
+      "204a8fc6dda82f0a0ced7beb8e08a41657c16ef468b228a8279be331a703c335"
+      "96fd15c13b1b07f9aa1d3bea57789ca031ad85c7a71dd70354ec631238ca3445" },
+    { EN_OP_SHA512, "6162636465666768626364656667686963646566"
+      "6768696a6465666768696a6b65666768696a6b6c666768696a6b6c6d6768696a"
+      "6b6c6d6e68696a6b6c6d6e6f696a6b6c6d6e6f706a6b6c6d6e6f70716b6c6d6e"
+      "6f7071726c6d6e6f707172736d6e6f70717273746e6f707172737475", 1U,
+      "8e959b75dae313da8cf4f72814fc143f8f7779c6eb9f7fa17299aeadb6889018"
+      "501d289e4900f7e4331b99dec4b5433ac7d329eeb6dd26545e96e55b874be909" },
+    { EN_OP_SHA512, "61", 1000000U,
+      "e718483d0ce769644e2e42c7bc15b4638e1f98b13b2044285632a803afa973eb"
+      "de0ff244877ea60a4cb0432ce577c31beb009c5c2c49aa2e4eadb217ad8cc09b" },
+    /* SHA3-256 */
+    { EN_OP_SHA3_256, "", 1U,
+      "a7ffc6f8bf1ed76651c14756a061d662f580ff4de43b49fa82d80a4b80f8434a" },
+    { EN_OP_SHA3_256, "616263", 1U,
+      "3a985da74fe225b2045c172d6bd390bd855f086e3e9d525b46bfe24511431532" },
+    { EN_OP_SHA3_256, "6162636462636465636465666465666765666768"
+      "666768696768696a68696a6b696a6b6c6a6b6c6d6b6c6d6e6c6d6e6f6d6e6f70"
+      "6e6f7071", 1U,
+      "41c0dba2a9d6240849100376a8235e2c82e1b9998a999e21db32dd97496d3376" },
+    { EN_OP_SHA3_256, "6162636465666768626364656667686963646566"
+      "6768696a6465666768696a6b65666768696a6b6c666768696a6b6c6d6768696a"
+      "6b6c6d6e68696a6b6c6d6e6f696a6b6c6d6e6f706a6b6c6d6e6f70716b6c6d6e"
+      "6f7071726c6d6e6f707172736d6e6f70717273746e6f707172737475", 1U,
+      "916f6061fe879741ca6469b43971dfdb28b1a32dc36cb3254e812be27aad1d18" },
+    { EN_OP_SHA3_256, "61", 1000000U,
+      "5c8875ae474a3634ba4fd55ec85bffd661f32aca75c6d699d0cdcb6c115891c1" },
+    /* SHA3-384 */
+    { EN_OP_SHA3_384, "", 1U,
+      "0c63a75b845e4f7d01107d852e4c2485c51a50aaaa94fc61995e71bbee983a2a"
+      "c3713831264adb47fb6bd1e058d5f004" },
+    { EN_OP_SHA3_384, "616263", 1U,
+      "ec01498288516fc926459f58e2c6ad8df9b473cb0fc08c2596da7cf0e49be4b2"
+      "98d88cea927ac7f539f1edf228376d25" },
+    { EN_OP_SHA3_384, "6162636462636465636465666465666765666768"
+      "666768696768696a68696a6b696a6b6c6a6b6c6d6b6c6d6e6c6d6e6f6d6e6f70"
+      "6e6f7071", 1U,
+      "991c665755eb3a4b6bbdfb75c78a492e8c56a22c5c4d7e429bfdbc32b9d4ad5a"
+      "a04a1f076e62fea19eef51acd0657c22" },
+    { EN_OP_SHA3_384, "6162636465666768626364656667686963646566"
+      "6768696a6465666768696a6b65666768696a6b6c666768696a6b6c6d6768696a"
+      "6b6c6d6e68696a6b6c6d6e6f696a6b6c6d6e6f706a6b6c6d6e6f70716b6c6d6e"
+      "6f7071726c6d6e6f707172736d6e6f70717273746e6f707172737475", 1U,
+      "79407d3b5916b59c3e30b09822974791c313fb9ecc849e406f23592d04f625dc"
+      "8c709b98b43b3852b337216179aa7fc7" },
+    { EN_OP_SHA3_384, "61", 1000000U,
+      "eee9e24d78c1855337983451df97c8ad9eedf256c6334f8e948d252d5e0e7684"
+      "7aa0774ddb90a842190d2c558b4b8340" },
+    /* SHA3-512 */
+    { EN_OP_SHA3_512, "", 1U,
+      "a69f73cca23a9ac5c8b567dc185a756e97c982164fe25859e0d1dcc1475c80a6"
+      "15b2123af1f5f94c11e3e9402c3ac558f500199d95b6d3e301758586281dcd26" },
+    { EN_OP_SHA3_512, "616263", 1U,
+      "b751850b1a57168a5693cd924b6b096e08f621827444f70d884f5d0240d2712e"
+      "10e116e9192af3c91a7ec57647e3934057340b4cf408d5a56592f8274eec53f0" },
+    { EN_OP_SHA3_512, "6162636462636465636465666465666765666768"
+      "666768696768696a68696a6b696a6b6c6a6b6c6d6b6c6d6e6c6d6e6f6d6e6f70"
+      "6e6f7071", 1U,
+      "04a371e84ecfb5b8b77cb48610fca8182dd457ce6f326a0fd3d7ec2f1e91636d"
+      "ee691fbe0c985302ba1b0d8dc78c086346b533b49c030d99a27daf1139d6e75e" },
+    { EN_OP_SHA3_512, "6162636465666768626364656667686963646566"
+      "6768696a6465666768696a6b65666768696a6b6c666768696a6b6c6d6768696a"
+      "6b6c6d6e68696a6b6c6d6e6f696a6b6c6d6e6f706a6b6c6d6e6f70716b6c6d6e"
+      "6f7071726c6d6e6f707172736d6e6f70717273746e6f707172737475", 1U,
+      "afebb2ef542e6579c50cad06d2e578f9f8dd6881d7dc824d26360feebf18a4fa"
+      "73e3261122948efcfd492e74e82e2189ed0fb440d187f382270cb455f21dd185" },
+    { EN_OP_SHA3_512, "61", 1000000U,
+      "3c3a876da14034ab60627c077bb98f7e120a2a5370212dffb3385a18d4f38859"
+      "ed311d0a9d5141ce9cc5c66ee689b266a8aa18ace8282a0e0db596c90b0a7b87" },
+    /* SHAKE128 */
+    { EN_OP_SHAKE128, "", 1U,
+      "7f9c2ba4e88f827d616045507605853ed73b8093f6efbc88eb1a6eacfa66ef26" },
+    { EN_OP_SHAKE128, "616263", 1U,
+      "5881092dd818bf5cf8a3ddb793fbcba74097d5c526a6d35f97b83351940f2cc8"
+      "44c50af32acd3f2cdd066568706f509bc1bdde58295dae3f891a9a0fca578378" },
+    { EN_OP_SHAKE128, "6162636462636465636465666465666765666768"
+      "666768696768696a68696a6b696a6b6c6a6b6c6d6b6c6d6e6c6d6e6f6d6e6f70"
+      "6e6f7071", 1U,
+      "1a96182b50fb8c7e74e0a707788f55e98209b8d91fade8f32f8dd5cff7bf21f5" },
+    { EN_OP_SHAKE128, "6162636465666768626364656667686963646566"
+      "6768696a6465666768696a6b65666768696a6b6c666768696a6b6c6d6768696a"
+      "6b6c6d6e68696a6b6c6d6e6f696a6b6c6d6e6f706a6b6c6d6e6f70716b6c6d6e"
+      "6f7071726c6d6e6f707172736d6e6f70717273746e6f707172737475", 1U,
+      "7b6df6ff181173b6d7898d7ff63fb07b7c237daf471a5ae5602adbccef9ccf4b"
+      "37e06b4a3543164ffbe0d0557c02f9b25ad434005526d88ca04a6094b93ee57a" },
+    { EN_OP_SHAKE128, "61", 1000000U,
+      "9d222c79c4ff9d092cf6ca86143aa411e369973808ef97093255826c5572ef58" },
+    /* SHAKE256 */
+    { EN_OP_SHAKE256, "", 1U,
+      "46b9dd2b0ba88d13233b3feb743eeb243fcd52ea62b81b82b50c27646ed5762f"
+      "d75dc4ddd8c0f200cb05019d67b592f6fc821c49479ab48640292eacb3b7c4be" },
+    { EN_OP_SHAKE256, "616263", 1U,
+      "483366601360a8771c6863080cc4114d8db44530f8f1e1ee4f94ea37e78b5739" },
+    { EN_OP_SHAKE256, "6162636462636465636465666465666765666768"
+      "666768696768696a68696a6b696a6b6c6a6b6c6d6b6c6d6e6c6d6e6f6d6e6f70"
+      "6e6f7071", 1U,
+      "4d8c2dd2435a0128eefbb8c36f6f87133a7911e18d979ee1ae6be5d4fd2e3329"
+      "40d8688a4e6a59aa8060f1f9bc996c05aca3c696a8b66279dc672c740bb224ec" },
+    { EN_OP_SHAKE256, "6162636465666768626364656667686963646566"
+      "6768696a6465666768696a6b65666768696a6b6c666768696a6b6c6d6768696a"
+      "6b6c6d6e68696a6b6c6d6e6f696a6b6c6d6e6f706a6b6c6d6e6f70716b6c6d6e"
+      "6f7071726c6d6e6f707172736d6e6f70717273746e6f707172737475", 1U,
+      "98be04516c04cc73593fef3ed0352ea9f6443942d6950e29a372a681c3deaf45" },
+    { EN_OP_SHAKE256, "61", 1000000U,
+      "3578a7a4ca9137569cdf76ed617d31bb994fca9c1bbf8b184013de8234dfd13a"
+      "3fd124d4df76c0a539ee7dd2f6e1ec346124c815d9410e145eb561bcd97b18ab" },
+
+};
+
+const uint32_t g_ShaKatCount = sizeof(g_ShaKatTable) / sizeof(g_ShaKatTable[0]);
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2016, Linaro Limited
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MOUDLE_SHA_KAT_H_
+#define MOUDLE_SHA_KAT_H_
+
+
+
+
+/*
+ *******************************************************************************
+ *                                INCLUDE FILES
+ *******************************************************************************
+*/
+#include "sha_algo.h"
+
+
+
+
+/*
+ *******************************************************************************
+ *                STRUCTRUE DEFINITION USED ONLY BY THIS MODULE
+ *******************************************************************************
+*/
+/*
+ * Known answer test: the message is Msg repeated Repeat times, Msg and the
+ * expected Digest are hex strings as in the NIST response files.
+ */
+typedef struct
+{
+    EN_SHA_MODE Mode;
+    const char* Msg;
+    uint32_t Repeat;
+    const char* Digest;
+}ST_SHA_KAT;
+
+
+
+
+/*
+ *******************************************************************************
+ *                      VARIABLES SUPPLIED BY THIS MODULE
+ *******************************************************************************
+*/
+extern const ST_SHA_KAT g_ShaKatTable[];
+extern const uint32_t g_ShaKatCount;
+
+
+
+
+#endif  /* MOUDLE_SHA_KAT_H_ */
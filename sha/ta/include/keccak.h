@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2016, Linaro Limited
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MOUDLE_KECCAK_H_
+#define MOUDLE_KECCAK_H_
+
+
+
+
+/*
+ *******************************************************************************
+ *                                INCLUDE FILES
+ *******************************************************************************
+*/
+#include <stdint.h>
+
+
+
+
+/*
+ *******************************************************************************
+ *                  MACRO DEFINITION USED ONLY BY THIS MODULE
+ *******************************************************************************
+*/
+/* Domain separation & first padding bit of the FIPS 202 functions */
+#define KECCAK_DS_SHA3      0x06U
+#define KECCAK_DS_SHAKE     0x1FU
+
+
+
+
+/*
+ *******************************************************************************
+ *                STRUCTRUE DEFINITION USED ONLY BY THIS MODULE
+ *******************************************************************************
+*/
+/* Keccak[c] sponge over the Keccak-f[1600] permutation */
+typedef struct
+{
+    uint64_t State[25];     /**< Lanes, x + 5 * y                         */
+    uint32_t Rate;          /**< Bytes absorbed or squeezed per permutation */
+    uint32_t Pos;           /**< Byte of the block being absorbed/squeezed */
+    uint8_t DsByte;         /**< KECCAK_DS_SHA3 or KECCAK_DS_SHAKE         */
+    uint8_t Squeezing;      /**< 1 once the padding has been absorbed      */
+}ST_KECCAK;
+
+
+
+
+/*
+ *******************************************************************************
+ *                      FUNCTIONS SUPPLIED BY THIS MODULE
+ *******************************************************************************
+*/
+/* Start an empty sponge, rate in bytes: 200 - 2 * security strength */
+extern void g_Keccak_Init(ST_KECCAK* pCtx, uint32_t rate, uint8_t dsByte);
+
+/* Absorb data, shall not be called once squeezing started */
+extern void g_Keccak_Absorb(ST_KECCAK* pCtx, const void* input, uint32_t len);
+
+/* Pad on the first call, then output any number of bytes in one or more calls */
+extern void g_Keccak_Squeeze(ST_KECCAK* pCtx, void* output, uint32_t len);
+
+
+
+
+#endif  /* MOUDLE_KECCAK_H_ */
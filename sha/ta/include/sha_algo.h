@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2016, Linaro Limited
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef SHA_ALGO_H
+#define SHA_ALGO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* SHA operation type */
+typedef enum
+{
+    EN_OP_SHA1 = 1,
+    EN_OP_SHA224,
+    EN_OP_SHA256,
+    EN_OP_SHA384,
+    EN_OP_SHA512,
+    EN_OP_SHA3_256,
+    EN_OP_SHA3_384,
+    EN_OP_SHA3_512,
+    EN_OP_SHAKE128,
+    EN_OP_SHAKE256,
+    EN_OP_SHA_INVALID
+}EN_SHA_MODE;
+
+/* Largest digest & block of the table, to size buffers up front */
+#define SHA_MAX_DIGEST_SIZE     64U
+#define SHA_MAX_BLOCK_SIZE      168U
+
+/* ST_SHA_ALGO.Flags */
+#define SHA_ALGO_F_KECCAK       0x1U    /**< FIPS 202 sponge, BlockSize is the rate */
+#define SHA_ALGO_F_XOF          0x2U    /**< Any output length, DigestSize is the
+                                             default one                          */
+
+/* Algorithm of a sha mode, shared by the TA and the CA */
+typedef struct
+{
+    EN_SHA_MODE Mode;
+    uint32_t AlgorithmId;   /**< TEE_ALG_xxx of the TEE Internal Core API */
+    uint32_t DigestSize;    /**< Bytes of the digest                      */
+    uint32_t BlockSize;     /**< Bytes of an input block                  */
+    uint32_t Flags;         /**< SHA_ALGO_F_xxx                           */
+    const char* Name;
+}ST_SHA_ALGO;
+
+/*
+ * Get the algorithm of a sha mode, NULL for an unknown mode. The algorithm
+ * IDs are spelled out as the CA has no tee_api_defines.h; the SHA-3 ones are
+ * those of GP 1.2.1, the SHAKE ones are private as GP has no XOF digest.
+ */
+static inline const ST_SHA_ALGO* g_ShaAlgo_Get(uint32_t shaMode)
+{
+    static const ST_SHA_ALGO l_ShaAlgoTable[] =
+    {
+        { EN_OP_SHA1,     0x50000002U, 20U, 64U,  0U,                "sha1"     },
+        { EN_OP_SHA224,   0x50000003U, 28U, 64U,  0U,                "sha224"   },
+        { EN_OP_SHA256,   0x50000004U, 32U, 64U,  0U,                "sha256"   },
+        { EN_OP_SHA384,   0x50000005U, 48U, 128U, 0U,                "sha384"   },
+        { EN_OP_SHA512,   0x50000006U, 64U, 128U, 0U,                "sha512"   },
+        { EN_OP_SHA3_256, 0x50000009U, 32U, 136U, SHA_ALGO_F_KECCAK, "sha3-256" },
+        { EN_OP_SHA3_384, 0x5000000AU, 48U, 104U, SHA_ALGO_F_KECCAK, "sha3-384" },
+        { EN_OP_SHA3_512, 0x5000000BU, 64U, 72U,  SHA_ALGO_F_KECCAK, "sha3-512" },
+        { EN_OP_SHAKE128, 0x50000101U, 32U, 168U, SHA_ALGO_F_KECCAK | SHA_ALGO_F_XOF, "shake128" },
+        { EN_OP_SHAKE256, 0x50000102U, 64U, 136U, SHA_ALGO_F_KECCAK | SHA_ALGO_F_XOF, "shake256" },
+    };
+
+    /* The table is in the order of EN_SHA_MODE */
+    if((shaMode < EN_OP_SHA1) || (shaMode >= EN_OP_SHA_INVALID))
+    {
+        return NULL;
+    }
+    return &l_ShaAlgoTable[shaMode - EN_OP_SHA1];
+}
+
+#endif /* SHA_ALGO_H */
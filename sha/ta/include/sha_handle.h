@@ -38,6 +38,9 @@
 #include "tee_api_defines.h"
 #include "trace.h"
 #include "tee_api_defines_extensions.h"
+#include "sha_algo.h"
+#include "keccak.h"
+#include "sha_soft.h"
 
 
 
@@ -47,6 +50,29 @@
  *                  MACRO DEFINITION USED ONLY BY THIS MODULE
  *******************************************************************************
 */
+/*
+ * Hot path tracing, built in only with CFG_SHA_TRACE=y. When disabled the
+ * arguments are not evaluated and nothing is left in the TA binary.
+ */
+#ifdef CFG_SHA_TRACE
+#define SHA_TRACE(...)              DMSG(__VA_ARGS__)
+#define SHA_TRACE_HEX(buf, len)     g_TA_printf((buf), (len))
+#else
+#define SHA_TRACE(...)              do { } while (0)
+#define SHA_TRACE_HEX(buf, len)     do { } while (0)
+#endif
+
+/* Bytes of a buffer formatted into one trace line, the rest is cut */
+#define SHA_TRACE_HEX_MAX           64U
+
+/* Subtree roots kept while hashing a Merkle tree: up to 2^32 leaves */
+#define SHA_MERKLE_MAX_LEVELS       33U
+
+/* Exported hash sequence state: "SHS1", then nonce & tag of AES-256-GCM */
+#define SHA_STATE_MAGIC             0x53485331U
+#define SHA_STATE_NONCE_SIZE        12U
+#define SHA_STATE_TAG_SIZE          16U
+#define SHA_STATE_KEY_BITS          256U
 
 
 
@@ -57,17 +83,6 @@
  *                STRUCTRUE DEFINITION USED ONLY BY THIS MODULE
  *******************************************************************************
 */
-/* SHA operation type */
-typedef enum
-{
-    EN_OP_SHA1 = 1,
-    EN_OP_SHA224,
-    EN_OP_SHA256,
-    EN_OP_SHA384,
-    EN_OP_SHA512,
-    EN_OP_SHA_INVALID
-}EN_SHA_MODE;
-
 
 /* Define the type of variable */
 typedef unsigned char  UINT8;    /**< Typedef for 8bits unsigned integer  */
@@ -80,6 +95,76 @@ typedef char           CHAR;     /**< Typedef for char                    */
 typedef uint32_t       TEE_CRYPTO_ALGORITHM_ID;
 
 
+/* Implementation behind a ST_SHA_DIGEST */
+typedef enum
+{
+    EN_DIGEST_TEE = 0,      /**< Operation of the TEE core          */
+    EN_DIGEST_KECCAK,       /**< Keccak sponge of the TA            */
+    EN_DIGEST_SOFT          /**< SHA-1/SHA-2 of the TA, exportable  */
+}EN_DIGEST_BACKEND;
+
+
+/*
+ * Digest of one algorithm: a TEE operation, or the Keccak sponge of the TA
+ * for the SHA-3 functions the TEE core lacks and for SHAKE, or the SHA-1/
+ * SHA-2 code of the TA when the state shall be exported.
+ */
+typedef struct
+{
+    const ST_SHA_ALGO* pAlgo;               /**< Algorithm, NULL when unused */
+    EN_DIGEST_BACKEND Backend;
+    UINT32 Exportable;                      /**< 1 to keep the state in TA   */
+    TEE_OperationHandle OperationHandle;    /**< EN_DIGEST_TEE only          */
+    union
+    {
+        ST_KECCAK Keccak;                   /**< EN_DIGEST_KECCAK            */
+        ST_SHA_SOFT Soft;                   /**< EN_DIGEST_SOFT              */
+    }State;
+}ST_SHA_DIGEST;
+
+
+/*
+ * Exported state of a hash sequence. The header is authenticated, the
+ * state of the digest (ST_KECCAK or ST_SHA_SOFT) follows it encrypted.
+ */
+typedef struct
+{
+    UINT32 Magic;                           /**< SHA_STATE_MAGIC             */
+    UINT32 Mode;                            /**< EN_SHA_MODE                 */
+    UINT32 Backend;                         /**< EN_DIGEST_BACKEND           */
+    UINT32 StateSize;                       /**< Bytes of encrypted state    */
+    UINT8 Nonce[SHA_STATE_NONCE_SIZE];
+    UINT8 Tag[SHA_STATE_TAG_SIZE];
+}ST_SHA_STATE_HEADER;
+
+
+/*
+ * Merkle tree being hashed: the current leaf and the stack of the roots of
+ * the complete subtrees on its left, at most one per level.
+ */
+typedef struct
+{
+    ST_SHA_DIGEST LeafDigest;               /**< Digest of the current leaf  */
+    ST_SHA_DIGEST NodeDigest;               /**< Digest of interior nodes    */
+    const ST_SHA_ALGO* pAlgo;               /**< Algorithm of the tree       */
+    UINT32 LeafSize;                        /**< Bytes of a full leaf        */
+    UINT32 LeafFill;                        /**< Bytes in the current leaf   */
+    UINT32 Depth;                           /**< Subtree roots on the stack  */
+    UINT32 Level[SHA_MERKLE_MAX_LEVELS];    /**< Height of each subtree      */
+    UINT8 Node[SHA_MERKLE_MAX_LEVELS][SHA_MAX_DIGEST_SIZE];
+}ST_SHA_MERKLE;
+
+
+/* Per session context: digest operation of the current hash sequence */
+typedef struct
+{
+    ST_SHA_DIGEST Digest;                   /**< Digest operation, reused    */
+    UINT32 SeqActive;                       /**< 1 between INIT and FINAL    */
+    ST_SHA_MERKLE* pMerkle;                 /**< Tree between MERKLE_INIT
+                                                 and MERKLE_FINAL, or NULL   */
+}ST_SHA_SESSION;
+
+
 
 
 
@@ -101,7 +186,18 @@ typedef uint32_t       TEE_CRYPTO_ALGORITHM_ID;
 */
 extern int g_CryptoTaHandle_Sha(uint32_t paramTypes, TEE_Param params[4]);
 extern int g_CryptoTaHandle_Random(uint32_t paramTypes, TEE_Param params[4]);
-extern void g_TA_printf(CHAR* buf, UINT32 len);
+extern int g_CryptoTaHandle_HashInit(ST_SHA_SESSION* pSession, uint32_t paramTypes, TEE_Param params[4]);
+extern int g_CryptoTaHandle_HashUpdate(ST_SHA_SESSION* pSession, uint32_t paramTypes, TEE_Param params[4]);
+extern int g_CryptoTaHandle_HashFinal(ST_SHA_SESSION* pSession, uint32_t paramTypes, TEE_Param params[4]);
+extern int g_CryptoTaHandle_HashExport(ST_SHA_SESSION* pSession, uint32_t paramTypes, TEE_Param params[4]);
+extern int g_CryptoTaHandle_HashImport(ST_SHA_SESSION* pSession, uint32_t paramTypes, TEE_Param params[4]);
+extern int g_CryptoTaHandle_HashBatch(uint32_t paramTypes, TEE_Param params[4]);
+extern int g_CryptoTaHandle_Merkle(uint32_t paramTypes, TEE_Param params[4]);
+extern int g_CryptoTaHandle_MerkleInit(ST_SHA_SESSION* pSession, uint32_t paramTypes, TEE_Param params[4]);
+extern int g_CryptoTaHandle_MerkleUpdate(ST_SHA_SESSION* pSession, uint32_t paramTypes, TEE_Param params[4]);
+extern int g_CryptoTaHandle_MerkleFinal(ST_SHA_SESSION* pSession, uint32_t paramTypes, TEE_Param params[4]);
+extern void g_CryptoTaHandle_CloseSession(ST_SHA_SESSION* pSession);
+extern void g_TA_printf(const CHAR* buf, UINT32 len);
 
 
 
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2016, Linaro Limited
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MOUDLE_SHA_SOFT_H_
+#define MOUDLE_SHA_SOFT_H_
+
+
+
+
+/*
+ *******************************************************************************
+ *                                INCLUDE FILES
+ *******************************************************************************
+*/
+#include <stdint.h>
+#include "sha_algo.h"
+
+
+
+
+/*
+ *******************************************************************************
+ *                STRUCTRUE DEFINITION USED ONLY BY THIS MODULE
+ *******************************************************************************
+*/
+/*
+ * SHA-1/SHA-2 digest computed by the TA itself, for the sequences whose
+ * state shall leave the TA: a TEE operation does not expose it.
+ */
+typedef struct
+{
+    union
+    {
+        uint32_t W32[8];    /**< SHA-1, SHA-224, SHA-256 */
+        uint64_t W64[8];    /**< SHA-384, SHA-512        */
+    }H;                     /**< Chaining value          */
+    uint64_t Length;        /**< Bytes hashed so far     */
+    uint32_t Mode;          /**< EN_SHA_MODE             */
+    uint32_t Fill;          /**< Bytes in Block          */
+    uint8_t Block[128];     /**< Input block in progress */
+}ST_SHA_SOFT;
+
+
+
+
+/*
+ *******************************************************************************
+ *                      FUNCTIONS SUPPLIED BY THIS MODULE
+ *******************************************************************************
+*/
+/* Start an empty digest, return -1 for a mode other than SHA-1/SHA-2 */
+extern int g_ShaSoft_Init(ST_SHA_SOFT* pCtx, uint32_t shaMode);
+
+/* Add data to the digest */
+extern void g_ShaSoft_Update(ST_SHA_SOFT* pCtx, const void* input, uint32_t len);
+
+/* Write the digest, of the size of the mode, and start an empty one again */
+extern void g_ShaSoft_Final(ST_SHA_SOFT* pCtx, void* output);
+
+
+
+
+#endif  /* MOUDLE_SHA_SOFT_H_ */
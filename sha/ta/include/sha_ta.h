@@ -27,20 +27,107 @@
 #ifndef TA_SHA_H
 #define TA_SHA_H
 
+#include <stdint.h>
+
 /* This UUID is generated with uuidgen
    the ITU-T UUID generator at http://www.itu.int/ITU-T/asn1/uuid.html */
 /* 9269fadd-99d5-4afb-a1dc-ee3e9c61b04c  */
 #define TA_SHA_UUID { 0x9269fadd, 0x99d5, 0x4afb, \
 		{ 0xa1, 0xdc, 0xee, 0x3e, 0x9c, 0x61, 0xb0, 0x4c} }
 
-/* The Trusted Application Function ID(s) implemented in this TA */
+/*
+ * The Trusted Application Function ID(s) implemented in this TA
+ * - HASH param[0] (memref) input data
+ *        param[1] (value) a: EN_SHA_MODE
+ *        param[2] (memref) output digest, size updated
+ * Commands returning a digest fail with TEE_ERROR_SHORT_BUFFER when the
+ * output is too short, its size is then set to the required one.
+ * The SHAKE modes output as many bytes as the buffer of HASH or HASH_FINAL
+ * holds, and their default size (ST_SHA_ALGO.DigestSize) in the other
+ * commands or when that buffer is empty.
+ */
 #define TA_SHA_CMD_INC_VALUE	0
 #define TA_SHA_CMD_HASH	        1
 #define TA_SHA_CMD_RANDOM	2
 
+/*
+ * Hash sequence: TA_SHA_CMD_HASH_INIT starts a digest kept in the session,
+ * TA_SHA_CMD_HASH_UPDATE adds data in chunks of any size and
+ * TA_SHA_CMD_HASH_FINAL adds the last chunk and returns the digest.
+ * - HASH_INIT   param[0] (value) a: EN_SHA_MODE, b: SHA_SEQ_F_xxx
+ * - HASH_UPDATE param[0] (memref) input data
+ * - HASH_FINAL  param[0] (memref) last input data, may be empty
+ *               param[1] (memref) output digest, size updated
+ */
+#define TA_SHA_CMD_HASH_INIT	3
+#define TA_SHA_CMD_HASH_UPDATE	4
+#define TA_SHA_CMD_HASH_FINAL	5
+
+/*
+ * Batch of digests over records of one input buffer, in one invocation.
+ * - param[0] (memref) input data
+ * - param[1] (memref) array of ST_SHA_BATCH_ENTRY, one per record
+ * - param[2] (value) a: EN_SHA_MODE
+ * - param[3] (memref) output, the digests of the records one after the
+ *            other, size updated
+ */
+#define TA_SHA_CMD_HASH_BATCH	6
+
+/*
+ * Merkle tree root over leaves of a fixed size, the last one may be shorter.
+ * Leaves are H(0x00 || leaf data), interior nodes H(0x01 || left || right)
+ * and a node without a sibling moves up as is, as in RFC 6962. The root of
+ * an empty input is H(). Leaf hashes are optionally returned for proofs.
+ * - MERKLE        param[0] (memref) input data
+ *                 param[1] (value) a: EN_SHA_MODE, b: leaf size
+ *                 param[2] (memref) output root, size updated
+ *                 param[3] (memref) output leaf hashes, size updated, or none
+ * The same as a sequence, with the tree kept in the session:
+ * - MERKLE_INIT   param[0] (value) a: EN_SHA_MODE, b: leaf size
+ * - MERKLE_UPDATE param[0] (memref) input data, of any size
+ *                 param[1] (memref) output hashes of the leaves completed by
+ *                          this data, size updated, or none
+ * - MERKLE_FINAL  param[0] (memref) output root, size updated
+ *                 param[1] (memref) output hash of the last leaf when it is
+ *                          shorter than the leaf size, size updated, or none
+ */
+#define TA_SHA_CMD_MERKLE	7
+#define TA_SHA_CMD_MERKLE_INIT	8
+#define TA_SHA_CMD_MERKLE_UPDATE	9
+#define TA_SHA_CMD_MERKLE_FINAL	10
+
+/*
+ * Context save & load of a hash sequence. HASH_EXPORT seals the state of the
+ * session sequence into a blob, encrypted and authenticated with a key of
+ * the TA kept in secure storage; the sequence goes on. HASH_IMPORT replaces
+ * the session sequence with the one of a blob, which may come from another
+ * session. Only sequences started with SHA_SEQ_F_EXPORTABLE, and SHA-3 or
+ * SHAKE sequences hashed by the TA, can be exported: the state of a TEE
+ * operation cannot be read, so exportable SHA-1/SHA-2 sequences are hashed
+ * by the TA itself.
+ * - HASH_EXPORT param[0] (memref) output blob, size updated, at most
+ *               SHA_STATE_BLOB_MAX_SIZE bytes
+ * - HASH_IMPORT param[0] (memref) input blob, TEE_ERROR_MAC_INVALID when it
+ *               was not exported by this TA or was altered
+ */
+#define TA_SHA_CMD_HASH_EXPORT	11
+#define TA_SHA_CMD_HASH_IMPORT	12
+
+#define SHA_SEQ_F_EXPORTABLE    0x1U
+#define SHA_STATE_BLOB_MAX_SIZE 288U
+
+/* Record of TA_SHA_CMD_HASH_BATCH: a range of the input buffer */
+typedef struct
+{
+    uint32_t Offset;
+    uint32_t Length;
+}ST_SHA_BATCH_ENTRY;
+
 
 #define FAIL -1
 #define OK 0
+#define FAIL_SHORT_BUFFER -2    /* Output too short, required size set */
+#define FAIL_MAC_INVALID -3     /* Sealed data not authentic */
 #define TEE_ALG_INVALID     0xFFFFFFFFU
 
 
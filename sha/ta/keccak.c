@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) 2016, Linaro Limited
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *******************************************************************************
+ *                                INCLUDE FILES
+ *******************************************************************************
+*/
+#include <string.h>
+#include "keccak.h"
+
+
+
+
+/*
+ *******************************************************************************
+ *                  MACRO DEFINITION USED ONLY BY THIS MODULE
+ *******************************************************************************
+*/
+#define KECCAK_ROL(a, n)    (((a) << (n)) | ((a) >> (64 - (n))))
+#define KECCAK_ROUNDS       24U
+
+
+
+
+/*
+ *******************************************************************************
+ *                          VARIABLES USED ONLY BY THIS MODULE
+ *******************************************************************************
+*/
+static const uint64_t l_KeccakRc[KECCAK_ROUNDS] =
+{
+    0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL, 0x8000000080008000ULL,
+    0x000000000000808bULL, 0x0000000080000001ULL, 0x8000000080008081ULL, 0x8000000000008009ULL,
+    0x000000000000008aULL, 0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
+    0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL, 0x8000000000008003ULL,
+    0x8000000000008002ULL, 0x8000000000000080ULL, 0x000000000000800aULL, 0x800000008000000aULL,
+    0x8000000080008081ULL, 0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL
+};
+
+
+
+
+/*
+ *******************************************************************************
+ *                          FUNCTIONS USED ONLY BY THIS MODULE
+ *******************************************************************************
+*/
+/*
+ * Keccak-f[1600]. The steps of a round are unrolled over lanes held in
+ * locals, aYX being lane x + 5 * y, so that they can live in registers.
+ */
+static void l_Keccak_Permute(uint64_t* state)
+{
+    uint64_t a00, a01, a02, a03, a04, a10, a11, a12, a13, a14, a20, a21, a22, a23, a24;
+    uint64_t a30, a31, a32, a33, a34, a40, a41, a42, a43, a44;
+    uint64_t b00, b01, b02, b03, b04, b10, b11, b12, b13, b14, b20, b21, b22, b23, b24;
+    uint64_t b30, b31, b32, b33, b34, b40, b41, b42, b43, b44;
+    uint64_t c0, c1, c2, c3, c4, d0, d1, d2, d3, d4;
+    uint32_t round = 0U;
+
+    a00 = state[0];  a01 = state[1];  a02 = state[2];  a03 = state[3];  a04 = state[4];
+    a10 = state[5];  a11 = state[6];  a12 = state[7];  a13 = state[8];  a14 = state[9];
+    a20 = state[10]; a21 = state[11]; a22 = state[12]; a23 = state[13]; a24 = state[14];
+    a30 = state[15]; a31 = state[16]; a32 = state[17]; a33 = state[18]; a34 = state[19];
+    a40 = state[20]; a41 = state[21]; a42 = state[22]; a43 = state[23]; a44 = state[24];
+
+    for(round = 0U; round < KECCAK_ROUNDS; round++)
+    {
+        /* Theta */
+        c0 = a00 ^ a10 ^ a20 ^ a30 ^ a40;
+        c1 = a01 ^ a11 ^ a21 ^ a31 ^ a41;
+        c2 = a02 ^ a12 ^ a22 ^ a32 ^ a42;
+        c3 = a03 ^ a13 ^ a23 ^ a33 ^ a43;
+        c4 = a04 ^ a14 ^ a24 ^ a34 ^ a44;
+        d0 = c4 ^ KECCAK_ROL(c1, 1);
+        d1 = c0 ^ KECCAK_ROL(c2, 1);
+        d2 = c1 ^ KECCAK_ROL(c3, 1);
+        d3 = c2 ^ KECCAK_ROL(c4, 1);
+        d4 = c3 ^ KECCAK_ROL(c0, 1);
+
+        /* Rho & pi */
+        b00 = a00 ^ d0;
+        b01 = KECCAK_ROL(a11 ^ d1, 44);
+        b02 = KECCAK_ROL(a22 ^ d2, 43);
+        b03 = KECCAK_ROL(a33 ^ d3, 21);
+        b04 = KECCAK_ROL(a44 ^ d4, 14);
+        b10 = KECCAK_ROL(a03 ^ d3, 28);
+        b11 = KECCAK_ROL(a14 ^ d4, 20);
+        b12 = KECCAK_ROL(a20 ^ d0, 3);
+        b13 = KECCAK_ROL(a31 ^ d1, 45);
+        b14 = KECCAK_ROL(a42 ^ d2, 61);
+        b20 = KECCAK_ROL(a01 ^ d1, 1);
+        b21 = KECCAK_ROL(a12 ^ d2, 6);
+        b22 = KECCAK_ROL(a23 ^ d3, 25);
+        b23 = KECCAK_ROL(a34 ^ d4, 8);
+        b24 = KECCAK_ROL(a40 ^ d0, 18);
+        b30 = KECCAK_ROL(a04 ^ d4, 27);
+        b31 = KECCAK_ROL(a10 ^ d0, 36);
+        b32 = KECCAK_ROL(a21 ^ d1, 10);
+        b33 = KECCAK_ROL(a32 ^ d2, 15);
+        b34 = KECCAK_ROL(a43 ^ d3, 56);
+        b40 = KECCAK_ROL(a02 ^ d2, 62);
+        b41 = KECCAK_ROL(a13 ^ d3, 55);
+        b42 = KECCAK_ROL(a24 ^ d4, 39);
+        b43 = KECCAK_ROL(a30 ^ d0, 41);
+        b44 = KECCAK_ROL(a41 ^ d1, 2);
+
+        /* Chi */
+        a00 = b00 ^ (~b01 & b02);
+        a01 = b01 ^ (~b02 & b03);
+        a02 = b02 ^ (~b03 & b04);
+        a03 = b03 ^ (~b04 & b00);
+        a04 = b04 ^ (~b00 & b01);
+        a10 = b10 ^ (~b11 & b12);
+        a11 = b11 ^ (~b12 & b13);
+        a12 = b12 ^ (~b13 & b14);
+        a13 = b13 ^ (~b14 & b10);
+        a14 = b14 ^ (~b10 & b11);
+        a20 = b20 ^ (~b21 & b22);
+        a21 = b21 ^ (~b22 & b23);
+        a22 = b22 ^ (~b23 & b24);
+        a23 = b23 ^ (~b24 & b20);
+        a24 = b24 ^ (~b20 & b21);
+        a30 = b30 ^ (~b31 & b32);
+        a31 = b31 ^ (~b32 & b33);
+        a32 = b32 ^ (~b33 & b34);
+        a33 = b33 ^ (~b34 & b30);
+        a34 = b34 ^ (~b30 & b31);
+        a40 = b40 ^ (~b41 & b42);
+        a41 = b41 ^ (~b42 & b43);
+        a42 = b42 ^ (~b43 & b44);
+        a43 = b43 ^ (~b44 & b40);
+        a44 = b44 ^ (~b40 & b41);
+
+        /* Iota */
+        a00 ^= l_KeccakRc[round];
+    }
+
+    state[0] = a00;  state[1] = a01;  state[2] = a02;  state[3] = a03;  state[4] = a04;
+    state[5] = a10;  state[6] = a11;  state[7] = a12;  state[8] = a13;  state[9] = a14;
+    state[10] = a20; state[11] = a21; state[12] = a22; state[13] = a23; state[14] = a24;
+    state[15] = a30; state[16] = a31; state[17] = a32; state[18] = a33; state[19] = a34;
+    state[20] = a40; state[21] = a41; state[22] = a42; state[23] = a43; state[24] = a44;
+}
+
+
+
+/* Lanes are little endian, whatever the CPU */
+static uint64_t l_Keccak_Load64(const uint8_t* p)
+{
+    return (uint64_t)p[0] | ((uint64_t)p[1] << 8) | ((uint64_t)p[2] << 16) |
+           ((uint64_t)p[3] << 24) | ((uint64_t)p[4] << 32) | ((uint64_t)p[5] << 40) |
+           ((uint64_t)p[6] << 48) | ((uint64_t)p[7] << 56);
+}
+
+
+
+
+/*
+ *******************************************************************************
+ *                               FUNCTIONS IMPLEMENT
+ *******************************************************************************
+*/
+void g_Keccak_Init(ST_KECCAK* pCtx, uint32_t rate, uint8_t dsByte)
+{
+    memset(pCtx->State, 0, sizeof(pCtx->State));
+    pCtx->Rate = rate;
+    pCtx->Pos = 0U;
+    pCtx->DsByte = dsByte;
+    pCtx->Squeezing = 0U;
+}
+
+
+
+void g_Keccak_Absorb(ST_KECCAK* pCtx, const void* input, uint32_t len)
+{
+    const uint8_t* l_pIn = input;
+    uint32_t index = 0U;
+
+    /**1) Complete the block in progress byte by byte */
+    while((0U != len) && (0U != pCtx->Pos))
+    {
+        pCtx->State[pCtx->Pos / 8U] ^= (uint64_t)*l_pIn++ << (8U * (pCtx->Pos % 8U));
+        len--;
+        if(++pCtx->Pos == pCtx->Rate)
+        {
+            l_Keccak_Permute(pCtx->State);
+            pCtx->Pos = 0U;
+        }
+    }
+    if(0U == len)
+    {
+        return;
+    }
+
+    /**2) Whole blocks, a lane at a time */
+    while(len >= pCtx->Rate)
+    {
+        for(index = 0U; index < pCtx->Rate / 8U; index++)
+        {
+            pCtx->State[index] ^= l_Keccak_Load64(l_pIn + 8U * index);
+        }
+        l_Keccak_Permute(pCtx->State);
+        l_pIn += pCtx->Rate;
+        len -= pCtx->Rate;
+    }
+
+    /**3) Start the next block with the rest */
+    for(index = 0U; index < len; index++)
+    {
+        pCtx->State[index / 8U] ^= (uint64_t)l_pIn[index] << (8U * (index % 8U));
+    }
+    pCtx->Pos = len;
+}
+
+
+
+void g_Keccak_Squeeze(ST_KECCAK* pCtx, void* output, uint32_t len)
+{
+    uint8_t* l_pOut = output;
+
+    /**1) Pad the last block: domain bits, then the final bit of pad10*1 */
+    if(0U == pCtx->Squeezing)
+    {
+        pCtx->State[pCtx->Pos / 8U] ^= (uint64_t)pCtx->DsByte << (8U * (pCtx->Pos % 8U));
+        pCtx->State[(pCtx->Rate - 1U) / 8U] ^= 0x80ULL << (8U * ((pCtx->Rate - 1U) % 8U));
+        l_Keccak_Permute(pCtx->State);
+        pCtx->Pos = 0U;
+        pCtx->Squeezing = 1U;
+    }
+
+    /**2) Output the rate part of the state, permuting between blocks */
+    while(0U != len)
+    {
+        if(pCtx->Pos == pCtx->Rate)
+        {
+            l_Keccak_Permute(pCtx->State);
+            pCtx->Pos = 0U;
+        }
+        *l_pOut++ = (uint8_t)(pCtx->State[pCtx->Pos / 8U] >> (8U * (pCtx->Pos % 8U)));
+        pCtx->Pos++;
+        len--;
+    }
+}
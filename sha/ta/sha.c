@@ -67,12 +67,22 @@ TEE_Result TA_OpenSessionEntryPoint(uint32_t param_types,
 						   TEE_PARAM_TYPE_NONE,
 						   TEE_PARAM_TYPE_NONE,
 						   TEE_PARAM_TYPE_NONE);
+	ST_SHA_SESSION *session;
+
 	if (param_types != exp_param_types)
 		return TEE_ERROR_BAD_PARAMETERS;
 
 	/* Unused parameters */
 	(void)&params;
-	(void)&sess_ctx;
+
+	/* Context of the hash sequences of the session */
+	session = TEE_Malloc(sizeof(*session), 0);
+	if (!session)
+		return TEE_ERROR_OUT_OF_MEMORY;
+	session->Digest.pAlgo = NULL;
+	session->Digest.OperationHandle = TEE_HANDLE_NULL;
+	session->pMerkle = NULL;
+	*sess_ctx = session;
 
 	/*
 	 * The DMSG() macro is non-standard, TEE Internal API doesn't
@@ -88,9 +98,9 @@ TEE_Result TA_OpenSessionEntryPoint(uint32_t param_types,
  * Called when a session is closed, sess_ctx hold the value that was
  * assigned by TA_OpenSessionEntryPoint().
  */
-void TA_CloseSessionEntryPoint(void __maybe_unused *sess_ctx)
+void TA_CloseSessionEntryPoint(void *sess_ctx)
 {
-	(void)&sess_ctx; /* Unused parameter */
+	g_CryptoTaHandle_CloseSession(sess_ctx);
 	DMSG("Goodbye!\n");
 }
 
@@ -117,13 +127,12 @@ static TEE_Result inc_value(uint32_t param_types,
  * assigned by TA_OpenSessionEntryPoint(). The rest of the paramters
  * comes from normal world.
  */
-TEE_Result TA_InvokeCommandEntryPoint(void __maybe_unused *sess_ctx,
+TEE_Result TA_InvokeCommandEntryPoint(void *sess_ctx,
 			uint32_t cmd_id,
 			uint32_t param_types, TEE_Param params[4])
 {
     TEE_Result l_ret = TEE_SUCCESS;
     int l_RetVal = -1;
-	(void)&sess_ctx; /* Unused parameter */
 
 	switch (cmd_id)
     {
@@ -135,16 +144,53 @@ TEE_Result TA_InvokeCommandEntryPoint(void __maybe_unused *sess_ctx,
 	case TA_SHA_CMD_RANDOM:
         l_RetVal = g_CryptoTaHandle_Random(param_types, params);
 		break;
+	case TA_SHA_CMD_HASH_INIT:
+        l_RetVal = g_CryptoTaHandle_HashInit(sess_ctx, param_types, params);
+		break;
+	case TA_SHA_CMD_HASH_UPDATE:
+        l_RetVal = g_CryptoTaHandle_HashUpdate(sess_ctx, param_types, params);
+		break;
+	case TA_SHA_CMD_HASH_FINAL:
+        l_RetVal = g_CryptoTaHandle_HashFinal(sess_ctx, param_types, params);
+		break;
+	case TA_SHA_CMD_HASH_EXPORT:
+        l_RetVal = g_CryptoTaHandle_HashExport(sess_ctx, param_types, params);
+		break;
+	case TA_SHA_CMD_HASH_IMPORT:
+        l_RetVal = g_CryptoTaHandle_HashImport(sess_ctx, param_types, params);
+		break;
+	case TA_SHA_CMD_HASH_BATCH:
+        l_RetVal = g_CryptoTaHandle_HashBatch(param_types, params);
+		break;
+	case TA_SHA_CMD_MERKLE:
+        l_RetVal = g_CryptoTaHandle_Merkle(param_types, params);
+		break;
+	case TA_SHA_CMD_MERKLE_INIT:
+        l_RetVal = g_CryptoTaHandle_MerkleInit(sess_ctx, param_types, params);
+		break;
+	case TA_SHA_CMD_MERKLE_UPDATE:
+        l_RetVal = g_CryptoTaHandle_MerkleUpdate(sess_ctx, param_types, params);
+		break;
+	case TA_SHA_CMD_MERKLE_FINAL:
+        l_RetVal = g_CryptoTaHandle_MerkleFinal(sess_ctx, param_types, params);
+		break;
 	default:
 		return TEE_ERROR_BAD_PARAMETERS;
 	}
-    if(-1 == l_RetVal)
-    {
-        l_ret = TEE_ERROR_BAD_PARAMETERS;
-    }
-    else
+    switch(l_RetVal)
     {
+    case OK:
         l_ret = TEE_SUCCESS;
+        break;
+    case FAIL_SHORT_BUFFER:
+        l_ret = TEE_ERROR_SHORT_BUFFER;
+        break;
+    case FAIL_MAC_INVALID:
+        l_ret = TEE_ERROR_MAC_INVALID;
+        break;
+    default:
+        l_ret = TEE_ERROR_BAD_PARAMETERS;
+        break;
     }
 
     return l_ret;
@@ -79,6 +79,14 @@
  *                          VARIABLES USED ONLY BY THIS MODULE
  *******************************************************************************
 */
+#ifdef CFG_SHA_TRACE
+/* Scratch area of g_TA_printf: two digits per byte, "..", terminator */
+static CHAR l_TraceScratch[2U * SHA_TRACE_HEX_MAX + 3U];
+#endif
+
+/* Key sealing the exported sequence states, opened on first use */
+static TEE_ObjectHandle l_StateKey = TEE_HANDLE_NULL;
+static const CHAR l_StateKeyId[] = "sha_state_key";
 
 
 
@@ -90,26 +98,255 @@
  *******************************************************************************
 */
 
-void g_TA_printf(CHAR* buf, UINT32 len)
+#ifdef CFG_SHA_TRACE
+/*
+ * Format up to SHA_TRACE_HEX_MAX bytes of the buffer in the scratch area and
+ * emit them as a single trace line.
+ */
+void g_TA_printf(const CHAR* buf, UINT32 len)
 {
+    static const CHAR l_Hex[] = "0123456789abcdef";
+    UINT32 l_Count = (len < SHA_TRACE_HEX_MAX) ? len : SHA_TRACE_HEX_MAX;
     UINT32 index = 0U;
-    for(index =0U; index < len; index++)
+    CHAR* l_pPos = l_TraceScratch;
+
+    for(index = 0U; index < l_Count; index++)
     {
-        if(index < 15U)
-        {
+        *l_pPos++ = l_Hex[(buf[index] >> 4) & 0x0FU];
+        *l_pPos++ = l_Hex[buf[index] & 0x0FU];
+    }
+    if(l_Count < len)
+    {
+        *l_pPos++ = '.';
+        *l_pPos++ = '.';
+    }
+    *l_pPos = '\0';
 
-        }
-        else if(0U == index%16U)
+    DMSG("[0x%x] %s\n", len, l_TraceScratch);
+}
+#endif
+
+
+
+/** @ingroup MOUDLE_NAME_C_
+ *- #Description  Get the algorithm table entry of a sha mode.
+ * @param   shaMode        [IN] The requested sha mode
+ *
+ * @return     const ST_SHA_ALGO*
+ * @retval     NULL for an unknown sha mode
+ *
+ *
+ */
+static const ST_SHA_ALGO* l_CryptoTaHash_GetAlgo(UINT32 shaMode)
+{
+    const ST_SHA_ALGO* l_pAlgo = g_ShaAlgo_Get(shaMode);
+
+    if(NULL == l_pAlgo)
+    {
+        DMSG("Invalid sha mode\n");
+    }
+    return l_pAlgo;
+}
+
+
+
+/** @ingroup MOUDLE_NAME_C_
+ *- #Description  Bytes of digest to output in a buffer: its size for a XOF,
+ *                the digest size otherwise or when the buffer is empty.
+ * @param   pAlgo          [IN] The algorithm
+ * @param   bufSize        [IN] Size of the output buffer
+ *
+ * @return     UINT32
+ * @retval     Bytes of digest to output
+ *
+ *
+ */
+static UINT32 l_CryptoTaHash_OutSize(const ST_SHA_ALGO* pAlgo, UINT32 bufSize)
+{
+    if((0U != (pAlgo->Flags & SHA_ALGO_F_XOF)) && (0U != bufSize))
+    {
+        return bufSize;
+    }
+    return pAlgo->DigestSize;
+}
+
+
+
+/** @ingroup MOUDLE_NAME_C_
+ *- #Description  Put a digest back to its initial state.
+ * @param   pDigest        [IN] The digest
+ *
+ * @return     void
+ * @retval     void
+ *
+ *
+ */
+static void l_CryptoTaDigest_Reset(ST_SHA_DIGEST* pDigest)
+{
+    switch(pDigest->Backend)
+    {
+        case EN_DIGEST_TEE:
+            TEE_ResetOperation(pDigest->OperationHandle);
+            break;
+        case EN_DIGEST_KECCAK:
+            g_Keccak_Init(&pDigest->State.Keccak, pDigest->pAlgo->BlockSize,
+                          (0U != (pDigest->pAlgo->Flags & SHA_ALGO_F_XOF)) ?
+                          KECCAK_DS_SHAKE : KECCAK_DS_SHA3);
+            break;
+        default:
+            (void)g_ShaSoft_Init(&pDigest->State.Soft, pDigest->pAlgo->Mode);
+            break;
+    }
+}
+
+
+
+/** @ingroup MOUDLE_NAME_C_
+ *- #Description  Set up a digest of an algorithm. The SHA-3 functions are
+ *                asked to the TEE core first and use the Keccak sponge of
+ *                the TA when it does not support them; SHAKE always does as
+ *                a GP digest has a fixed output length. An exportable
+ *                digest is always hashed by the TA, whose state can be read.
+ * @param   pDigest        [IN] The digest, unused
+ * @param   pAlgo          [IN] The algorithm
+ * @param   exportable     [IN] 1 when the state shall be exported
+ *
+ * @return     int
+ * @retval     OK / FAIL
+ *
+ *
+ */
+static int l_CryptoTaDigest_Alloc(ST_SHA_DIGEST* pDigest, const ST_SHA_ALGO* pAlgo, UINT32 exportable)
+{
+    TEE_Result ret = TEE_ERROR_NOT_SUPPORTED;
+
+    /**1) Allocate the operation of the TEE core */
+    pDigest->OperationHandle = TEE_HANDLE_NULL;
+    if((0U == exportable) && (0U == (pAlgo->Flags & SHA_ALGO_F_XOF)))
+    {
+        ret = TEE_AllocateOperation(&pDigest->OperationHandle, pAlgo->AlgorithmId,
+                                    TEE_MODE_DIGEST, 0);
+    }
+
+    /**2) Else fall back on the code of the TA */
+    if(ret == TEE_SUCCESS)
+    {
+        pDigest->Backend = EN_DIGEST_TEE;
+    }
+    else
+    {
+        pDigest->OperationHandle = TEE_HANDLE_NULL;
+        if(TEE_ERROR_NOT_SUPPORTED != ret)
         {
-            DMSG("\n");
+            DMSG("Allocate SHA operation handle fail\n");
+            return FAIL;
         }
-        else
-        {
+        pDigest->Backend = (0U != (pAlgo->Flags & SHA_ALGO_F_KECCAK)) ?
+                           EN_DIGEST_KECCAK : EN_DIGEST_SOFT;
+        SHA_TRACE("%s hashed by the TA\n", pAlgo->Name);
+    }
 
-        }
-        DMSG("0x%02x, ", (buf[index] & 0xFFU));
+    pDigest->pAlgo = pAlgo;
+    pDigest->Exportable = exportable;
+    l_CryptoTaDigest_Reset(pDigest);
+
+    return OK;
+}
+
+
+
+/** @ingroup MOUDLE_NAME_C_
+ *- #Description  Release a digest, it can be set up again.
+ * @param   pDigest        [IN] The digest, may be unused
+ *
+ * @return     void
+ * @retval     void
+ *
+ *
+ */
+static void l_CryptoTaDigest_Free(ST_SHA_DIGEST* pDigest)
+{
+    if(TEE_HANDLE_NULL != pDigest->OperationHandle)
+    {
+        TEE_FreeOperation(pDigest->OperationHandle);
+        pDigest->OperationHandle = TEE_HANDLE_NULL;
+    }
+    pDigest->pAlgo = NULL;
+}
+
+
+
+/** @ingroup MOUDLE_NAME_C_
+ *- #Description  Add data to a digest.
+ * @param   pDigest        [IN] The digest
+ * @param   input          [IN] The data
+ * @param   inLen          [IN] Length of the data
+ *
+ * @return     void
+ * @retval     void
+ *
+ *
+ */
+static void l_CryptoTaDigest_Update(ST_SHA_DIGEST* pDigest, const void* input, UINT32 inLen)
+{
+    switch(pDigest->Backend)
+    {
+        case EN_DIGEST_TEE:
+            TEE_DigestUpdate(pDigest->OperationHandle, input, inLen);
+            break;
+        case EN_DIGEST_KECCAK:
+            g_Keccak_Absorb(&pDigest->State.Keccak, input, inLen);
+            break;
+        default:
+            g_ShaSoft_Update(&pDigest->State.Soft, input, inLen);
+            break;
+    }
+}
+
+
+
+/** @ingroup MOUDLE_NAME_C_
+ *- #Description  Add the last data and get the digest, which is then back
+ *                to its initial state as with TEE_DigestDoFinal.
+ * @param   pDigest        [IN] The digest
+ * @param   input          [IN] Last data, may be NULL when inLen is 0
+ * @param   inLen          [IN] Length of the data
+ *         output         [OUT] The digest
+ *         pOutLen     [IN/OUT] Bytes to output, see l_CryptoTaHash_OutSize
+ *
+ * @return     int
+ * @retval     OK / FAIL
+ *
+ *
+ */
+static int l_CryptoTaDigest_Final(ST_SHA_DIGEST* pDigest, const void* input, UINT32 inLen,
+                                  void* output, UINT32* pOutLen)
+{
+    TEE_Result ret;
+
+    switch(pDigest->Backend)
+    {
+        case EN_DIGEST_TEE:
+            ret = TEE_DigestDoFinal(pDigest->OperationHandle, input, inLen, output, pOutLen);
+            if(ret != TEE_SUCCESS)
+            {
+                DMSG("Do the final sha operation fail: 0x%x\n", ret);
+                return FAIL;
+            }
+            break;
+        case EN_DIGEST_KECCAK:
+            g_Keccak_Absorb(&pDigest->State.Keccak, input, inLen);
+            g_Keccak_Squeeze(&pDigest->State.Keccak, output, *pOutLen);
+            l_CryptoTaDigest_Reset(pDigest);
+            break;
+        default:
+            g_ShaSoft_Update(&pDigest->State.Soft, input, inLen);
+            g_ShaSoft_Final(&pDigest->State.Soft, output);
+            *pOutLen = pDigest->pAlgo->DigestSize;
+            break;
     }
-    DMSG("\n\n");
+
+    return OK;
 }
 
 
@@ -127,74 +364,62 @@ void g_TA_printf(CHAR* buf, UINT32 len)
  */
 static int l_CryptoTaHash_sha(EN_SHA_MODE shaMode, CHAR* input, UINT32 inLen, CHAR* output, UINT32* pOutLen)
 {
-    TEE_Result ret;
-    TEE_OperationHandle l_OperationHandle;
-    TEE_CRYPTO_ALGORITHM_ID l_AlgorithmId;
+    ST_SHA_DIGEST l_Digest;
+    const ST_SHA_ALGO* l_pAlgo;
+    UINT32 l_OutLen = 0U;
     int l_RetVal = OK;
 
-    DMSG("Input data just like follow(0x%x), 0x%x:\n", inLen, (UINT32)(output));
-    //g_TA_Printf(input, 20);
+    SHA_TRACE("Input data just like follow(0x%x):\n", inLen);
+    SHA_TRACE_HEX(input, inLen);
 
     /**1) Set the algorithm variable */
-    switch(shaMode)
+    l_pAlgo = l_CryptoTaHash_GetAlgo(shaMode);
+    if(NULL == l_pAlgo)
     {
-        case EN_OP_SHA1:
-            DMSG("The md is sha1@!!!!\n");
-            l_AlgorithmId = TEE_ALG_SHA1;
-            break;
-        case EN_OP_SHA256:
-            l_AlgorithmId = TEE_ALG_SHA256;
-            break;
-        case EN_OP_SHA384:
-            l_AlgorithmId = TEE_ALG_SHA384;
-            break;
-        case EN_OP_SHA512:
-            l_AlgorithmId = TEE_ALG_SHA512;
-            break;
-        default:
-            l_AlgorithmId = TEE_ALG_INVALID ;
-            l_RetVal = FAIL;
-            goto cleanup_1;
-            DMSG("Invalid sha mode\n");
-            break;
+        l_RetVal = FAIL;
+        goto cleanup_1;
     }
 
-    /**2) Allocate the operation handle */
-    ret = TEE_AllocateOperation(&l_OperationHandle, l_AlgorithmId, TEE_MODE_DIGEST, 0);
-    if(ret != TEE_SUCCESS)
+    /**2) Check the output size before doing any work */
+    l_OutLen = l_CryptoTaHash_OutSize(l_pAlgo, *pOutLen);
+    if(*pOutLen < l_OutLen)
+    {
+        *pOutLen = l_OutLen;
+        l_RetVal = FAIL_SHORT_BUFFER;
+        goto cleanup_1;
+    }
+    *pOutLen = l_OutLen;
+
+    /**3) Allocate the operation handle */
+    if(OK != l_CryptoTaDigest_Alloc(&l_Digest, l_pAlgo, 0U))
     {
-        DMSG("Allocate SHA operation handle fail\n");
         l_RetVal = FAIL;
         goto cleanup_1;
     }
 
-    TEE_DigestUpdate(l_OperationHandle, input, inLen);
+    l_CryptoTaDigest_Update(&l_Digest, input, inLen);
 
     /**4) Do the final sha operation */
-    ret = TEE_DigestDoFinal(l_OperationHandle, NULL, 0, output, pOutLen);
-    DMSG("The out put length is :%d\n", *pOutLen);
-    DMSG("The return value is :0x%x\n", ret);
-    //ret = TEE_DigestDoFinal(l_OperationHandle, l_pInputTmp, inLen, output, pOutLen);
-    if(ret != TEE_SUCCESS)
+    l_RetVal = l_CryptoTaDigest_Final(&l_Digest, NULL, 0U, output, pOutLen);
+    SHA_TRACE("The out put length is :%d\n", *pOutLen);
+    if(OK != l_RetVal)
     {
-        DMSG("Do the final sha operation fail\n");
-        l_RetVal = FAIL;
         goto cleanup_2;
     }
 
-    DMSG("Hash value just like folloe:\n");
-    g_TA_printf(output, *pOutLen);
+    SHA_TRACE("Hash value just like follow:\n");
+    SHA_TRACE_HEX(output, *pOutLen);
 
     /**5) Do the clean up operation& return the result */
     cleanup_2:
-        TEE_FreeOperation(l_OperationHandle);
+        l_CryptoTaDigest_Free(&l_Digest);
     cleanup_1:
         return l_RetVal;
 }
 
 static void l_CryptoTaOther_Random(UINT32 len, CHAR* output)
 {
-    DMSG("Entry random\n");
+    SHA_TRACE("Entry random\n");
     TEE_GenerateRandom(output, len);
 }
 
@@ -211,10 +436,10 @@ int g_CryptoTaHandle_Sha(uint32_t paramTypes, TEE_Param params[4])
     CHAR* l_OutPut = NULL;
     UINT32 l_InputLen = 0U;
     UINT32 l_OutputLen = 0U;
-    uint32_t temp;
-    temp = paramTypes;
+    int l_RetVal = OK;
 
-    DMSG("%d\n", temp);
+    (void)paramTypes;
+    SHA_TRACE("Param types 0x%x\n", paramTypes);
 
     /**1) Get the sha mode, input data info & output info */
     l_InputData = params[0].memref.buffer;
@@ -223,10 +448,11 @@ int g_CryptoTaHandle_Sha(uint32_t paramTypes, TEE_Param params[4])
     l_OutPut = params[2].memref.buffer;
     l_OutputLen = params[2].memref.size;
 
-    /**2) Do sha operation */
-    l_CryptoTaHash_sha(l_shaMode, l_InputData, l_InputLen, l_OutPut, &l_OutputLen);
+    /**2) Do sha operation, the output size is the digest or the required size */
+    l_RetVal = l_CryptoTaHash_sha(l_shaMode, l_InputData, l_InputLen, l_OutPut, &l_OutputLen);
+    params[2].memref.size = l_OutputLen;
 
-    return OK;
+    return l_RetVal;
 }
 
 
@@ -235,10 +461,9 @@ int g_CryptoTaHandle_Random(uint32_t paramTypes, TEE_Param params[4])
 {
     UINT32 l_RandomLen = 0U;
     CHAR* l_pBuf = NULL;
-    uint32_t temp;
-    temp = paramTypes;
 
-    DMSG("%d\n", temp);
+    (void)paramTypes;
+    SHA_TRACE("Param types 0x%x\n", paramTypes);
 
     /**1) Get the request length & point of responding buffer */
     l_RandomLen = params[0].memref.size;
@@ -252,6 +477,1053 @@ int g_CryptoTaHandle_Random(uint32_t paramTypes, TEE_Param params[4])
 
 
 
+/** @ingroup MOUDLE_NAME_C_
+ *- #Description  Start a hash sequence in the session. The digest operation
+ *                of the previous sequence is reset and reused when the
+ *                algorithm is the same.
+ * @param   pSession       [IN] The session context
+ * @param   params         [IN] param[0].value.a: EN_SHA_MODE,
+ *                               b: SHA_SEQ_F_xxx
+ *
+ * @return     int
+ * @retval     OK / FAIL
+ *
+ *
+ */
+int g_CryptoTaHandle_HashInit(ST_SHA_SESSION* pSession, uint32_t paramTypes, TEE_Param params[4])
+{
+    const ST_SHA_ALGO* l_pAlgo;
+    UINT32 l_Exportable = 0U;
+
+    if(TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT, TEE_PARAM_TYPE_NONE,
+                       TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_NONE) != paramTypes)
+    {
+        return FAIL;
+    }
+
+    /**1) Get the algorithm of the sequence */
+    l_pAlgo = l_CryptoTaHash_GetAlgo(params[0].value.a);
+    if(NULL == l_pAlgo)
+    {
+        return FAIL;
+    }
+
+    /**2) Reuse the operation of the previous sequence if possible */
+    l_Exportable = (0U != (params[0].value.b & SHA_SEQ_F_EXPORTABLE)) ? 1U : 0U;
+    if((l_pAlgo == pSession->Digest.pAlgo) && (l_Exportable == pSession->Digest.Exportable))
+    {
+        l_CryptoTaDigest_Reset(&pSession->Digest);
+    }
+    else
+    {
+        l_CryptoTaDigest_Free(&pSession->Digest);
+        if(OK != l_CryptoTaDigest_Alloc(&pSession->Digest, l_pAlgo, l_Exportable))
+        {
+            pSession->SeqActive = 0U;
+            return FAIL;
+        }
+    }
+
+    pSession->SeqActive = 1U;
+
+    return OK;
+}
+
+
+
+/** @ingroup MOUDLE_NAME_C_
+ *- #Description  Add a chunk of data to the session hash sequence.
+ * @param   pSession       [IN] The session context
+ * @param   params         [IN] param[0].memref: input data
+ *
+ * @return     int
+ * @retval     OK / FAIL
+ *
+ *
+ */
+int g_CryptoTaHandle_HashUpdate(ST_SHA_SESSION* pSession, uint32_t paramTypes, TEE_Param params[4])
+{
+    if(TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT, TEE_PARAM_TYPE_NONE,
+                       TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_NONE) != paramTypes)
+    {
+        return FAIL;
+    }
+
+    if(1U != pSession->SeqActive)
+    {
+        DMSG("No hash sequence started\n");
+        return FAIL;
+    }
+
+    l_CryptoTaDigest_Update(&pSession->Digest, params[0].memref.buffer, params[0].memref.size);
+
+    return OK;
+}
+
+
+
+/** @ingroup MOUDLE_NAME_C_
+ *- #Description  Add the last chunk of data and get the digest of the
+ *                session hash sequence.
+ * @param   pSession       [IN] The session context
+ * @param   params         [IN] param[0].memref: last input data
+ *                         [OUT] param[1].memref: digest, size updated
+ *
+ * @return     int
+ * @retval     OK / FAIL
+ *
+ *
+ */
+int g_CryptoTaHandle_HashFinal(ST_SHA_SESSION* pSession, uint32_t paramTypes, TEE_Param params[4])
+{
+    UINT32 l_OutLen = 0U;
+
+    if(TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT, TEE_PARAM_TYPE_MEMREF_OUTPUT,
+                       TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_NONE) != paramTypes)
+    {
+        return FAIL;
+    }
+
+    if(1U != pSession->SeqActive)
+    {
+        DMSG("No hash sequence started\n");
+        return FAIL;
+    }
+
+    /* A too short output buffer keeps the sequence going */
+    l_OutLen = l_CryptoTaHash_OutSize(pSession->Digest.pAlgo, params[1].memref.size);
+    if(params[1].memref.size < l_OutLen)
+    {
+        params[1].memref.size = l_OutLen;
+        return FAIL_SHORT_BUFFER;
+    }
+
+    params[1].memref.size = l_OutLen;
+    if(OK != l_CryptoTaDigest_Final(&pSession->Digest, params[0].memref.buffer,
+                                    params[0].memref.size, params[1].memref.buffer,
+                                    &params[1].memref.size))
+    {
+        return FAIL;
+    }
+
+    pSession->SeqActive = 0U;
+
+    return OK;
+}
+
+
+
+/** @ingroup MOUDLE_NAME_C_
+ *- #Description  Get the key sealing the exported sequence states. It is
+ *                generated once and kept in the secure storage of the TA, so
+ *                that states outlive the TA instance. The TA is multi-instance:
+ *                the key is copied in a transient object and the persistent
+ *                object closed at once, so that other instances can open it.
+ *
+ * @return     TEE_ObjectHandle
+ * @retval     TEE_HANDLE_NULL when the key cannot be opened or created
+ *
+ *
+ */
+static TEE_ObjectHandle l_CryptoTaState_GetKey(void)
+{
+    const UINT32 l_Flags = TEE_DATA_FLAG_ACCESS_READ | TEE_DATA_FLAG_SHARE_READ;
+    TEE_ObjectHandle l_Persistent = TEE_HANDLE_NULL;
+    TEE_ObjectHandle l_Transient = TEE_HANDLE_NULL;
+    TEE_Result ret;
+
+    if(TEE_HANDLE_NULL != l_StateKey)
+    {
+        return l_StateKey;
+    }
+
+    /**1) Open the key of a previous instance */
+    ret = TEE_OpenPersistentObject(TEE_STORAGE_PRIVATE, l_StateKeyId, sizeof(l_StateKeyId),
+                                   l_Flags, &l_Persistent);
+
+    /**2) Else generate it & store it, the generated object is then the key */
+    if(TEE_ERROR_ITEM_NOT_FOUND == ret)
+    {
+        ret = TEE_AllocateTransientObject(TEE_TYPE_AES, SHA_STATE_KEY_BITS, &l_Transient);
+        if(ret == TEE_SUCCESS)
+        {
+            ret = TEE_GenerateKey(l_Transient, SHA_STATE_KEY_BITS, NULL, 0U);
+        }
+        if(ret == TEE_SUCCESS)
+        {
+            ret = TEE_CreatePersistentObject(TEE_STORAGE_PRIVATE, l_StateKeyId, sizeof(l_StateKeyId),
+                                             l_Flags, l_Transient, NULL, 0U, NULL);
+        }
+        if(ret == TEE_SUCCESS)
+        {
+            l_StateKey = l_Transient;
+            return l_StateKey;
+        }
+        TEE_FreeTransientObject(l_Transient);
+        l_Transient = TEE_HANDLE_NULL;
+
+        /* Another instance stored it first: use that one */
+        if(TEE_ERROR_ACCESS_CONFLICT == ret)
+        {
+            ret = TEE_OpenPersistentObject(TEE_STORAGE_PRIVATE, l_StateKeyId, sizeof(l_StateKeyId),
+                                           l_Flags, &l_Persistent);
+        }
+    }
+
+    /**3) Copy the stored key & close the object */
+    if(ret == TEE_SUCCESS)
+    {
+        ret = TEE_AllocateTransientObject(TEE_TYPE_AES, SHA_STATE_KEY_BITS, &l_Transient);
+        if(ret == TEE_SUCCESS)
+        {
+            ret = TEE_CopyObjectAttributes1(l_Transient, l_Persistent);
+        }
+        TEE_CloseObject(l_Persistent);
+    }
+
+    if(ret != TEE_SUCCESS)
+    {
+        DMSG("Open the state key fail: 0x%x\n", ret);
+        TEE_FreeTransientObject(l_Transient);
+        return TEE_HANDLE_NULL;
+    }
+
+    l_StateKey = l_Transient;
+    return l_StateKey;
+}
+
+
+
+/** @ingroup MOUDLE_NAME_C_
+ *- #Description  Encrypt or decrypt a sequence state with AES-256-GCM. The
+ *                header up to the nonce is authenticated along.
+ * @param   mode           [IN] TEE_MODE_ENCRYPT, sets the tag of the header,
+ *                              or TEE_MODE_DECRYPT, checks it
+ * @param   pHeader        [IN] The header of the blob
+ * @param   input          [IN] StateSize bytes to encrypt or decrypt
+ *         output         [OUT] StateSize bytes
+ *
+ * @return     int
+ * @retval     OK / FAIL / FAIL_MAC_INVALID
+ *
+ *
+ */
+static int l_CryptoTaState_Crypt(UINT32 mode, ST_SHA_STATE_HEADER* pHeader, const void* input,
+                                 void* output)
+{
+    TEE_OperationHandle l_OperationHandle = TEE_HANDLE_NULL;
+    TEE_ObjectHandle l_Key;
+    UINT32 l_OutLen = pHeader->StateSize;
+    UINT32 l_TagLen = SHA_STATE_TAG_SIZE;
+    TEE_Result ret;
+
+    /**1) Key the AE operation */
+    l_Key = l_CryptoTaState_GetKey();
+    if(TEE_HANDLE_NULL == l_Key)
+    {
+        return FAIL;
+    }
+    ret = TEE_AllocateOperation(&l_OperationHandle, TEE_ALG_AES_GCM, mode, SHA_STATE_KEY_BITS);
+    if(ret == TEE_SUCCESS)
+    {
+        ret = TEE_SetOperationKey(l_OperationHandle, l_Key);
+    }
+    if(ret == TEE_SUCCESS)
+    {
+        ret = TEE_AEInit(l_OperationHandle, pHeader->Nonce, SHA_STATE_NONCE_SIZE,
+                         8U * SHA_STATE_TAG_SIZE, offsetof(ST_SHA_STATE_HEADER, Nonce),
+                         pHeader->StateSize);
+    }
+
+    /**2) Authenticate the header, cipher the state */
+    if(ret == TEE_SUCCESS)
+    {
+        TEE_AEUpdateAAD(l_OperationHandle, pHeader, offsetof(ST_SHA_STATE_HEADER, Nonce));
+        if(TEE_MODE_ENCRYPT == mode)
+        {
+            ret = TEE_AEEncryptFinal(l_OperationHandle, input, pHeader->StateSize, output,
+                                     &l_OutLen, pHeader->Tag, &l_TagLen);
+        }
+        else
+        {
+            ret = TEE_AEDecryptFinal(l_OperationHandle, input, pHeader->StateSize, output,
+                                     &l_OutLen, pHeader->Tag, SHA_STATE_TAG_SIZE);
+        }
+    }
+
+    if(TEE_HANDLE_NULL != l_OperationHandle)
+    {
+        TEE_FreeOperation(l_OperationHandle);
+    }
+    if(ret != TEE_SUCCESS)
+    {
+        DMSG("Seal the sequence state fail: 0x%x\n", ret);
+        return (TEE_ERROR_MAC_INVALID == ret) ? FAIL_MAC_INVALID : FAIL;
+    }
+    return OK;
+}
+
+
+
+/** @ingroup MOUDLE_NAME_C_
+ *- #Description  Bytes of the state of a digest hashed by the TA.
+ * @param   backend        [IN] EN_DIGEST_KECCAK or EN_DIGEST_SOFT
+ *
+ * @return     UINT32
+ * @retval     0 for a digest of the TEE core, whose state cannot be read
+ *
+ *
+ */
+static UINT32 l_CryptoTaState_Size(UINT32 backend)
+{
+    switch(backend)
+    {
+        case EN_DIGEST_KECCAK:
+            return sizeof(ST_KECCAK);
+        case EN_DIGEST_SOFT:
+            return sizeof(ST_SHA_SOFT);
+        default:
+            return 0U;
+    }
+}
+
+
+
+/** @ingroup MOUDLE_NAME_C_
+ *- #Description  Seal the state of the session hash sequence into a blob,
+ *                the sequence goes on.
+ * @param   pSession       [IN] The session context
+ *                         [OUT] param[0].memref: blob, size updated
+ *
+ * @return     int
+ * @retval     OK / FAIL / FAIL_SHORT_BUFFER
+ *
+ *
+ */
+int g_CryptoTaHandle_HashExport(ST_SHA_SESSION* pSession, uint32_t paramTypes, TEE_Param params[4])
+{
+    ST_SHA_STATE_HEADER l_Header;
+    UINT8* l_pBlob = NULL;
+    int l_RetVal = OK;
+
+    if(TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_OUTPUT, TEE_PARAM_TYPE_NONE,
+                       TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_NONE) != paramTypes)
+    {
+        return FAIL;
+    }
+
+    /**1) Only the state of a digest hashed by the TA can be read */
+    if((1U != pSession->SeqActive) || (EN_DIGEST_TEE == pSession->Digest.Backend))
+    {
+        DMSG("No exportable hash sequence started\n");
+        return FAIL;
+    }
+
+    l_Header.Magic = SHA_STATE_MAGIC;
+    l_Header.Mode = pSession->Digest.pAlgo->Mode;
+    l_Header.Backend = pSession->Digest.Backend;
+    l_Header.StateSize = l_CryptoTaState_Size(pSession->Digest.Backend);
+    if(params[0].memref.size < sizeof(l_Header) + l_Header.StateSize)
+    {
+        params[0].memref.size = sizeof(l_Header) + l_Header.StateSize;
+        return FAIL_SHORT_BUFFER;
+    }
+
+    /**2) Encrypt the state behind the header, a fresh nonce per blob */
+    TEE_GenerateRandom(l_Header.Nonce, sizeof(l_Header.Nonce));
+    l_pBlob = params[0].memref.buffer;
+    l_RetVal = l_CryptoTaState_Crypt(TEE_MODE_ENCRYPT, &l_Header, &pSession->Digest.State,
+                                     l_pBlob + sizeof(l_Header));
+    if(OK != l_RetVal)
+    {
+        return l_RetVal;
+    }
+    TEE_MemMove(l_pBlob, &l_Header, sizeof(l_Header));
+    params[0].memref.size = sizeof(l_Header) + l_Header.StateSize;
+
+    return OK;
+}
+
+
+
+/** @ingroup MOUDLE_NAME_C_
+ *- #Description  Replace the session hash sequence with the one sealed in a
+ *                blob by HASH_EXPORT, in this session or another one.
+ * @param   pSession       [IN] The session context
+ * @param   params         [IN] param[0].memref: blob
+ *
+ * @return     int
+ * @retval     OK / FAIL / FAIL_MAC_INVALID
+ *
+ *
+ */
+int g_CryptoTaHandle_HashImport(ST_SHA_SESSION* pSession, uint32_t paramTypes, TEE_Param params[4])
+{
+    UINT8 l_Blob[SHA_STATE_BLOB_MAX_SIZE];
+    ST_SHA_STATE_HEADER l_Header;
+    ST_SHA_DIGEST l_Digest;
+    int l_RetVal = OK;
+
+    if(TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT, TEE_PARAM_TYPE_NONE,
+                       TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_NONE) != paramTypes)
+    {
+        return FAIL;
+    }
+
+    /**1) Copy the blob out of the memory shared with the REE, check the header */
+    if((params[0].memref.size < sizeof(l_Header)) || (params[0].memref.size > sizeof(l_Blob)))
+    {
+        return FAIL;
+    }
+    TEE_MemMove(l_Blob, params[0].memref.buffer, params[0].memref.size);
+    TEE_MemMove(&l_Header, l_Blob, sizeof(l_Header));
+
+    l_Digest.pAlgo = g_ShaAlgo_Get(l_Header.Mode);
+    if((SHA_STATE_MAGIC != l_Header.Magic) || (NULL == l_Digest.pAlgo) ||
+       (0U == l_CryptoTaState_Size(l_Header.Backend)) ||
+       (l_CryptoTaState_Size(l_Header.Backend) != l_Header.StateSize) ||
+       (params[0].memref.size != sizeof(l_Header) + l_Header.StateSize) ||
+       ((EN_DIGEST_KECCAK == l_Header.Backend) != (0U != (l_Digest.pAlgo->Flags & SHA_ALGO_F_KECCAK))))
+    {
+        DMSG("Bad sequence state blob\n");
+        return FAIL;
+    }
+
+    /**2) Decrypt the state, the blob shall be one of this TA */
+    l_RetVal = l_CryptoTaState_Crypt(TEE_MODE_DECRYPT, &l_Header, l_Blob + sizeof(l_Header),
+                                     &l_Digest.State);
+    if(OK != l_RetVal)
+    {
+        return l_RetVal;
+    }
+
+    /**3) It replaces the sequence of the session */
+    l_Digest.Backend = l_Header.Backend;
+    l_Digest.Exportable = 1U;
+    l_Digest.OperationHandle = TEE_HANDLE_NULL;
+    l_CryptoTaDigest_Free(&pSession->Digest);
+    pSession->Digest = l_Digest;
+    pSession->SeqActive = 1U;
+
+    return OK;
+}
+
+
+
+/** @ingroup MOUDLE_NAME_C_
+ *- #Description  Hash records of one input buffer with a single digest
+ *                operation, reset between records.
+ * @param   params         [IN] param[0].memref: input data
+ *                         [IN] param[1].memref: ST_SHA_BATCH_ENTRY array
+ *                         [IN] param[2].value.a: EN_SHA_MODE
+ *                         [OUT] param[3].memref: digests, size updated
+ *
+ * @return     int
+ * @retval     OK / FAIL
+ *
+ *
+ */
+int g_CryptoTaHandle_HashBatch(uint32_t paramTypes, TEE_Param params[4])
+{
+    ST_SHA_DIGEST l_Digest;
+    const ST_SHA_ALGO* l_pAlgo;
+    ST_SHA_BATCH_ENTRY l_Entry;
+    CHAR* l_InputData = NULL;
+    CHAR* l_OutPut = NULL;
+    UINT32 l_InputLen = 0U;
+    UINT32 l_Count = 0U;
+    UINT32 l_DigestLen = 0U;
+    UINT32 index = 0U;
+    int l_RetVal = OK;
+
+    if(TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT, TEE_PARAM_TYPE_MEMREF_INPUT,
+                       TEE_PARAM_TYPE_VALUE_INPUT, TEE_PARAM_TYPE_MEMREF_OUTPUT) != paramTypes)
+    {
+        return FAIL;
+    }
+
+    /**1) Get the input data, the records & the algorithm */
+    l_InputData = params[0].memref.buffer;
+    l_InputLen = params[0].memref.size;
+    if(0U != (params[1].memref.size % sizeof(ST_SHA_BATCH_ENTRY)))
+    {
+        DMSG("Bad batch entries size 0x%x\n", params[1].memref.size);
+        return FAIL;
+    }
+    l_Count = params[1].memref.size / sizeof(ST_SHA_BATCH_ENTRY);
+
+    l_pAlgo = l_CryptoTaHash_GetAlgo(params[2].value.a);
+    if(NULL == l_pAlgo)
+    {
+        return FAIL;
+    }
+
+    /**2) Check the output can hold all the digests */
+    if(params[3].memref.size / l_pAlgo->DigestSize < l_Count)
+    {
+        params[3].memref.size = l_Count * l_pAlgo->DigestSize;
+        return FAIL_SHORT_BUFFER;
+    }
+    l_OutPut = params[3].memref.buffer;
+
+    /**3) Allocate the only digest operation of the batch */
+    if(OK != l_CryptoTaDigest_Alloc(&l_Digest, l_pAlgo, 0U))
+    {
+        return FAIL;
+    }
+
+    /**4) Hash the records one after the other */
+    for(index = 0U; index < l_Count; index++)
+    {
+        /* Entries are copied: they live in memory shared with the REE */
+        TEE_MemMove(&l_Entry, (ST_SHA_BATCH_ENTRY*)params[1].memref.buffer + index,
+                    sizeof(l_Entry));
+        if((l_Entry.Offset > l_InputLen) || (l_Entry.Length > l_InputLen - l_Entry.Offset))
+        {
+            DMSG("Batch record 0x%x out of the input\n", index);
+            l_RetVal = FAIL;
+            goto cleanup_1;
+        }
+
+        if(0U != index)
+        {
+            l_CryptoTaDigest_Reset(&l_Digest);
+        }
+
+        l_DigestLen = l_pAlgo->DigestSize;
+        l_RetVal = l_CryptoTaDigest_Final(&l_Digest, l_InputData + l_Entry.Offset, l_Entry.Length,
+                                          l_OutPut + index * l_pAlgo->DigestSize, &l_DigestLen);
+        if(OK != l_RetVal)
+        {
+            goto cleanup_1;
+        }
+    }
+    params[3].memref.size = l_Count * l_pAlgo->DigestSize;
+
+    /**5) Do the clean up operation& return the result */
+    cleanup_1:
+        l_CryptoTaDigest_Free(&l_Digest);
+        return l_RetVal;
+}
+
+
+
+/** @ingroup MOUDLE_NAME_C_
+ *- #Description  Release a Merkle tree context.
+ * @param   pMerkle        [IN] The tree, may be NULL
+ *
+ * @return     void
+ * @retval     void
+ *
+ *
+ */
+static void l_CryptoTaMerkle_Free(ST_SHA_MERKLE* pMerkle)
+{
+    if(NULL == pMerkle)
+    {
+        return;
+    }
+    l_CryptoTaDigest_Free(&pMerkle->LeafDigest);
+    l_CryptoTaDigest_Free(&pMerkle->NodeDigest);
+    TEE_Free(pMerkle);
+}
+
+
+
+/** @ingroup MOUDLE_NAME_C_
+ *- #Description  Allocate the context of a Merkle tree.
+ * @param   shaMode        [IN] The sha mode of the tree
+ * @param   leafSize       [IN] Bytes of a full leaf
+ *
+ * @return     ST_SHA_MERKLE*
+ * @retval     NULL on a bad mode or leaf size, or when out of memory
+ *
+ *
+ */
+static ST_SHA_MERKLE* l_CryptoTaMerkle_Start(UINT32 shaMode, UINT32 leafSize)
+{
+    const ST_SHA_ALGO* l_pAlgo;
+    ST_SHA_MERKLE* l_pMerkle;
+
+    /**1) Check the algorithm & the leaf size */
+    l_pAlgo = l_CryptoTaHash_GetAlgo(shaMode);
+    if((NULL == l_pAlgo) || (0U == leafSize))
+    {
+        return NULL;
+    }
+
+    /**2) Allocate the context, too big for the TA stack, & its operations */
+    l_pMerkle = TEE_Malloc(sizeof(*l_pMerkle), 0);
+    if(NULL == l_pMerkle)
+    {
+        return NULL;
+    }
+    l_pMerkle->pAlgo = l_pAlgo;
+    l_pMerkle->LeafSize = leafSize;
+
+    if((OK != l_CryptoTaDigest_Alloc(&l_pMerkle->LeafDigest, l_pAlgo, 0U)) ||
+       (OK != l_CryptoTaDigest_Alloc(&l_pMerkle->NodeDigest, l_pAlgo, 0U)))
+    {
+        l_CryptoTaMerkle_Free(l_pMerkle);
+        return NULL;
+    }
+
+    return l_pMerkle;
+}
+
+
+
+/** @ingroup MOUDLE_NAME_C_
+ *- #Description  Hash two nodes into their parent.
+ * @param   pMerkle        [IN] The tree
+ * @param   left           [IN] Left node
+ * @param   right          [IN] Right node
+ *         output         [OUT] Parent node, may be left or right
+ *
+ * @return     int
+ * @retval     OK / FAIL
+ *
+ *
+ */
+static int l_CryptoTaMerkle_Node(ST_SHA_MERKLE* pMerkle, const UINT8* left, const UINT8* right,
+                                 UINT8* output)
+{
+    static const UINT8 l_NodePrefix = 0x01U;
+    UINT8 l_Right[SHA_MAX_DIGEST_SIZE];
+    UINT32 l_OutLen = pMerkle->pAlgo->DigestSize;
+
+    /* right is copied first: the parent may overwrite it */
+    TEE_MemMove(l_Right, right, l_OutLen);
+    l_CryptoTaDigest_Update(&pMerkle->NodeDigest, &l_NodePrefix, 1U);
+    l_CryptoTaDigest_Update(&pMerkle->NodeDigest, left, l_OutLen);
+
+    return l_CryptoTaDigest_Final(&pMerkle->NodeDigest, l_Right, l_OutLen, output, &l_OutLen);
+}
+
+
+
+/** @ingroup MOUDLE_NAME_C_
+ *- #Description  Finish the current leaf and push its hash on the stack,
+ *                merging the subtrees of the same height.
+ * @param   pMerkle        [IN] The tree
+ * @param   input          [IN] Last data of the leaf
+ * @param   inLen          [IN] Length of the data
+ *         leafHash       [OUT] Copy of the leaf hash, or NULL
+ *
+ * @return     int
+ * @retval     OK / FAIL
+ *
+ *
+ */
+static int l_CryptoTaMerkle_PushLeaf(ST_SHA_MERKLE* pMerkle, const CHAR* input, UINT32 inLen,
+                                     CHAR* leafHash)
+{
+    UINT32 l_OutLen = pMerkle->pAlgo->DigestSize;
+    UINT32 l_Top = pMerkle->Depth;
+
+    /**1) The stack is full after 2^SHA_MERKLE_MAX_LEVELS - 1 leaves */
+    if(SHA_MERKLE_MAX_LEVELS == l_Top)
+    {
+        DMSG("Merkle tree has too many leaves\n");
+        return FAIL;
+    }
+
+    /**2) The digest operation is back to its initial state after the final */
+    if(OK != l_CryptoTaDigest_Final(&pMerkle->LeafDigest, input, inLen,
+                                    pMerkle->Node[l_Top], &l_OutLen))
+    {
+        return FAIL;
+    }
+    if(NULL != leafHash)
+    {
+        TEE_MemMove(leafHash, pMerkle->Node[l_Top], l_OutLen);
+    }
+    pMerkle->Level[l_Top] = 0U;
+    pMerkle->Depth++;
+    pMerkle->LeafFill = 0U;
+
+    /**3) Merge with the complete subtrees of the same height on the left */
+    while((pMerkle->Depth >= 2U) &&
+          (pMerkle->Level[pMerkle->Depth - 1U] == pMerkle->Level[pMerkle->Depth - 2U]))
+    {
+        l_Top = pMerkle->Depth - 2U;
+        if(OK != l_CryptoTaMerkle_Node(pMerkle, pMerkle->Node[l_Top], pMerkle->Node[l_Top + 1U],
+                                       pMerkle->Node[l_Top]))
+        {
+            return FAIL;
+        }
+        pMerkle->Level[l_Top]++;
+        pMerkle->Depth--;
+    }
+
+    return OK;
+}
+
+
+
+/** @ingroup MOUDLE_NAME_C_
+ *- #Description  Add data to a Merkle tree. The hashes of the leaves it
+ *                completes are written to leafHashes when not NULL. Nothing
+ *                is hashed when leafHashes cannot hold them all.
+ * @param   pMerkle        [IN] The tree
+ * @param   input          [IN] The data
+ * @param   inLen          [IN] Length of the data
+ *         leafHashes     [OUT] Hashes of the completed leaves, or NULL
+ *         pLeafLen    [IN/OUT] Size of leafHashes, set to the bytes written
+ *                               or to the required size
+ *
+ * @return     int
+ * @retval     OK / FAIL / FAIL_SHORT_BUFFER
+ *
+ *
+ */
+static int l_CryptoTaMerkle_Update(ST_SHA_MERKLE* pMerkle, const CHAR* input, UINT32 inLen,
+                                   CHAR* leafHashes, UINT32* pLeafLen)
+{
+    static const UINT8 l_LeafPrefix = 0x00U;
+    UINT32 l_DigestSize = pMerkle->pAlgo->DigestSize;
+    uint64_t l_Leaves = 0U;
+    UINT32 l_Take = 0U;
+    UINT32 l_Written = 0U;
+
+    /**1) Check the output can hold the leaves completed by the data */
+    l_Leaves = ((uint64_t)pMerkle->LeafFill + inLen) / pMerkle->LeafSize;
+    if(NULL != leafHashes)
+    {
+        if(l_Leaves * l_DigestSize > 0xFFFFFFFFU)
+        {
+            return FAIL;
+        }
+        if(*pLeafLen < l_Leaves * l_DigestSize)
+        {
+            *pLeafLen = l_Leaves * l_DigestSize;
+            return FAIL_SHORT_BUFFER;
+        }
+    }
+
+    /**2) Fill the leaves, hash the complete ones */
+    while(0U != inLen)
+    {
+        if(0U == pMerkle->LeafFill)
+        {
+            l_CryptoTaDigest_Update(&pMerkle->LeafDigest, &l_LeafPrefix, 1U);
+        }
+
+        l_Take = pMerkle->LeafSize - pMerkle->LeafFill;
+        if(inLen < l_Take)
+        {
+            l_CryptoTaDigest_Update(&pMerkle->LeafDigest, input, inLen);
+            pMerkle->LeafFill += inLen;
+            break;
+        }
+
+        if(OK != l_CryptoTaMerkle_PushLeaf(pMerkle, input, l_Take,
+                                           (NULL == leafHashes) ? NULL : leafHashes + l_Written))
+        {
+            return FAIL;
+        }
+        l_Written += l_DigestSize;
+        input += l_Take;
+        inLen -= l_Take;
+    }
+
+    if(NULL != leafHashes)
+    {
+        *pLeafLen = l_Written;
+    }
+    return OK;
+}
+
+
+
+/** @ingroup MOUDLE_NAME_C_
+ *- #Description  Hash the last, shorter, leaf if any and fold the stack
+ *                into the root of the tree.
+ * @param   pMerkle        [IN] The tree
+ *         root           [OUT] The root
+ *         pRootLen    [IN/OUT] Size of root, set to the digest size
+ *         leafHash       [OUT] Hash of the last leaf, or NULL
+ *         pLeafLen    [IN/OUT] Size of leafHash, set to the bytes written
+ *                               or to the required size
+ *
+ * @return     int
+ * @retval     OK / FAIL / FAIL_SHORT_BUFFER
+ *
+ *
+ */
+static int l_CryptoTaMerkle_Final(ST_SHA_MERKLE* pMerkle, CHAR* root, UINT32* pRootLen,
+                                  CHAR* leafHash, UINT32* pLeafLen)
+{
+    UINT32 l_DigestSize = pMerkle->pAlgo->DigestSize;
+    UINT32 l_LeafLen = (0U != pMerkle->LeafFill) ? l_DigestSize : 0U;
+    UINT32 index = 0U;
+
+    /**1) Check the output sizes */
+    if((*pRootLen < l_DigestSize) || ((NULL != leafHash) && (*pLeafLen < l_LeafLen)))
+    {
+        *pRootLen = l_DigestSize;
+        if(NULL != leafHash)
+        {
+            *pLeafLen = l_LeafLen;
+        }
+        return FAIL_SHORT_BUFFER;
+    }
+
+    /**2) Hash the last leaf */
+    if(0U != pMerkle->LeafFill)
+    {
+        if(OK != l_CryptoTaMerkle_PushLeaf(pMerkle, NULL, 0U, leafHash))
+        {
+            return FAIL;
+        }
+    }
+    if(NULL != leafHash)
+    {
+        *pLeafLen = l_LeafLen;
+    }
+
+    /**3) Fold the subtrees from the right, the root of no leaf is H() */
+    *pRootLen = l_DigestSize;
+    if(0U == pMerkle->Depth)
+    {
+        return l_CryptoTaDigest_Final(&pMerkle->NodeDigest, NULL, 0U, root, pRootLen);
+    }
+    for(index = pMerkle->Depth - 1U; index > 0U; index--)
+    {
+        if(OK != l_CryptoTaMerkle_Node(pMerkle, pMerkle->Node[index - 1U], pMerkle->Node[index],
+                                       pMerkle->Node[index - 1U]))
+        {
+            return FAIL;
+        }
+    }
+    TEE_MemMove(root, pMerkle->Node[0], l_DigestSize);
+
+    return OK;
+}
+
+
+
+/** @ingroup MOUDLE_NAME_C_
+ *- #Description  Merkle tree root of a buffer, optionally with the leaf
+ *                hashes.
+ * @param   params         [IN] param[0].memref: input data
+ *                         [IN] param[1].value.a: EN_SHA_MODE, b: leaf size
+ *                         [OUT] param[2].memref: root, size updated
+ *                         [OUT] param[3].memref: leaf hashes, or none
+ *
+ * @return     int
+ * @retval     OK / FAIL / FAIL_SHORT_BUFFER
+ *
+ *
+ */
+int g_CryptoTaHandle_Merkle(uint32_t paramTypes, TEE_Param params[4])
+{
+    const ST_SHA_ALGO* l_pAlgo;
+    ST_SHA_MERKLE* l_pMerkle = NULL;
+    CHAR* l_LeafHashes = NULL;
+    uint64_t l_LeafLen = 0U;
+    UINT32 l_FinalLen = 0U;
+    UINT32 l_Written = 0U;
+    int l_RetVal = OK;
+
+    if((TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT, TEE_PARAM_TYPE_VALUE_INPUT,
+                        TEE_PARAM_TYPE_MEMREF_OUTPUT, TEE_PARAM_TYPE_NONE) != paramTypes) &&
+       (TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT, TEE_PARAM_TYPE_VALUE_INPUT,
+                        TEE_PARAM_TYPE_MEMREF_OUTPUT, TEE_PARAM_TYPE_MEMREF_OUTPUT) != paramTypes))
+    {
+        return FAIL;
+    }
+
+    /**1) Check the output sizes before doing any work */
+    l_pAlgo = l_CryptoTaHash_GetAlgo(params[1].value.a);
+    if((NULL == l_pAlgo) || (0U == params[1].value.b))
+    {
+        return FAIL;
+    }
+    if(TEE_PARAM_TYPE_MEMREF_OUTPUT == TEE_PARAM_TYPE_GET(paramTypes, 3))
+    {
+        l_LeafHashes = params[3].memref.buffer;
+        l_LeafLen = ((uint64_t)params[0].memref.size + params[1].value.b - 1U) / params[1].value.b;
+        l_LeafLen *= l_pAlgo->DigestSize;
+        if(l_LeafLen > 0xFFFFFFFFU)
+        {
+            return FAIL;
+        }
+    }
+    if((params[2].memref.size < l_pAlgo->DigestSize) || (params[3].memref.size < l_LeafLen))
+    {
+        params[2].memref.size = l_pAlgo->DigestSize;
+        if(NULL != l_LeafHashes)
+        {
+            params[3].memref.size = l_LeafLen;
+        }
+        return FAIL_SHORT_BUFFER;
+    }
+
+    /**2) Hash the whole buffer as one update of a tree */
+    l_pMerkle = l_CryptoTaMerkle_Start(params[1].value.a, params[1].value.b);
+    if(NULL == l_pMerkle)
+    {
+        return FAIL;
+    }
+
+    l_Written = params[3].memref.size;
+    l_RetVal = l_CryptoTaMerkle_Update(l_pMerkle, params[0].memref.buffer, params[0].memref.size,
+                                       l_LeafHashes, &l_Written);
+    if(OK == l_RetVal)
+    {
+        l_FinalLen = params[3].memref.size - l_Written;
+        l_RetVal = l_CryptoTaMerkle_Final(l_pMerkle, params[2].memref.buffer, &params[2].memref.size,
+                                          (NULL == l_LeafHashes) ? NULL : l_LeafHashes + l_Written,
+                                          &l_FinalLen);
+    }
+    if((OK == l_RetVal) && (NULL != l_LeafHashes))
+    {
+        params[3].memref.size = l_Written + l_FinalLen;
+    }
+
+    /**3) Do the clean up operation& return the result */
+    l_CryptoTaMerkle_Free(l_pMerkle);
+    return l_RetVal;
+}
+
+
+
+/** @ingroup MOUDLE_NAME_C_
+ *- #Description  Start a Merkle tree in the session, dropping the tree
+ *                of a previous unfinished sequence.
+ * @param   pSession       [IN] The session context
+ * @param   params         [IN] param[0].value.a: EN_SHA_MODE, b: leaf size
+ *
+ * @return     int
+ * @retval     OK / FAIL
+ *
+ *
+ */
+int g_CryptoTaHandle_MerkleInit(ST_SHA_SESSION* pSession, uint32_t paramTypes, TEE_Param params[4])
+{
+    if(TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT, TEE_PARAM_TYPE_NONE,
+                       TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_NONE) != paramTypes)
+    {
+        return FAIL;
+    }
+
+    l_CryptoTaMerkle_Free(pSession->pMerkle);
+    pSession->pMerkle = l_CryptoTaMerkle_Start(params[0].value.a, params[0].value.b);
+
+    return (NULL == pSession->pMerkle) ? FAIL : OK;
+}
+
+
+
+/** @ingroup MOUDLE_NAME_C_
+ *- #Description  Add data to the Merkle tree of the session.
+ * @param   pSession       [IN] The session context
+ * @param   params         [IN] param[0].memref: input data
+ *                         [OUT] param[1].memref: hashes of the completed
+ *                               leaves, size updated, or none
+ *
+ * @return     int
+ * @retval     OK / FAIL / FAIL_SHORT_BUFFER
+ *
+ *
+ */
+int g_CryptoTaHandle_MerkleUpdate(ST_SHA_SESSION* pSession, uint32_t paramTypes, TEE_Param params[4])
+{
+    CHAR* l_LeafHashes = NULL;
+
+    if((TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT, TEE_PARAM_TYPE_NONE,
+                        TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_NONE) != paramTypes) &&
+       (TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT, TEE_PARAM_TYPE_MEMREF_OUTPUT,
+                        TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_NONE) != paramTypes))
+    {
+        return FAIL;
+    }
+
+    if(NULL == pSession->pMerkle)
+    {
+        DMSG("No Merkle tree started\n");
+        return FAIL;
+    }
+
+    if(TEE_PARAM_TYPE_MEMREF_OUTPUT == TEE_PARAM_TYPE_GET(paramTypes, 1))
+    {
+        l_LeafHashes = params[1].memref.buffer;
+    }
+    return l_CryptoTaMerkle_Update(pSession->pMerkle, params[0].memref.buffer, params[0].memref.size,
+                                   l_LeafHashes, &params[1].memref.size);
+}
+
+
+
+/** @ingroup MOUDLE_NAME_C_
+ *- #Description  Get the root of the Merkle tree of the session. A too
+ *                short output keeps the tree going.
+ * @param   pSession       [IN] The session context
+ *                         [OUT] param[0].memref: root, size updated
+ *                         [OUT] param[1].memref: hash of the last, shorter
+ *                               leaf, size updated, or none
+ *
+ * @return     int
+ * @retval     OK / FAIL / FAIL_SHORT_BUFFER
+ *
+ *
+ */
+int g_CryptoTaHandle_MerkleFinal(ST_SHA_SESSION* pSession, uint32_t paramTypes, TEE_Param params[4])
+{
+    CHAR* l_LeafHash = NULL;
+    int l_RetVal = OK;
+
+    if((TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_OUTPUT, TEE_PARAM_TYPE_NONE,
+                        TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_NONE) != paramTypes) &&
+       (TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_OUTPUT, TEE_PARAM_TYPE_MEMREF_OUTPUT,
+                        TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_NONE) != paramTypes))
+    {
+        return FAIL;
+    }
+
+    if(NULL == pSession->pMerkle)
+    {
+        DMSG("No Merkle tree started\n");
+        return FAIL;
+    }
+
+    if(TEE_PARAM_TYPE_MEMREF_OUTPUT == TEE_PARAM_TYPE_GET(paramTypes, 1))
+    {
+        l_LeafHash = params[1].memref.buffer;
+    }
+    l_RetVal = l_CryptoTaMerkle_Final(pSession->pMerkle, params[0].memref.buffer,
+                                      &params[0].memref.size, l_LeafHash, &params[1].memref.size);
+    if(FAIL_SHORT_BUFFER != l_RetVal)
+    {
+        l_CryptoTaMerkle_Free(pSession->pMerkle);
+        pSession->pMerkle = NULL;
+    }
+
+    return l_RetVal;
+}
+
+
+
+/** @ingroup MOUDLE_NAME_C_
+ *- #Description  Release the resources of a session.
+ * @param   pSession       [IN] The session context
+ *
+ * @return     void
+ * @retval     void
+ *
+ *
+ */
+void g_CryptoTaHandle_CloseSession(ST_SHA_SESSION* pSession)
+{
+    l_CryptoTaDigest_Free(&pSession->Digest);
+    l_CryptoTaMerkle_Free(pSession->pMerkle);
+    TEE_Free(pSession);
+}
+
+
+
+
 
 
 
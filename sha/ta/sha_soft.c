@@ -0,0 +1,425 @@
+/*
+ * Copyright (c) 2016, Linaro Limited
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *******************************************************************************
+ *                                INCLUDE FILES
+ *******************************************************************************
+*/
+#include <string.h>
+#include "sha_soft.h"
+
+
+
+
+/*
+ *******************************************************************************
+ *                  MACRO DEFINITION USED ONLY BY THIS MODULE
+ *******************************************************************************
+*/
+#define SHA_ROL32(a, n)     (((a) << (n)) | ((a) >> (32 - (n))))
+#define SHA_ROR32(a, n)     (((a) >> (n)) | ((a) << (32 - (n))))
+#define SHA_ROR64(a, n)     (((a) >> (n)) | ((a) << (64 - (n))))
+
+
+
+
+/*
+ *******************************************************************************
+ *                          VARIABLES USED ONLY BY THIS MODULE
+ *******************************************************************************
+*/
+static const uint32_t l_Sha256K[64] =
+{
+    0x428a2f98U, 0x71374491U, 0xb5c0fbcfU, 0xe9b5dba5U, 0x3956c25bU, 0x59f111f1U, 0x923f82a4U, 0xab1c5ed5U,
+    0xd807aa98U, 0x12835b01U, 0x243185beU, 0x550c7dc3U, 0x72be5d74U, 0x80deb1feU, 0x9bdc06a7U, 0xc19bf174U,
+    0xe49b69c1U, 0xefbe4786U, 0x0fc19dc6U, 0x240ca1ccU, 0x2de92c6fU, 0x4a7484aaU, 0x5cb0a9dcU, 0x76f988daU,
+    0x983e5152U, 0xa831c66dU, 0xb00327c8U, 0xbf597fc7U, 0xc6e00bf3U, 0xd5a79147U, 0x06ca6351U, 0x14292967U,
+    0x27b70a85U, 0x2e1b2138U, 0x4d2c6dfcU, 0x53380d13U, 0x650a7354U, 0x766a0abbU, 0x81c2c92eU, 0x92722c85U,
+    0xa2bfe8a1U, 0xa81a664bU, 0xc24b8b70U, 0xc76c51a3U, 0xd192e819U, 0xd6990624U, 0xf40e3585U, 0x106aa070U,
+    0x19a4c116U, 0x1e376c08U, 0x2748774cU, 0x34b0bcb5U, 0x391c0cb3U, 0x4ed8aa4aU, 0x5b9cca4fU, 0x682e6ff3U,
+    0x748f82eeU, 0x78a5636fU, 0x84c87814U, 0x8cc70208U, 0x90befffaU, 0xa4506cebU, 0xbef9a3f7U, 0xc67178f2U
+};
+
+static const uint64_t l_Sha512K[80] =
+{
+    0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+    0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+    0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+    0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+    0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+    0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+    0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+    0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+    0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+    0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+    0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+    0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+    0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+    0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+    0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+    0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+    0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+    0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+    0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+    0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
+};
+
+static const uint32_t l_Sha1H0[5] =
+{
+    0x67452301U, 0xefcdab89U, 0x98badcfeU, 0x10325476U, 0xc3d2e1f0U
+};
+
+static const uint32_t l_Sha224H0[8] =
+{
+    0xc1059ed8U, 0x367cd507U, 0x3070dd17U, 0xf70e5939U, 0xffc00b31U, 0x68581511U, 0x64f98fa7U, 0xbefa4fa4U
+};
+
+static const uint32_t l_Sha256H0[8] =
+{
+    0x6a09e667U, 0xbb67ae85U, 0x3c6ef372U, 0xa54ff53aU, 0x510e527fU, 0x9b05688cU, 0x1f83d9abU, 0x5be0cd19U
+};
+
+static const uint64_t l_Sha384H0[8] =
+{
+    0xcbbb9d5dc1059ed8ULL, 0x629a292a367cd507ULL, 0x9159015a3070dd17ULL, 0x152fecd8f70e5939ULL,
+    0x67332667ffc00b31ULL, 0x8eb44a8768581511ULL, 0xdb0c2e0d64f98fa7ULL, 0x47b5481dbefa4fa4ULL
+};
+
+static const uint64_t l_Sha512H0[8] =
+{
+    0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+    0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+
+
+
+/*
+ *******************************************************************************
+ *                          FUNCTIONS USED ONLY BY THIS MODULE
+ *******************************************************************************
+*/
+static uint32_t l_ShaSoft_Load32(const uint8_t* p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+
+
+static uint64_t l_ShaSoft_Load64(const uint8_t* p)
+{
+    return ((uint64_t)l_ShaSoft_Load32(p) << 32) | l_ShaSoft_Load32(p + 4);
+}
+
+
+
+/*
+ * The message schedules below are rolling windows of 16 words: a 2 KiB TA
+ * stack has no room for the 80 words of SHA-512.
+ */
+static void l_ShaSoft_Sha1Block(uint32_t* h, const uint8_t* p)
+{
+    uint32_t w[16];
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    uint32_t f = 0U;
+    uint32_t k = 0U;
+    uint32_t t = 0U;
+    uint32_t i = 0U;
+
+    for(i = 0U; i < 80U; i++)
+    {
+        if(i < 16U)
+        {
+            w[i] = l_ShaSoft_Load32(p + 4U * i);
+        }
+        else
+        {
+            w[i & 15U] = SHA_ROL32(w[(i + 13U) & 15U] ^ w[(i + 8U) & 15U] ^
+                                   w[(i + 2U) & 15U] ^ w[i & 15U], 1);
+        }
+
+        if(i < 20U)
+        {
+            f = (b & c) | (~b & d);
+            k = 0x5a827999U;
+        }
+        else if(i < 40U)
+        {
+            f = b ^ c ^ d;
+            k = 0x6ed9eba1U;
+        }
+        else if(i < 60U)
+        {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8f1bbcdcU;
+        }
+        else
+        {
+            f = b ^ c ^ d;
+            k = 0xca62c1d6U;
+        }
+
+        t = SHA_ROL32(a, 5) + f + e + k + w[i & 15U];
+        e = d;
+        d = c;
+        c = SHA_ROL32(b, 30);
+        b = a;
+        a = t;
+    }
+
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+}
+
+
+
+static void l_ShaSoft_Sha256Block(uint32_t* h, const uint8_t* p)
+{
+    uint32_t w[16];
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+    uint32_t s0 = 0U;
+    uint32_t s1 = 0U;
+    uint32_t t1 = 0U;
+    uint32_t t2 = 0U;
+    uint32_t i = 0U;
+
+    for(i = 0U; i < 64U; i++)
+    {
+        if(i < 16U)
+        {
+            w[i] = l_ShaSoft_Load32(p + 4U * i);
+        }
+        else
+        {
+            s0 = w[(i + 1U) & 15U];
+            s0 = SHA_ROR32(s0, 7) ^ SHA_ROR32(s0, 18) ^ (s0 >> 3);
+            s1 = w[(i + 14U) & 15U];
+            s1 = SHA_ROR32(s1, 17) ^ SHA_ROR32(s1, 19) ^ (s1 >> 10);
+            w[i & 15U] += s0 + w[(i + 9U) & 15U] + s1;
+        }
+
+        t1 = hh + (SHA_ROR32(e, 6) ^ SHA_ROR32(e, 11) ^ SHA_ROR32(e, 25)) + ((e & f) ^ (~e & g)) +
+             l_Sha256K[i] + w[i & 15U];
+        t2 = (SHA_ROR32(a, 2) ^ SHA_ROR32(a, 13) ^ SHA_ROR32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        hh = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+}
+
+
+
+static void l_ShaSoft_Sha512Block(uint64_t* h, const uint8_t* p)
+{
+    uint64_t w[16];
+    uint64_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+    uint64_t s0 = 0U;
+    uint64_t s1 = 0U;
+    uint64_t t1 = 0U;
+    uint64_t t2 = 0U;
+    uint32_t i = 0U;
+
+    for(i = 0U; i < 80U; i++)
+    {
+        if(i < 16U)
+        {
+            w[i] = l_ShaSoft_Load64(p + 8U * i);
+        }
+        else
+        {
+            s0 = w[(i + 1U) & 15U];
+            s0 = SHA_ROR64(s0, 1) ^ SHA_ROR64(s0, 8) ^ (s0 >> 7);
+            s1 = w[(i + 14U) & 15U];
+            s1 = SHA_ROR64(s1, 19) ^ SHA_ROR64(s1, 61) ^ (s1 >> 6);
+            w[i & 15U] += s0 + w[(i + 9U) & 15U] + s1;
+        }
+
+        t1 = hh + (SHA_ROR64(e, 14) ^ SHA_ROR64(e, 18) ^ SHA_ROR64(e, 41)) + ((e & f) ^ (~e & g)) +
+             l_Sha512K[i] + w[i & 15U];
+        t2 = (SHA_ROR64(a, 28) ^ SHA_ROR64(a, 34) ^ SHA_ROR64(a, 39)) + ((a & b) ^ (a & c) ^ (b & c));
+        hh = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+}
+
+
+
+static uint32_t l_ShaSoft_BlockSize(const ST_SHA_SOFT* pCtx)
+{
+    return (pCtx->Mode >= EN_OP_SHA384) ? 128U : 64U;
+}
+
+
+
+static void l_ShaSoft_Block(ST_SHA_SOFT* pCtx, const uint8_t* p)
+{
+    switch(pCtx->Mode)
+    {
+        case EN_OP_SHA1:
+            l_ShaSoft_Sha1Block(pCtx->H.W32, p);
+            break;
+        case EN_OP_SHA224:
+        case EN_OP_SHA256:
+            l_ShaSoft_Sha256Block(pCtx->H.W32, p);
+            break;
+        default:
+            l_ShaSoft_Sha512Block(pCtx->H.W64, p);
+            break;
+    }
+}
+
+
+
+
+/*
+ *******************************************************************************
+ *                               FUNCTIONS IMPLEMENT
+ *******************************************************************************
+*/
+int g_ShaSoft_Init(ST_SHA_SOFT* pCtx, uint32_t shaMode)
+{
+    memset(pCtx, 0, sizeof(*pCtx));
+    pCtx->Mode = shaMode;
+
+    switch(shaMode)
+    {
+        case EN_OP_SHA1:
+            memcpy(pCtx->H.W32, l_Sha1H0, sizeof(l_Sha1H0));
+            break;
+        case EN_OP_SHA224:
+            memcpy(pCtx->H.W32, l_Sha224H0, sizeof(l_Sha224H0));
+            break;
+        case EN_OP_SHA256:
+            memcpy(pCtx->H.W32, l_Sha256H0, sizeof(l_Sha256H0));
+            break;
+        case EN_OP_SHA384:
+            memcpy(pCtx->H.W64, l_Sha384H0, sizeof(l_Sha384H0));
+            break;
+        case EN_OP_SHA512:
+            memcpy(pCtx->H.W64, l_Sha512H0, sizeof(l_Sha512H0));
+            break;
+        default:
+            return -1;
+    }
+
+    return 0;
+}
+
+
+
+void g_ShaSoft_Update(ST_SHA_SOFT* pCtx, const void* input, uint32_t len)
+{
+    const uint8_t* l_pIn = input;
+    uint32_t l_BlockSize = l_ShaSoft_BlockSize(pCtx);
+    uint32_t l_Take = 0U;
+
+    pCtx->Length += len;
+
+    /**1) Complete the block in progress */
+    if(0U != pCtx->Fill)
+    {
+        l_Take = l_BlockSize - pCtx->Fill;
+        l_Take = (len < l_Take) ? len : l_Take;
+        memcpy(pCtx->Block + pCtx->Fill, l_pIn, l_Take);
+        pCtx->Fill += l_Take;
+        l_pIn += l_Take;
+        len -= l_Take;
+        if(pCtx->Fill < l_BlockSize)
+        {
+            return;
+        }
+        l_ShaSoft_Block(pCtx, pCtx->Block);
+        pCtx->Fill = 0U;
+    }
+
+    /**2) Whole blocks straight from the input, keep the rest */
+    while(len >= l_BlockSize)
+    {
+        l_ShaSoft_Block(pCtx, l_pIn);
+        l_pIn += l_BlockSize;
+        len -= l_BlockSize;
+    }
+    memcpy(pCtx->Block, l_pIn, len);
+    pCtx->Fill = len;
+}
+
+
+
+void g_ShaSoft_Final(ST_SHA_SOFT* pCtx, void* output)
+{
+    uint8_t* l_pOut = output;
+    uint32_t l_BlockSize = l_ShaSoft_BlockSize(pCtx);
+    uint32_t l_LenSize = l_BlockSize / 8U;
+    uint32_t l_DigestSize = g_ShaAlgo_Get(pCtx->Mode)->DigestSize;
+    uint64_t l_Bits = pCtx->Length << 3;
+    uint32_t index = 0U;
+
+    /**1) Pad: 0x80, zeros, then the message length in bits, big endian */
+    pCtx->Block[pCtx->Fill++] = 0x80U;
+    if(pCtx->Fill > l_BlockSize - l_LenSize)
+    {
+        memset(pCtx->Block + pCtx->Fill, 0, l_BlockSize - pCtx->Fill);
+        l_ShaSoft_Block(pCtx, pCtx->Block);
+        pCtx->Fill = 0U;
+    }
+    memset(pCtx->Block + pCtx->Fill, 0, l_BlockSize - pCtx->Fill);
+    for(index = 0U; index < 8U; index++)
+    {
+        pCtx->Block[l_BlockSize - 1U - index] = (uint8_t)(l_Bits >> (8U * index));
+    }
+    l_ShaSoft_Block(pCtx, pCtx->Block);
+
+    /**2) Output the chaining value big endian, truncated to the digest size */
+    for(index = 0U; index < l_DigestSize; index++)
+    {
+        if(64U == l_BlockSize)
+        {
+            l_pOut[index] = (uint8_t)(pCtx->H.W32[index / 4U] >> (24U - 8U * (index % 4U)));
+        }
+        else
+        {
+            l_pOut[index] = (uint8_t)(pCtx->H.W64[index / 8U] >> (56U - 8U * (index % 8U)));
+        }
+    }
+
+    g_ShaSoft_Init(pCtx, pCtx->Mode);
+}
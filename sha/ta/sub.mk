@@ -2,6 +2,13 @@ global-incdirs-y += include
 #global-incdirs-y += ../host/include
 srcs-y += sha.c
 srcs-y += sha_handle.c
+srcs-y += keccak.c
+srcs-y += sha_soft.c
+
+# Hex tracing of the hash path, off by default: make CFG_SHA_TRACE=y
+ifeq ($(CFG_SHA_TRACE),y)
+cflags-y += -DCFG_SHA_TRACE
+endif
 
 # To remove a certain compiler flag, add a line like this
 #cflags-template_ta.c-y += -Wno-strict-prototypes